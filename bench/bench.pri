@@ -0,0 +1,20 @@
+#-------------------------------------------------
+# common settings of benchmarks, platform libs from config.pri
+#-------------------------------------------------
+!include($$PWD/../config.pri) {
+    error(Failed to include config.pri)
+}
+
+TEMPLATE = app
+
+CONFIG   -= qt
+CONFIG   += console
+CONFIG   += release
+
+DEFINES  += NO_GUI
+
+windows:DEFINES += WIN32
+
+XBRIDGE_SRC = $$PWD/../src
+
+INCLUDEPATH += $$XBRIDGE_SRC
@@ -0,0 +1,13 @@
+#-------------------------------------------------
+#
+# benchmarks, separate from main build
+#   qmake bench/bench.pro && make
+#
+#-------------------------------------------------
+TEMPLATE = subdirs
+
+SUBDIRS += \
+    packet \
+    matcher \
+    rpcparser \
+    coinselector
@@ -0,0 +1,17 @@
+#-------------------------------------------------
+# coin selection on synthetic wallets, bnb check
+#-------------------------------------------------
+include(../bench.pri)
+
+TARGET = bench_coinselector
+
+SOURCES += \
+    coinselectorbench.cpp \
+    $$XBRIDGE_SRC/xbridgecoinselector.cpp \
+    $$XBRIDGE_SRC/util/logger.cpp \
+    $$XBRIDGE_SRC/util/settings.cpp
+
+HEADERS += \
+    $$XBRIDGE_SRC/xbridgecoinselector.h \
+    $$XBRIDGE_SRC/util/logger.h \
+    $$XBRIDGE_SRC/util/settings.h
@@ -0,0 +1,202 @@
+//*****************************************************************************
+// coin selection on synthetic wallets of 100 to 50k outputs
+//
+// time per selection, inputs and excess over target of bnb, knapsack
+// and largest first. before timing, bnb checked against exhaustive
+// search on small wallets with many equal outputs (backtracking and
+// skip of equal values must not lose a match or fewest inputs)
+//*****************************************************************************
+
+#include "xbridgecoinselector.h"
+#include "uiconnector.h"
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <random>
+#include <cmath>
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+// log of selector, defined in xbridgeapp.cpp in application
+UIConnector uiConnector;
+
+//*****************************************************************************
+//*****************************************************************************
+namespace
+{
+
+enum
+{
+    // per wallet size
+    targetCount = 20,
+    // exhaustive check
+    checkRounds = 2000,
+    checkSize   = 12
+};
+
+const boost::uint64_t COIN       = 100000000;
+const boost::uint64_t changeCost = 20000;
+
+std::mt19937 rng(42);
+
+//*****************************************************************************
+// amounts spread over several magnitudes, like wallet of exchange user
+//*****************************************************************************
+std::vector<boost::uint64_t> makeWallet(const std::size_t size)
+{
+    std::lognormal_distribution<double> amount(std::log(0.05 * COIN), 2.0);
+
+    std::vector<boost::uint64_t> values(size);
+    for (std::size_t i = 0; i < size; ++i)
+    {
+        values[i] = 1000 + static_cast<boost::uint64_t>(std::min(amount(rng), 50.0 * COIN));
+    }
+    return values;
+}
+
+//*****************************************************************************
+// fewest inputs of subset with sum in [target, upper], 0 if none
+//*****************************************************************************
+std::size_t exhaustiveInputs(const std::vector<boost::uint64_t> & values,
+                             const boost::uint64_t target, const boost::uint64_t upper)
+{
+    std::size_t best = 0;
+    for (unsigned int mask = 1; mask < (1u << values.size()); ++mask)
+    {
+        boost::uint64_t sum = 0;
+        std::size_t count = 0;
+        for (std::size_t i = 0; i < values.size(); ++i)
+        {
+            if (mask & (1u << i))
+            {
+                sum += values[i];
+                ++count;
+            }
+        }
+
+        if (sum >= target && sum <= upper && (best == 0 || count < best))
+        {
+            best = count;
+        }
+    }
+    return best;
+}
+
+//*****************************************************************************
+//*****************************************************************************
+bool checkBnB()
+{
+    XBridgeBnBSelector bnb;
+
+    for (unsigned int round = 0; round < checkRounds; ++round)
+    {
+        // few distinct values, many equal ones
+        std::vector<boost::uint64_t> values(checkSize);
+        for (std::size_t i = 0; i < values.size(); ++i)
+        {
+            values[i] = 1 + rng() % 6;
+        }
+
+        const boost::uint64_t target = 1 + rng() % 30;
+        const boost::uint64_t window = rng() % 2;
+
+        std::vector<std::size_t> selected;
+        const bool found = bnb.select(values, target, window, selected);
+        const std::size_t expected = exhaustiveInputs(values, target, target + window);
+
+        boost::uint64_t sum = 0;
+        for (std::size_t i = 0; i < selected.size(); ++i)
+        {
+            sum += values[selected[i]];
+        }
+
+        if (found != (expected != 0) ||
+                (found && (sum < target || sum > target + window || selected.size() != expected)))
+        {
+            std::cerr << "bnb check failed, target " << target << " window " << window
+                      << " found " << found << " inputs " << selected.size()
+                      << " expected " << expected << std::endl;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+//*****************************************************************************
+//*****************************************************************************
+void run(const std::string & name, XBridgeCoinSelector & selector,
+         const std::vector<boost::uint64_t> & values,
+         const std::vector<boost::uint64_t> & targets)
+{
+    std::size_t found  = 0;
+    std::size_t inputs = 0;
+    double excess      = 0;
+
+    boost::posix_time::ptime start = boost::posix_time::microsec_clock::universal_time();
+    for (std::size_t t = 0; t < targets.size(); ++t)
+    {
+        std::vector<std::size_t> selected;
+        if (!selector.select(values, targets[t], changeCost, selected))
+        {
+            continue;
+        }
+
+        boost::uint64_t sum = 0;
+        for (std::size_t i = 0; i < selected.size(); ++i)
+        {
+            sum += values[selected[i]];
+        }
+
+        ++found;
+        inputs += selected.size();
+        excess += static_cast<double>(sum - targets[t]) / COIN;
+    }
+    boost::posix_time::time_duration d = boost::posix_time::microsec_clock::universal_time() - start;
+
+    std::cout << "  " << std::left << std::setw(9) << name << std::right
+              << std::fixed << std::setprecision(1)
+              << std::setw(10) << d.total_microseconds() / 1000.0 / targets.size() << " ms"
+              << "   found " << std::setw(2) << found << "/" << targets.size()
+              << "   inputs " << std::setw(6) << (found ? double(inputs) / found : 0)
+              << "   excess " << std::setprecision(6) << std::setw(12) << (found ? excess / found : 0)
+              << std::endl;
+}
+
+} // namespace
+
+//*****************************************************************************
+//*****************************************************************************
+int main()
+{
+    if (!checkBnB())
+    {
+        return 1;
+    }
+    std::cout << "bnb matches exhaustive search on " << checkRounds << " wallets" << std::endl;
+
+    XBridgeBnBSelector          bnb;
+    XBridgeKnapsackSelector     knapsack;
+    XBridgeLargestFirstSelector largest;
+
+    const std::size_t sizes[] = { 100, 1000, 10000, 50000 };
+    for (std::size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s)
+    {
+        std::vector<boost::uint64_t> values = makeWallet(sizes[s]);
+
+        // payments from small to about balance of hundred outputs
+        std::vector<boost::uint64_t> targets(targetCount);
+        for (std::size_t t = 0; t < targets.size(); ++t)
+        {
+            targets[t] = COIN / 100 + rng() % (5 * COIN);
+        }
+
+        std::cout << sizes[s] << " outputs" << std::endl;
+        run("bnb",      bnb,      values, targets);
+        run("knapsack", knapsack, values, targets);
+        run("largest",  largest,  values, targets);
+    }
+
+    return 0;
+}
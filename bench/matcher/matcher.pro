@@ -0,0 +1,17 @@
+#-------------------------------------------------
+# order matching throughput at 10k and 100k resting orders
+#-------------------------------------------------
+include(../bench.pri)
+
+TARGET = bench_matcher
+
+SOURCES += \
+    matcherbench.cpp \
+    $$XBRIDGE_SRC/xbridgematcher.cpp \
+    $$XBRIDGE_SRC/xbridgeorderbook.cpp \
+    $$XBRIDGE_SRC/xbridgepacketpool.cpp \
+    $$XBRIDGE_SRC/util/crc32c.cpp
+
+HEADERS += \
+    $$XBRIDGE_SRC/xbridgematcher.h \
+    $$XBRIDGE_SRC/xbridgeorderbook.h
@@ -0,0 +1,153 @@
+//*****************************************************************************
+// order matching throughput at 10k and 100k resting orders
+//
+// book of one pair filled with sell orders on 1000 price levels, then
+// timed: resting orders added (no cross), crossing orders filling part
+// of best level, and cancels of resting orders
+//*****************************************************************************
+
+#include "xbridgematcher.h"
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <cstring>
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+//*****************************************************************************
+//*****************************************************************************
+namespace
+{
+
+enum
+{
+    levels     = 1000,
+    operations = 100000
+};
+
+const boost::uint64_t COIN = 1000000;
+
+std::mt19937 rng(42);
+boost::uint64_t nextId = 0;
+
+//*****************************************************************************
+//*****************************************************************************
+uint256 makeId()
+{
+    uint256 id;
+    ++nextId;
+    memcpy(id.begin(), &nextId, sizeof(nextId));
+    return id;
+}
+
+//*****************************************************************************
+// sells BTC for XC, price above 100 XC per BTC
+//*****************************************************************************
+XBridgeOrder restingOrder()
+{
+    boost::uint64_t amount = COIN + rng() % COIN;
+    boost::uint64_t price  = 100 + 1 + rng() % levels;
+    return XBridgeOrder(makeId(), "BTC", amount, "XC", amount * price);
+}
+
+//*****************************************************************************
+// buys part of best level
+//*****************************************************************************
+XBridgeOrder crossingOrder()
+{
+    boost::uint64_t amount = COIN / 10 + rng() % (COIN / 10);
+    return XBridgeOrder(makeId(), "XC", amount * (100 + levels + 1), "BTC", amount);
+}
+
+//*****************************************************************************
+//*****************************************************************************
+double perSecond(const boost::posix_time::ptime & start, const std::size_t count)
+{
+    boost::posix_time::time_duration d = boost::posix_time::microsec_clock::universal_time() - start;
+    return d.total_microseconds() ? count * 1000000.0 / d.total_microseconds() : 0;
+}
+
+//*****************************************************************************
+//*****************************************************************************
+void run(const std::size_t resting)
+{
+    XBridgeMatcher matcher;
+    std::vector<XBridgeFill> fills;
+    bool dust = false;
+
+    std::vector<uint256> ids;
+    ids.reserve(resting + operations);
+    for (std::size_t i = 0; i < resting; ++i)
+    {
+        XBridgeOrder o = restingOrder();
+        ids.push_back(o.id);
+        matcher.add(o, fills, dust);
+    }
+
+    // prepared outside of timed loops
+    std::vector<XBridgeOrder> orders;
+    orders.reserve(operations);
+    for (std::size_t i = 0; i < operations; ++i)
+    {
+        orders.push_back(restingOrder());
+    }
+
+    boost::posix_time::ptime start = boost::posix_time::microsec_clock::universal_time();
+    for (std::size_t i = 0; i < orders.size(); ++i)
+    {
+        fills.clear();
+        matcher.add(orders[i], fills, dust);
+        ids.push_back(orders[i].id);
+    }
+    double add = perSecond(start, orders.size());
+
+    orders.clear();
+    for (std::size_t i = 0; i < operations; ++i)
+    {
+        orders.push_back(crossingOrder());
+    }
+
+    std::size_t fillCount = 0;
+    start = boost::posix_time::microsec_clock::universal_time();
+    for (std::size_t i = 0; i < orders.size(); ++i)
+    {
+        fills.clear();
+        matcher.add(orders[i], fills, dust);
+        fillCount += fills.size();
+    }
+    double match = perSecond(start, orders.size());
+
+    std::shuffle(ids.begin(), ids.end(), rng);
+    ids.resize(operations);
+
+    start = boost::posix_time::microsec_clock::universal_time();
+    for (std::size_t i = 0; i < ids.size(); ++i)
+    {
+        matcher.remove(ids[i]);
+    }
+    double cancel = perSecond(start, ids.size());
+
+    std::cout << std::setw(7) << resting << " resting"
+              << std::fixed << std::setprecision(0)
+              << "   add " << std::setw(9) << add << " orders/s"
+              << "   match " << std::setw(9) << match << " orders/s"
+              << " (" << std::setprecision(2) << double(fillCount) / operations << " fills/order)"
+              << std::setprecision(0)
+              << "   cancel " << std::setw(9) << cancel << " orders/s"
+              << std::endl;
+}
+
+} // namespace
+
+//*****************************************************************************
+//*****************************************************************************
+int main()
+{
+    run(10000);
+    run(100000);
+
+    return 0;
+}
@@ -0,0 +1,16 @@
+#-------------------------------------------------
+# crc32c cost per packet, finalize and receive check
+#-------------------------------------------------
+include(../bench.pri)
+
+TARGET = bench_packet
+
+SOURCES += \
+    packetbench.cpp \
+    $$XBRIDGE_SRC/util/crc32c.cpp \
+    $$XBRIDGE_SRC/xbridgepacketpool.cpp
+
+HEADERS += \
+    $$XBRIDGE_SRC/util/crc32c.h \
+    $$XBRIDGE_SRC/xbridgepacket.h \
+    $$XBRIDGE_SRC/xbridgepacketpool.h
@@ -0,0 +1,106 @@
+//*****************************************************************************
+// crc32c cost per packet at 100 B, 1 KB and 8 KB payload
+//
+// send side is finalize (crc of payload into header), receive side is
+// copyFrom of datagram and crc check as in XBridgeApp::onMessageReceived
+//*****************************************************************************
+
+#include "xbridgepacket.h"
+#include "util/crc32c.h"
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+//*****************************************************************************
+//*****************************************************************************
+namespace
+{
+
+enum
+{
+    // packets per size, bytes checksummed per size about equal
+    totalBytes = 256 * 1024 * 1024
+};
+
+volatile boost::uint32_t sink = 0;
+
+//*****************************************************************************
+//*****************************************************************************
+double elapsedNs(const boost::posix_time::ptime & start, const std::size_t count)
+{
+    boost::posix_time::time_duration d = boost::posix_time::microsec_clock::universal_time() - start;
+    return static_cast<double>(d.total_microseconds()) * 1000.0 / count;
+}
+
+//*****************************************************************************
+//*****************************************************************************
+void run(const std::size_t payload)
+{
+    const std::size_t count = totalBytes / payload;
+
+    XBridgePacketPtr packet(new XBridgePacket(xbcXChatMessage, payload));
+    std::vector<unsigned char> data(payload);
+    for (std::size_t i = 0; i < payload; ++i)
+    {
+        data[i] = static_cast<unsigned char>(i * 31 + 7);
+    }
+    packet->append(&data[0], static_cast<int>(data.size()));
+
+    // send
+    boost::posix_time::ptime start = boost::posix_time::microsec_clock::universal_time();
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        packet->finalize();
+        sink += packet->crc();
+    }
+    double send = elapsedNs(start, count);
+
+    std::vector<unsigned char> message(packet->header(), packet->header() + packet->allSize());
+
+    // receive
+    start = boost::posix_time::microsec_clock::universal_time();
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        XBridgePacketPtr received(new XBridgePacket);
+        if (!received->copyFrom(message) || !received->isCrcValid())
+        {
+            std::cerr << "crc check failed" << std::endl;
+            return;
+        }
+    }
+    double receive = elapsedNs(start, count);
+
+    // crc alone
+    start = boost::posix_time::microsec_clock::universal_time();
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        sink += util::crc32c(&data[0], data.size());
+    }
+    double crc = elapsedNs(start, count);
+
+    std::cout << std::setw(6) << payload << " B"
+              << std::fixed << std::setprecision(1)
+              << "   crc " << std::setw(8) << crc << " ns"
+              << "   finalize " << std::setw(8) << send << " ns"
+              << "   receive " << std::setw(8) << receive << " ns"
+              << "   " << std::setprecision(2) << (payload / crc) << " B/ns"
+              << std::endl;
+}
+
+} // namespace
+
+//*****************************************************************************
+//*****************************************************************************
+int main()
+{
+    std::cout << "crc32c " << (util::crc32cHardware() ? "sse4.2" : "table") << std::endl;
+
+    run(100);
+    run(1024);
+    run(8192);
+
+    return 0;
+}
@@ -0,0 +1,17 @@
+#-------------------------------------------------
+# listunspent reply parse time, JSONReader and json_spirit
+#-------------------------------------------------
+include(../bench.pri)
+
+TARGET = bench_rpcparser
+
+SOURCES += \
+    rpcparserbench.cpp \
+    $$XBRIDGE_SRC/rpcparser.cpp \
+    $$XBRIDGE_SRC/json/json_spirit_reader.cpp \
+    $$XBRIDGE_SRC/json/json_spirit_value.cpp
+
+HEADERS += \
+    $$XBRIDGE_SRC/rpcparser.h \
+    $$XBRIDGE_SRC/json/json_spirit_reader.h \
+    $$XBRIDGE_SRC/json/json_spirit_value.h
@@ -0,0 +1,284 @@
+//*****************************************************************************
+// listunspent reply of 5000 outputs parsed with JSONReader
+// (as rpc::listUnspent) and into json_spirit tree (as before)
+//
+// reply generated like bitcoind output, all members of entry present.
+// first checked with values other than objects between outputs
+//*****************************************************************************
+
+#include "rpcparser.h"
+#include "json/json_spirit_reader_template.h"
+#include "json/json_spirit_utils.h"
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <cstdio>
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+using namespace json_spirit;
+
+//*****************************************************************************
+//*****************************************************************************
+namespace
+{
+
+enum
+{
+    entryCount = 5000,
+    rounds     = 50
+};
+
+struct Unspent
+{
+    std::string txId;
+    int         vout;
+    double      amount;
+};
+
+//*****************************************************************************
+//*****************************************************************************
+std::string hex(const unsigned int seed, const std::size_t size)
+{
+    static const char digits[] = "0123456789abcdef";
+
+    std::string result(size, '0');
+    unsigned int x = seed * 2654435761u + 1;
+    for (std::size_t i = 0; i < size; ++i)
+    {
+        x = x * 1103515245u + 12345u;
+        result[i] = digits[(x >> 16) & 0xf];
+    }
+    return result;
+}
+
+//*****************************************************************************
+//*****************************************************************************
+std::string makeReply(const bool mixed)
+{
+    // non-object elements, skipped by both parsers
+    static const char * junk[] = { "null", "5", "\"x\"", "[1,{\"txid\":\"0\"}]", "true" };
+
+    std::ostringstream o;
+    o << "{\"result\":[";
+    for (unsigned int i = 0; i < entryCount; ++i)
+    {
+        char amount[32];
+        sprintf(amount, "%.8f", (i % 1000 + 1) * 0.01234567);
+
+        if (mixed && i % 100 == 0)
+        {
+            o << (i ? "," : "") << junk[(i / 100) % 5];
+        }
+
+        o << (i || mixed ? "," : "")
+          << "{\"txid\":\"" << hex(i, 64) << "\","
+          << "\"vout\":" << i % 4 << ","
+          << "\"address\":\"mq" << hex(i + entryCount, 32) << "\","
+          << "\"account\":\"\","
+          << "\"scriptPubKey\":\"76a914" << hex(i + 2 * entryCount, 40) << "88ac\","
+          << "\"amount\":" << amount << ","
+          << "\"confirmations\":" << 1 + i % 500 << ","
+          << "\"spendable\":true}";
+    }
+    o << "],\"error\":null,\"id\":1}";
+    return o.str();
+}
+
+//*****************************************************************************
+// same as rpc::parseUnspent
+//*****************************************************************************
+bool parseReader(const char * begin, const char * end, std::vector<Unspent> & entries)
+{
+    rpc::JSONReader reader(begin, end);
+
+    std::string name;
+    if (!reader.beginObject())
+    {
+        return false;
+    }
+
+    while (reader.nextMember(name))
+    {
+        if (name == "result")
+        {
+            if (!reader.beginArray())
+            {
+                return false;
+            }
+
+            while (reader.nextElement())
+            {
+                if (!reader.isObject())
+                {
+                    reader.skipValue();
+                    continue;
+                }
+
+                reader.beginObject();
+
+                Unspent u;
+                u.vout   = 0;
+                u.amount = 0;
+
+                while (reader.nextMember(name))
+                {
+                    if (name == "txid")
+                    {
+                        reader.readString(u.txId);
+                    }
+                    else if (name == "vout")
+                    {
+                        reader.readInt(u.vout);
+                    }
+                    else if (name == "amount")
+                    {
+                        reader.readDouble(u.amount);
+                    }
+                    else
+                    {
+                        reader.skipValue();
+                    }
+                }
+
+                if (!u.txId.empty() && u.amount > 0)
+                {
+                    entries.push_back(u);
+                }
+            }
+        }
+        else
+        {
+            reader.skipValue();
+        }
+    }
+
+    return reader.ok();
+}
+
+//*****************************************************************************
+// tree parse and walk of listUnspent before JSONReader
+//*****************************************************************************
+bool parseSpirit(const std::string & body, std::vector<Unspent> & entries)
+{
+    Value reply;
+    if (!read_string(body, reply) || reply.type() != obj_type)
+    {
+        return false;
+    }
+
+    const Value & result = find_value(reply.get_obj(), "result");
+    if (result.type() != array_type)
+    {
+        return false;
+    }
+
+    const Array & arr = result.get_array();
+    for (const Value & v : arr)
+    {
+        if (v.type() != obj_type)
+        {
+            continue;
+        }
+
+        Unspent u;
+        u.vout   = 0;
+        u.amount = 0;
+
+        const Object & o = v.get_obj();
+        for (const Pair & p : o)
+        {
+            if (p.name_ == "txid")
+            {
+                u.txId = p.value_.get_str();
+            }
+            else if (p.name_ == "vout")
+            {
+                u.vout = p.value_.get_int();
+            }
+            else if (p.name_ == "amount")
+            {
+                u.amount = p.value_.get_real();
+            }
+        }
+
+        if (!u.txId.empty() && u.amount > 0)
+        {
+            entries.push_back(u);
+        }
+    }
+
+    return true;
+}
+
+//*****************************************************************************
+//*****************************************************************************
+double elapsedMs(const boost::posix_time::ptime & start, const std::size_t count)
+{
+    boost::posix_time::time_duration d = boost::posix_time::microsec_clock::universal_time() - start;
+    return static_cast<double>(d.total_microseconds()) / 1000.0 / count;
+}
+
+} // namespace
+
+//*****************************************************************************
+//*****************************************************************************
+int main()
+{
+    std::vector<Unspent> entries;
+    entries.reserve(entryCount);
+
+    // array with other values between outputs, same outputs from both
+    {
+        const std::string mixed = makeReply(true);
+
+        std::vector<Unspent> spiritEntries;
+        if (!parseReader(mixed.data(), mixed.data() + mixed.size(), entries) ||
+                !parseSpirit(mixed, spiritEntries) ||
+                entries.size() != entryCount || spiritEntries.size() != entryCount)
+        {
+            std::cerr << "mixed array check failed, JSONReader " << entries.size()
+                      << " json_spirit " << spiritEntries.size() << std::endl;
+            return 1;
+        }
+        std::cout << "mixed array: " << entries.size() << " outputs from both parsers" << std::endl;
+    }
+
+    const std::string body = makeReply(false);
+
+    boost::posix_time::ptime start = boost::posix_time::microsec_clock::universal_time();
+    for (std::size_t i = 0; i < rounds; ++i)
+    {
+        entries.clear();
+        if (!parseReader(body.data(), body.data() + body.size(), entries) ||
+                entries.size() != entryCount)
+        {
+            std::cerr << "JSONReader parse failed" << std::endl;
+            return 1;
+        }
+    }
+    double reader = elapsedMs(start, rounds);
+
+    start = boost::posix_time::microsec_clock::universal_time();
+    for (std::size_t i = 0; i < rounds; ++i)
+    {
+        entries.clear();
+        if (!parseSpirit(body, entries) || entries.size() != entryCount)
+        {
+            std::cerr << "json_spirit parse failed" << std::endl;
+            return 1;
+        }
+    }
+    double spirit = elapsedMs(start, rounds);
+
+    std::cout << entryCount << " outputs, " << body.size() / 1024 << " KB" << std::endl
+              << std::fixed << std::setprecision(2)
+              << "JSONReader  " << std::setw(8) << reader << " ms" << std::endl
+              << "json_spirit " << std::setw(8) << spirit << " ms" << std::endl
+              << "speedup     " << std::setw(8) << spirit / reader << std::endl;
+
+    return 0;
+}
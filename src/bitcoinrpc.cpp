@@ -13,11 +13,21 @@
 #include <boost/algorithm/string.hpp>
 //#include <boost/lexical_cast.hpp>
 #include <boost/asio/ssl.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/enable_shared_from_this.hpp>
+#include <boost/function.hpp>
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
 //#include <boost/filesystem/fstream.hpp>
 //#include <boost/shared_ptr.hpp>
 //#include <list>
+#include <deque>
 
 #include "bitcoinrpc.h"
+#include "rpcparser.h"
 #include "bignum.h"
 #include "util/util.h"
 #include "util/logger.h"
@@ -121,6 +131,15 @@ enum HTTPStatusCode
     HTTP_INTERNAL_SERVER_ERROR = 500,
 };
 
+//******************************************************************************
+// json-rpc error codes of wallet
+//******************************************************************************
+enum RPCErrorCode
+{
+    // also "Block not found"
+    RPC_INVALID_ADDRESS_OR_KEY = -5,
+};
+
 //******************************************************************************
 //******************************************************************************
 std::string real_strprintf(const std::string &format, int dummy, ...);
@@ -256,7 +275,7 @@ string HTTPPost(const string& strMsg, const map<string,string>& mapRequestHeader
       << "Host: 127.0.0.1\r\n"
       << "Content-Type: application/json\r\n"
       << "Content-Length: " << strMsg.size() << "\r\n"
-      << "Connection: close\r\n"
+      << "Connection: keep-alive\r\n"
       << "Accept: application/json\r\n";
     BOOST_FOREACH(const PAIRTYPE(string, string)& item, mapRequestHeaders)
         s << item.first << ": " << item.second << "\r\n";
@@ -266,91 +285,230 @@ string HTTPPost(const string& strMsg, const map<string,string>& mapRequestHeader
 }
 
 //******************************************************************************
+// false if peer closed idle connection or sent unexpected data
 //******************************************************************************
-int ReadHTTPStatus(std::basic_istream<char>& stream, int &proto)
+bool isSocketAlive(asio::ip::tcp::socket & socket)
 {
-    string str;
-    getline(stream, str);
-    vector<string> vWords;
-    boost::split(vWords, str, boost::is_any_of(" "));
-    if (vWords.size() < 2)
-        return HTTP_INTERNAL_SERVER_ERROR;
-    proto = 0;
-    const char *ver = strstr(str.c_str(), "HTTP/1.");
-    if (ver != NULL)
-        proto = atoi(ver+7);
-    return atoi(vWords[1].c_str());
+    if (!socket.is_open())
+    {
+        return false;
+    }
+
+    boost::system::error_code error;
+    socket.non_blocking(true, error);
+    if (error)
+    {
+        return false;
+    }
+
+    char ch;
+    socket.read_some(asio::buffer(&ch, 1), error);
+
+    boost::system::error_code ignored;
+    socket.non_blocking(false, ignored);
+
+    return error == asio::error::would_block;
 }
 
 //******************************************************************************
+// persistent connection to wallet, used by one call at a time
 //******************************************************************************
-int ReadHTTPHeader(std::basic_istream<char>& stream, map<string, string>& mapHeadersRet)
+struct RPCConnection
 {
-    int nLen = 0;
-    while (true)
+    asio::io_service                                      io;
+    ssl::context                                          context;
+    asio::ssl::stream<asio::ip::tcp::socket>              sslStream;
+    SSLIOStreamDevice<asio::ip::tcp>                      device;
+
+    // reused by every reply on connection
+    HTTPReply                                             reply;
+
+    posix_time::ptime                                     lastUsed;
+
+    RPCConnection()
+        : context(io, ssl::context::sslv23)
+        , sslStream(io, context)
+        , device(sslStream, false /*GetBoolArg("-rpcssl")*/)
     {
-        string str;
-        std::getline(stream, str);
-        if (str.empty() || str == "\r")
-            break;
-        string::size_type nColon = str.find(":");
-        if (nColon != string::npos)
-        {
-            string strHeader = str.substr(0, nColon);
-            boost::trim(strHeader);
-            boost::to_lower(strHeader);
-            string strValue = str.substr(nColon+1);
-            boost::trim(strValue);
-            mapHeadersRet[strHeader] = strValue;
-            if (strHeader == "content-length")
-                nLen = atoi(strValue.c_str());
-        }
+        context.set_options(ssl::context::no_sslv2);
     }
-    return nLen;
-}
+
+    bool isAlive()
+    {
+        return isSocketAlive(sslStream.next_layer());
+    }
+};
+
+typedef boost::shared_ptr<RPCConnection> RPCConnectionPtr;
 
 //******************************************************************************
+// keep-alive connections of one wallet
+//
+// idle connections checked before reuse, dropped after idleTimeout.
+// failed connect delays next attempt, 1 s doubled up to maxBackoff,
+// calls in backoff fail without connecting
 //******************************************************************************
-int ReadHTTP(std::basic_istream<char>& stream, map<string, string>& mapHeadersRet, string& strMessageRet)
+class RPCConnectionPool
 {
-    mapHeadersRet.clear();
-    strMessageRet = "";
+public:
+    enum
+    {
+        maxIdle     = 4,
+        // seconds
+        idleTimeout = 15,
+        maxBackoff  = 30
+    };
+
+public:
+    RPCConnectionPool(const std::string & ip, const std::string & port)
+        : m_ip(ip)
+        , m_port(port)
+        , m_failures(0)
+        , m_nextAttempt(posix_time::neg_infin)
+    {
+    }
+
+    // idle connection or new one, throws if not connected
+    RPCConnectionPtr acquire()
+    {
+        posix_time::ptime now = posix_time::microsec_clock::universal_time();
+
+        {
+            boost::mutex::scoped_lock l(m_lock);
+
+            while (!m_idle.empty())
+            {
+                RPCConnectionPtr conn = m_idle.back();
+                m_idle.pop_back();
+
+                if ((now - conn->lastUsed).total_seconds() < idleTimeout && conn->isAlive())
+                {
+                    return conn;
+                }
+            }
+
+            if (now < m_nextAttempt)
+            {
+                throw runtime_error("couldn't connect to server, retry later");
+            }
+        }
 
-    // Read status
-    int nProto = 0;
-    int nStatus = ReadHTTPStatus(stream, nProto);
+        RPCConnectionPtr conn(new RPCConnection);
+        bool connected = conn->device.connect(m_ip, m_port);
 
-    // Read header
-    int nLen = ReadHTTPHeader(stream, mapHeadersRet);
-    if (nLen < 0 || nLen > (int)MAX_SIZE)
-        return HTTP_INTERNAL_SERVER_ERROR;
+        posix_time::ptime end = posix_time::microsec_clock::universal_time();
+        boost::uint64_t elapsed = (end - now).total_milliseconds();
+
+        boost::mutex::scoped_lock l(m_lock);
+
+        if (!connected)
+        {
+            ++m_stat.connectFailures;
+
+            unsigned int delay = m_failures < 5 ? 1u << m_failures : static_cast<unsigned int>(maxBackoff);
+            m_nextAttempt = end + posix_time::seconds(std::min<unsigned int>(delay, maxBackoff));
+            ++m_failures;
+
+            throw runtime_error("couldn't connect to server");
+        }
+
+        m_failures = 0;
+
+        ++m_stat.connects;
+        m_stat.totalConnectTime += elapsed;
+        m_stat.maxConnectTime = std::max(m_stat.maxConnectTime, elapsed);
+
+        return conn;
+    }
+
+    // back to pool if connection may be reused
+    void release(RPCConnectionPtr conn, const bool keepAlive, const boost::uint64_t elapsed)
+    {
+        conn->lastUsed = posix_time::microsec_clock::universal_time();
+
+        boost::mutex::scoped_lock l(m_lock);
+
+        ++m_stat.requests;
+        m_stat.totalRequestTime += elapsed;
+        m_stat.maxRequestTime = std::max(m_stat.maxRequestTime, elapsed);
+
+        if (keepAlive && m_idle.size() < maxIdle)
+        {
+            m_idle.push_back(conn);
+        }
+    }
 
-    // Read message
-    if (nLen > 0)
+    ConnectionStat stat() const
     {
-        vector<char> vch(nLen);
-        stream.read(&vch[0], nLen);
-        strMessageRet = string(vch.begin(), vch.end());
+        boost::mutex::scoped_lock l(m_lock);
+        return m_stat;
     }
 
-    string sConHdr = mapHeadersRet["connection"];
+private:
+    const std::string             m_ip;
+    const std::string             m_port;
+
+    mutable boost::mutex          m_lock;
+    std::vector<RPCConnectionPtr> m_idle;
+
+    unsigned int                  m_failures;
+    posix_time::ptime             m_nextAttempt;
+
+    ConnectionStat                m_stat;
+};
+
+typedef boost::shared_ptr<RPCConnectionPool> RPCConnectionPoolPtr;
 
-    if ((sConHdr != "close") && (sConHdr != "keep-alive"))
+//******************************************************************************
+// one pool per wallet endpoint, created on first call
+//******************************************************************************
+boost::mutex                                 poolsLock;
+std::map<std::string, RPCConnectionPoolPtr>  pools;
+
+RPCConnectionPoolPtr connectionPool(const std::string & rpcip, const std::string & rpcport)
+{
+    boost::mutex::scoped_lock l(poolsLock);
+
+    RPCConnectionPoolPtr & pool = pools[rpcip + ':' + rpcport];
+    if (!pool)
     {
-        if (nProto >= 1)
-            mapHeadersRet["connection"] = "keep-alive";
-        else
-            mapHeadersRet["connection"] = "close";
+        pool.reset(new RPCConnectionPool(rpcip, rpcport));
+    }
+    return pool;
+}
+
+//******************************************************************************
+//******************************************************************************
+std::string dumpConnectionStat()
+{
+    std::vector<std::pair<std::string, RPCConnectionPoolPtr> > snapshot;
+    {
+        boost::mutex::scoped_lock l(poolsLock);
+        snapshot.assign(pools.begin(), pools.end());
     }
 
-    return nStatus;
+    std::ostringstream o;
+    for (std::vector<std::pair<std::string, RPCConnectionPoolPtr> >::iterator i = snapshot.begin(); i != snapshot.end(); ++i)
+    {
+        ConnectionStat s = i->second->stat();
+        o << i->first
+          << " connects " << s.connects << " (failed " << s.connectFailures << ")"
+          << " connect avg " << s.avgConnectTime() << "ms max " << s.maxConnectTime << "ms"
+          << " requests " << s.requests
+          << " request avg " << s.avgRequestTime() << "ms max " << s.maxRequestTime << "ms"
+          << std::endl;
+    }
+    return o.str();
 }
 
 //******************************************************************************
+// send request, single call or batch, parse(begin, end) called for body
+// while body is in buffer of connection
 //******************************************************************************
-Object CallRPC(const std::string & rpcuser, const std::string & rpcpasswd,
-               const std::string & rpcip, const std::string & rpcport,
-               const std::string & strMethod, const Array & params)
+template <typename PARSE>
+void CallRPCRequest(const std::string & rpcuser, const std::string & rpcpasswd,
+                    const std::string & rpcip, const std::string & rpcport,
+                    const std::string & strRequest, PARSE & parse)
 {
 //    if (mapArgs["-rpcuser"] == "" && mapArgs["-rpcpassword"] == "")
 //        throw runtime_error(strprintf(
@@ -358,16 +516,11 @@ Object CallRPC(const std::string & rpcuser, const std::string & rpcpasswd,
 //              "If the file does not exist, create it with owner-readable-only file permissions."),
 //                GetConfigFile().string().c_str()));
 
-    // Connect to localhost
-    bool fUseSSL = false;//GetBoolArg("-rpcssl");
-    asio::io_service io_service;
-    ssl::context context(io_service, ssl::context::sslv23);
-    context.set_options(ssl::context::no_sslv2);
-    asio::ssl::stream<asio::ip::tcp::socket> sslStream(io_service, context);
-    SSLIOStreamDevice<asio::ip::tcp> d(sslStream, fUseSSL);
-    iostreams::stream< SSLIOStreamDevice<asio::ip::tcp> > stream(d);
-    if (!d.connect(rpcip, rpcport))
-        throw runtime_error("couldn't connect to server");
+    // Connect to wallet, connection dropped on exception
+    RPCConnectionPoolPtr pool = connectionPool(rpcip, rpcport);
+    RPCConnectionPtr conn = pool->acquire();
+
+    posix_time::ptime start = posix_time::microsec_clock::universal_time();
 
     // HTTP basic authentication
     string strUserPass64 = util::base64_encode(rpcuser + ":" + rpcpasswd);
@@ -375,25 +528,66 @@ Object CallRPC(const std::string & rpcuser, const std::string & rpcpasswd,
     mapRequestHeaders["Authorization"] = string("Basic ") + strUserPass64;
 
     // Send request
-    string strRequest = JSONRPCRequest(strMethod, params, 1);
     string strPost = HTTPPost(strRequest, mapRequestHeaders);
-    stream << strPost << std::flush;
+    conn->device.write(strPost.data(), strPost.size());
 
     // Receive reply
-    map<string, string> mapHeaders;
-    string strReply;
-    int nStatus = ReadHTTP(stream, mapHeaders, strReply);
+    HTTPReply & reply = conn->reply;
+    reply.reset();
+
+    HTTPReply::State state = HTTPReply::incomplete;
+    while (state == HTTPReply::incomplete)
+    {
+        std::size_t size;
+        char * buffer = reply.prepare(size);
+        state = reply.commit(conn->device.read(buffer, size));
+    }
+    if (state != HTTPReply::complete)
+        throw runtime_error("bad reply from server");
+
+    int nStatus = reply.status();
     if (nStatus == HTTP_UNAUTHORIZED)
         throw runtime_error("incorrect rpcuser or rpcpassword (authorization failed)");
     else if (nStatus >= 400 && nStatus != HTTP_BAD_REQUEST && nStatus != HTTP_NOT_FOUND && nStatus != HTTP_INTERNAL_SERVER_ERROR)
         throw runtime_error(strprintf("server returned HTTP error %d", nStatus));
-    else if (strReply.empty())
+    else if (reply.bodySize() == 0)
         throw runtime_error("no response from server");
 
     // Parse reply
-    Value valReply;
-    if (!read_string(strReply, valReply))
-        throw runtime_error("couldn't parse reply from server");
+    parse(reply.body(), reply.body() + reply.bodySize());
+
+    pool->release(conn, reply.keepAlive(),
+                  (posix_time::microsec_clock::universal_time() - start).total_milliseconds());
+}
+
+//******************************************************************************
+// reply into json_spirit tree
+//******************************************************************************
+struct ValueReply
+{
+    Value value;
+
+    void operator()(const char * begin, const char * end)
+    {
+        if (!read_string(std::string(begin, end), value))
+            throw runtime_error("couldn't parse reply from server");
+    }
+};
+
+//******************************************************************************
+//******************************************************************************
+Object CallRPC(const std::string & rpcuser, const std::string & rpcpasswd,
+               const std::string & rpcip, const std::string & rpcport,
+               const std::string & strMethod, const Array & params)
+{
+    ValueReply parse;
+    CallRPCRequest(rpcuser, rpcpasswd, rpcip, rpcport,
+                   JSONRPCRequest(strMethod, params, 1), parse);
+
+    const Value & valReply = parse.value;
+    if (valReply.type() != obj_type)
+        throw runtime_error("expected reply to be an object");
+
     const Object& reply = valReply.get_obj();
     if (reply.empty())
         throw runtime_error("expected reply to have result, error and id properties");
@@ -401,6 +595,61 @@ Object CallRPC(const std::string & rpcuser, const std::string & rpcpasswd,
     return reply;
 }
 
+//******************************************************************************
+// calls in one request, json-rpc 2.0 batch.
+// replies in order of calls, correlated by id (index of call),
+// reply of call missing in batch reply is empty
+//******************************************************************************
+typedef std::pair<std::string, Array> RPCCall;
+
+string JSONRPCBatchRequest(const std::vector<RPCCall> & calls)
+{
+    Array batch;
+    for (std::size_t i = 0; i < calls.size(); ++i)
+    {
+        Object request;
+        request.push_back(Pair("jsonrpc", "2.0"));
+        request.push_back(Pair("method", calls[i].first));
+        request.push_back(Pair("params", calls[i].second));
+        request.push_back(Pair("id", static_cast<int>(i)));
+        batch.push_back(request);
+    }
+    return write_string(Value(batch), false) + "\n";
+}
+
+std::vector<Object> CallBatchRPC(const std::string & rpcuser, const std::string & rpcpasswd,
+                                 const std::string & rpcip, const std::string & rpcport,
+                                 const std::vector<RPCCall> & calls)
+{
+    std::vector<Object> replies(calls.size());
+    if (calls.empty())
+        return replies;
+
+    ValueReply parse;
+    CallRPCRequest(rpcuser, rpcpasswd, rpcip, rpcport,
+                   JSONRPCBatchRequest(calls), parse);
+
+    const Value & valReply = parse.value;
+    if (valReply.type() != array_type)
+        throw runtime_error("expected batch reply to be an array");
+
+    const Array & arr = valReply.get_array();
+    for (const Value & v : arr)
+    {
+        if (v.type() != obj_type)
+            continue;
+
+        const Value & id = find_value(v.get_obj(), "id");
+        if (id.type() != int_type || id.get_int() < 0 ||
+                static_cast<std::size_t>(id.get_int()) >= replies.size())
+            continue;
+
+        replies[id.get_int()] = v.get_obj();
+    }
+
+    return replies;
+}
+
 //*****************************************************************************
 //*****************************************************************************
 bool listaccounts(const std::string & rpcuser, const std::string & rpcpasswd,
@@ -455,49 +704,61 @@ bool listaccounts(const std::string & rpcuser, const std::string & rpcpasswd,
 }
 
 //*****************************************************************************
+// addresses of all accounts, one batch request
 //*****************************************************************************
-bool getaddressesbyaccount(const std::string & rpcuser, const std::string & rpcpasswd,
-                           const std::string & rpcip, const std::string & rpcport,
-                           const std::string & account,
-                           std::vector<std::string> & addresses)
+bool getaddressesbyaccounts(const std::string & rpcuser, const std::string & rpcpasswd,
+                            const std::string & rpcip, const std::string & rpcport,
+                            const std::vector<std::string> & accounts,
+                            std::vector<AddressBookEntry> & entries)
 {
     try
     {
-        // LOG() << "rpc call <getaddressesbyaccount>";
-
-        Array params;
-        params.push_back(account);
-        Object reply = CallRPC(rpcuser, rpcpasswd, rpcip, rpcport,
-                               "getaddressesbyaccount", params);
+        // LOG() << "rpc call <getaddressesbyaccount> x " << accounts.size();
 
-        // Parse reply
-        const Value & result = find_value(reply, "result");
-        const Value & error  = find_value(reply, "error");
-
-        if (error.type() != null_type)
-        {
-            // Error
-            LOG() << "error: " << write_string(error, false);
-            // int code = find_value(error.get_obj(), "code").get_int();
-            return false;
-        }
-        else if (result.type() != array_type)
+        std::vector<RPCCall> calls;
+        for (const std::string & account : accounts)
         {
-            // Result
-            LOG() << "result not an array " <<
-                     (result.type() == null_type ? "" :
-                      result.type() == str_type  ? result.get_str() :
-                                                   write_string(result, true));
-            return false;
+            Array params;
+            params.push_back(account);
+            calls.push_back(RPCCall("getaddressesbyaccount", params));
         }
 
-        Array arr = result.get_array();
-        for (const Value & v : arr)
+        std::vector<Object> replies = CallBatchRPC(rpcuser, rpcpasswd, rpcip, rpcport, calls);
+
+        for (std::size_t i = 0; i < replies.size(); ++i)
         {
-            if (v.type() == str_type)
+            // Parse reply
+            const Value & result = find_value(replies[i], "result");
+            const Value & error  = find_value(replies[i], "error");
+
+            if (error.type() != null_type)
+            {
+                // Error
+                LOG() << "error: " << write_string(error, false);
+                continue;
+            }
+            else if (result.type() != array_type)
+            {
+                // Result
+                LOG() << "result not an array " <<
+                         (result.type() == null_type ? "" :
+                          result.type() == str_type  ? result.get_str() :
+                                                       write_string(result, true));
+                continue;
+            }
+
+            std::vector<std::string> addresses;
+
+            Array arr = result.get_array();
+            for (const Value & v : arr)
             {
-                addresses.push_back(v.get_str());
+                if (v.type() == str_type)
+                {
+                    addresses.push_back(v.get_str());
+                }
             }
+
+            entries.push_back(std::make_pair(accounts[i], addresses));
         }
     }
     catch (std::exception & e)
@@ -521,82 +782,131 @@ bool requestAddressBook(const std::string & rpcuser, const std::string & rpcpass
         return false;
     }
     // LOG() << "received " << accounts.size() << " accounts";
-    for (std::string & acc : accounts)
+
+    return getaddressesbyaccounts(rpcuser, rpcpasswd, rpcip, rpcport, accounts, entries);
+}
+
+//*****************************************************************************
+// code of error object, 0 if none
+//*****************************************************************************
+int readErrorCode(const char * begin, const char * end)
+{
+    JSONReader reader(begin, end);
+
+    int code = 0;
+
+    std::string name;
+    if (!reader.beginObject())
     {
-        std::vector<std::string> addrs;
-        if (getaddressesbyaccount(rpcuser, rpcpasswd, rpcip, rpcport, acc, addrs))
+        return code;
+    }
+
+    while (reader.nextMember(name))
+    {
+        if (name == "code")
+        {
+            reader.readInt(code);
+        }
+        else
         {
-            entries.push_back(std::make_pair(acc, addrs));
-            // LOG() << acc << " - " << boost::algorithm::join(addrs, ",");
+            reader.skipValue();
         }
     }
 
-    return true;
+    return code;
 }
 
 //*****************************************************************************
+// reply member "error", logged if not null, code returned if asked
 //*****************************************************************************
-bool listUnspent(const std::string & rpcuser,
-                 const std::string & rpcpasswd,
-                 const std::string & rpcip,
-                 const std::string & rpcport,
-                 std::vector<Unspent> & entries)
+bool readReplyError(JSONReader & reader, int * code = 0)
 {
-    const static std::string txid("txid");
-    const static std::string vout("vout");
-    const static std::string amount("amount");
+    if (reader.isNull())
+    {
+        return reader.readNull();
+    }
 
-    try
+    const char * begin = 0;
+    const char * end   = 0;
+    if (reader.skipValue(&begin, &end))
     {
-        LOG() << "rpc call <listunspent>";
+        // Error
+        LOG() << "error: " << std::string(begin, end);
 
-        Array params;
-        Object reply = CallRPC(rpcuser, rpcpasswd, rpcip, rpcport,
-                               "listunspent", params);
+        if (code)
+        {
+            *code = readErrorCode(begin, end);
+        }
+    }
+    return false;
+}
 
-        // Parse reply
-        const Value & result = find_value(reply, "result");
-        const Value & error  = find_value(reply, "error");
+//*****************************************************************************
+// listunspent reply read directly into entries, no json tree
+//*****************************************************************************
+bool parseUnspent(const char * begin, const char * end, std::vector<Unspent> & entries)
+{
+    JSONReader reader(begin, end);
 
-        if (error.type() != null_type)
+    bool haveResult = false;
+
+    std::string name;
+    if (!reader.beginObject())
+    {
+        LOG() << "reply not an object";
+        return false;
+    }
+
+    while (reader.nextMember(name))
+    {
+        if (name == "error")
         {
-            // Error
-            LOG() << "error: " << write_string(error, false);
-            // int code = find_value(error.get_obj(), "code").get_int();
-            return false;
+            if (!readReplyError(reader))
+            {
+                return false;
+            }
         }
-        else if (result.type() != array_type)
+        else if (name == "result")
         {
-            // Result
-            LOG() << "result not an array " <<
-                     (result.type() == null_type ? "" :
-                      result.type() == str_type  ? result.get_str() :
-                                                   write_string(result, true));
-            return false;
-        }
+            if (!reader.beginArray())
+            {
+                // Result
+                LOG() << "result not an array";
+                return false;
+            }
 
-        Array arr = result.get_array();
-        for (const Value & v : arr)
-        {
-            if (v.type() == obj_type)
+            while (reader.nextElement())
             {
+                // not an output, skipped as before
+                if (!reader.isObject())
+                {
+                    reader.skipValue();
+                    continue;
+                }
+
+                reader.beginObject();
 
                 Unspent u;
+                u.vout   = 0;
+                u.amount = 0;
 
-                Object o = v.get_obj();
-                for (const auto & v : o)
+                while (reader.nextMember(name))
                 {
-                    if (v.name_ == txid)
+                    if (name == "txid")
+                    {
+                        reader.readString(u.txId);
+                    }
+                    else if (name == "vout")
                     {
-                        u.txId = v.value_.get_str();
+                        reader.readInt(u.vout);
                     }
-                    else if (v.name_ == vout)
+                    else if (name == "amount")
                     {
-                        u.vout = v.value_.get_int();
+                        reader.readDouble(u.amount);
                     }
-                    else if (v.name_ == amount)
+                    else
                     {
-                        u.amount = v.value_.get_real();
+                        reader.skipValue();
                     }
                 }
 
@@ -605,39 +915,88 @@ bool listUnspent(const std::string & rpcuser,
                     entries.push_back(u);
                 }
             }
+
+            haveResult = true;
+        }
+        else
+        {
+            reader.skipValue();
         }
     }
-    catch (std::exception & e)
+
+    if (!reader.ok())
     {
-        LOG() << "requestAddressBook exception " << e.what();
+        LOG() << "couldn't parse reply from server";
         return false;
     }
 
-    return true;
+    return haveResult;
 }
 
 //*****************************************************************************
 //*****************************************************************************
-bool signRawTransaction(const std::string & rpcuser,
-                        const std::string & rpcpasswd,
-                        const std::string & rpcip,
-                        const std::string & rpcport,
-                        std::string & rawtx)
+struct UnspentReply
 {
-    try
-    {
-        LOG() << "rpc call <signrawtransaction>";
+    std::vector<Unspent> & entries;
+    bool                   result;
 
-        Array params;
-        params.push_back(rawtx);
-        Object reply = CallRPC(rpcuser, rpcpasswd, rpcip, rpcport,
-                               "signrawtransaction", params);
+    explicit UnspentReply(std::vector<Unspent> & e) : entries(e), result(false) {}
 
-        // Parse reply
-        const Value & result = find_value(reply, "result");
-        const Value & error  = find_value(reply, "error");
+    void operator()(const char * begin, const char * end)
+    {
+        result = parseUnspent(begin, end, entries);
+    }
+};
 
-        if (error.type() != null_type)
+//*****************************************************************************
+//*****************************************************************************
+bool listUnspent(const std::string & rpcuser,
+                 const std::string & rpcpasswd,
+                 const std::string & rpcip,
+                 const std::string & rpcport,
+                 std::vector<Unspent> & entries)
+{
+    try
+    {
+        LOG() << "rpc call <listunspent>";
+
+        UnspentReply parse(entries);
+        CallRPCRequest(rpcuser, rpcpasswd, rpcip, rpcport,
+                       JSONRPCRequest("listunspent", Array(), 1), parse);
+
+        return parse.result;
+    }
+    catch (std::exception & e)
+    {
+        LOG() << "listunspent exception " << e.what();
+        return false;
+    }
+
+    return true;
+}
+
+//*****************************************************************************
+//*****************************************************************************
+bool signRawTransaction(const std::string & rpcuser,
+                        const std::string & rpcpasswd,
+                        const std::string & rpcip,
+                        const std::string & rpcport,
+                        std::string & rawtx)
+{
+    try
+    {
+        LOG() << "rpc call <signrawtransaction>";
+
+        Array params;
+        params.push_back(rawtx);
+        Object reply = CallRPC(rpcuser, rpcpasswd, rpcip, rpcport,
+                               "signrawtransaction", params);
+
+        // Parse reply
+        const Value & result = find_value(reply, "result");
+        const Value & error  = find_value(reply, "error");
+
+        if (error.type() != null_type)
         {
             // Error
             LOG() << "error: " << write_string(error, false);
@@ -715,6 +1074,64 @@ bool sendRawTransaction(const std::string & rpcuser,
     return true;
 }
 
+//*****************************************************************************
+//*****************************************************************************
+bool parseNewAddress(const char * begin, const char * end, std::string & addr)
+{
+    JSONReader reader(begin, end);
+
+    bool haveResult = false;
+
+    std::string name;
+    if (!reader.beginObject())
+    {
+        LOG() << "reply not an object";
+        return false;
+    }
+
+    while (reader.nextMember(name))
+    {
+        if (name == "error")
+        {
+            if (!readReplyError(reader))
+            {
+                return false;
+            }
+        }
+        else if (name == "result")
+        {
+            if (!reader.readString(addr))
+            {
+                // Result
+                LOG() << "result not an string";
+                return false;
+            }
+            haveResult = true;
+        }
+        else
+        {
+            reader.skipValue();
+        }
+    }
+
+    return reader.ok() && haveResult;
+}
+
+//*****************************************************************************
+//*****************************************************************************
+struct NewAddressReply
+{
+    std::string & addr;
+    bool          result;
+
+    explicit NewAddressReply(std::string & a) : addr(a), result(false) {}
+
+    void operator()(const char * begin, const char * end)
+    {
+        result = parseNewAddress(begin, end, addr);
+    }
+};
+
 //*****************************************************************************
 //*****************************************************************************
 bool getNewAddress(const std::string & rpcuser,
@@ -727,36 +1144,72 @@ bool getNewAddress(const std::string & rpcuser,
     {
         LOG() << "rpc call <getnewaddress>";
 
-        Array params;
-        Object reply = CallRPC(rpcuser, rpcpasswd, rpcip, rpcport,
-                               "getnewaddress", params);
+        NewAddressReply parse(addr);
+        CallRPCRequest(rpcuser, rpcpasswd, rpcip, rpcport,
+                       JSONRPCRequest("getnewaddress", Array(), 1), parse);
 
-        // Parse reply
-        const Value & result = find_value(reply, "result");
-        const Value & error  = find_value(reply, "error");
+        return parse.result;
+    }
+    catch (std::exception & e)
+    {
+        LOG() << "getnewaddress exception " << e.what();
+        return false;
+    }
 
-        if (error.type() != null_type)
+    return true;
+}
+
+//*****************************************************************************
+// batch reply of getnewaddress calls, failed calls skipped
+//*****************************************************************************
+bool parseNewAddresses(const char * begin, const char * end, std::vector<std::string> & addrs)
+{
+    JSONReader reader(begin, end);
+
+    if (!reader.beginArray())
+    {
+        LOG() << "batch reply not an array";
+        return false;
+    }
+
+    std::string name;
+    while (reader.nextElement())
+    {
+        if (!reader.isObject())
         {
-            // Error
-            LOG() << "error: " << write_string(error, false);
-            // int code = find_value(error.get_obj(), "code").get_int();
-            return false;
+            reader.skipValue();
+            continue;
         }
-        else if (result.type() != str_type)
+
+        reader.beginObject();
+
+        std::string addr;
+        bool failed = false;
+        while (reader.nextMember(name))
         {
-            // Result
-            LOG() << "result not an string " <<
-                     (result.type() == null_type ? "" :
-                      result.type() == str_type  ? result.get_str() :
-                                                   write_string(result, true));
-            return false;
+            if (name == "error")
+            {
+                failed = !readReplyError(reader);
+            }
+            else if (name == "result" && !reader.isNull())
+            {
+                reader.readString(addr);
+            }
+            else
+            {
+                reader.skipValue();
+            }
         }
 
-        addr = result.get_str();
+        if (!failed && !addr.empty())
+        {
+            addrs.push_back(addr);
+        }
     }
-    catch (std::exception & e)
+
+    if (!reader.ok())
     {
-        LOG() << "signrawtransaction exception " << e.what();
+        LOG() << "couldn't parse reply from server";
         return false;
     }
 
@@ -806,7 +1259,7 @@ bool getTransaction(const std::string & rpcuser,
     }
     catch (std::exception & e)
     {
-        LOG() << "signrawtransaction exception " << e.what();
+        LOG() << "gettransaction exception " << e.what();
         return false;
     }
 
@@ -814,4 +1267,624 @@ bool getTransaction(const std::string & rpcuser,
 
 }
 
+//*****************************************************************************
+//*****************************************************************************
+bool getTransactions(const std::string & rpcuser,
+                     const std::string & rpcpasswd,
+                     const std::string & rpcip,
+                     const std::string & rpcport,
+                     const std::vector<std::string> & txids,
+                     std::vector<std::string> & found)
+{
+    try
+    {
+        LOG() << "rpc call <gettransaction> x " << txids.size();
+
+        std::vector<RPCCall> calls;
+        for (const std::string & txid : txids)
+        {
+            Array params;
+            params.push_back(txid);
+            calls.push_back(RPCCall("gettransaction", params));
+        }
+
+        std::vector<Object> replies = CallBatchRPC(rpcuser, rpcpasswd, rpcip, rpcport, calls);
+
+        for (std::size_t i = 0; i < replies.size(); ++i)
+        {
+            // not in wallet yet if error
+            const Value & result = find_value(replies[i], "result");
+            const Value & error  = find_value(replies[i], "error");
+
+            if (error.type() == null_type && result.type() == obj_type)
+            {
+                found.push_back(txids[i]);
+            }
+        }
+    }
+    catch (std::exception & e)
+    {
+        LOG() << "gettransaction exception " << e.what();
+        return false;
+    }
+
+    return true;
+}
+
+//*****************************************************************************
+// listsinceblock reply, txids of transactions and last block
+//*****************************************************************************
+bool parseSinceBlock(const char * begin, const char * end,
+                     std::vector<std::string> & txids, std::string & lastBlock,
+                     int & errorCode)
+{
+    JSONReader reader(begin, end);
+
+    bool haveResult = false;
+
+    std::string name;
+    if (!reader.beginObject())
+    {
+        LOG() << "reply not an object";
+        return false;
+    }
+
+    while (reader.nextMember(name))
+    {
+        if (name == "error")
+        {
+            if (!readReplyError(reader, &errorCode))
+            {
+                return false;
+            }
+        }
+        else if (name == "result")
+        {
+            if (!reader.beginObject())
+            {
+                // Result
+                LOG() << "result not an object";
+                return false;
+            }
+
+            while (reader.nextMember(name))
+            {
+                if (name == "transactions")
+                {
+                    if (!reader.beginArray())
+                    {
+                        return false;
+                    }
+
+                    while (reader.nextElement())
+                    {
+                        if (!reader.isObject())
+                        {
+                            reader.skipValue();
+                            continue;
+                        }
+
+                        reader.beginObject();
+
+                        std::string txid;
+                        while (reader.nextMember(name))
+                        {
+                            if (name == "txid")
+                            {
+                                reader.readString(txid);
+                            }
+                            else
+                            {
+                                reader.skipValue();
+                            }
+                        }
+
+                        if (!txid.empty())
+                        {
+                            txids.push_back(txid);
+                        }
+                    }
+                }
+                else if (name == "lastblock")
+                {
+                    reader.readString(lastBlock);
+                }
+                else
+                {
+                    reader.skipValue();
+                }
+            }
+
+            haveResult = true;
+        }
+        else
+        {
+            reader.skipValue();
+        }
+    }
+
+    if (!reader.ok())
+    {
+        LOG() << "couldn't parse reply from server";
+        return false;
+    }
+
+    return haveResult && !lastBlock.empty();
+}
+
+//*****************************************************************************
+//*****************************************************************************
+struct SinceBlockReply
+{
+    std::vector<std::string> & txids;
+    std::string &              lastBlock;
+    int                        errorCode;
+    bool                       result;
+
+    SinceBlockReply(std::vector<std::string> & t, std::string & l)
+        : txids(t), lastBlock(l), errorCode(0), result(false) {}
+
+    void operator()(const char * begin, const char * end)
+    {
+        result = parseSinceBlock(begin, end, txids, lastBlock, errorCode);
+    }
+};
+
+//*****************************************************************************
+//*****************************************************************************
+bool listSinceBlock(const std::string & rpcuser,
+                    const std::string & rpcpasswd,
+                    const std::string & rpcip,
+                    const std::string & rpcport,
+                    const std::string & blockHash,
+                    const unsigned int targetConfirmations,
+                    std::vector<std::string> & txids,
+                    std::string & lastBlock,
+                    bool & blockNotFound)
+{
+    blockNotFound = false;
+
+    try
+    {
+        LOG() << "rpc call <listsinceblock>";
+
+        Array params;
+        params.push_back(blockHash);
+        params.push_back(static_cast<int>(targetConfirmations));
+
+        SinceBlockReply parse(txids, lastBlock);
+        CallRPCRequest(rpcuser, rpcpasswd, rpcip, rpcport,
+                       JSONRPCRequest("listsinceblock", params, 1), parse);
+
+        blockNotFound = !blockHash.empty() &&
+                        parse.errorCode == RPC_INVALID_ADDRESS_OR_KEY;
+
+        return parse.result;
+    }
+    catch (std::exception & e)
+    {
+        LOG() << "listsinceblock exception " << e.what();
+        return false;
+    }
+
+    return true;
+}
+
+//******************************************************************************
+// io thread of asynchronous calls, started on first call
+//******************************************************************************
+class AsyncService
+{
+public:
+    AsyncService()
+        : m_work(m_io)
+        , m_thread(boost::bind(&asio::io_service::run, &m_io))
+    {
+    }
+
+    ~AsyncService()
+    {
+        m_io.stop();
+        m_thread.join();
+    }
+
+    asio::io_service & io() { return m_io; }
+
+private:
+    asio::io_service        m_io;
+    asio::io_service::work  m_work;
+    boost::thread           m_thread;
+};
+
+boost::mutex                    asyncServiceLock;
+boost::scoped_ptr<AsyncService> asyncService;
+
+asio::io_service & asyncIo()
+{
+    boost::mutex::scoped_lock l(asyncServiceLock);
+    if (!asyncService)
+    {
+        asyncService.reset(new AsyncService);
+    }
+    return asyncService->io();
+}
+
+//******************************************************************************
+//******************************************************************************
+// body of reply valid during call only
+typedef boost::function<void (const std::string & error,
+                              const char * begin, const char * end)> AsyncHandler;
+typedef boost::shared_ptr<asio::ip::tcp::socket> SocketPtr;
+
+class AsyncCall;
+typedef boost::shared_ptr<AsyncCall> AsyncCallPtr;
+
+class AsyncWallet;
+typedef boost::shared_ptr<AsyncWallet> AsyncWalletPtr;
+
+//******************************************************************************
+// one call, resolve, connect, write request, read reply.
+// runs on io thread only, completed once by reply, error or timeout
+//******************************************************************************
+class AsyncCall : public boost::enable_shared_from_this<AsyncCall>
+{
+    friend class AsyncWallet;
+
+public:
+    AsyncCall(asio::io_service & io,
+              const std::string & request,
+              const AsyncHandler & handler,
+              const unsigned int timeout)
+        : m_io(io)
+        , m_resolver(io)
+        , m_timer(io)
+        , m_request(request)
+        , m_handler(handler)
+        , m_timeout(timeout)
+        , m_done(false)
+    {
+    }
+
+private:
+    // timeout counted from submit, queued call may expire
+    void arm()
+    {
+        m_timer.expires_from_now(posix_time::seconds(m_timeout));
+        m_timer.async_wait(boost::bind(&AsyncCall::onTimeout, shared_from_this(),
+                                       asio::placeholders::error));
+    }
+
+    void start(AsyncWalletPtr wallet, SocketPtr idle,
+               const std::string & ip, const std::string & port);
+
+    void onTimeout(const boost::system::error_code & error)
+    {
+        if (error != asio::error::operation_aborted)
+        {
+            complete("timeout");
+        }
+    }
+
+    void onResolve(const boost::system::error_code & error,
+                   asio::ip::tcp::resolver::iterator endpoint)
+    {
+        if (m_done)
+            return;
+        if (error)
+            return complete("couldn't resolve server");
+
+        asio::async_connect(*m_socket, endpoint,
+                            boost::bind(&AsyncCall::onConnect, shared_from_this(),
+                                        asio::placeholders::error));
+    }
+
+    void onConnect(const boost::system::error_code & error)
+    {
+        if (m_done)
+            return;
+        if (error)
+            return complete("couldn't connect to server");
+
+        write();
+    }
+
+    void write()
+    {
+        asio::async_write(*m_socket, asio::buffer(m_request),
+                          boost::bind(&AsyncCall::onWrite, shared_from_this(),
+                                      asio::placeholders::error));
+    }
+
+    void onWrite(const boost::system::error_code & error)
+    {
+        if (m_done)
+            return;
+        if (error)
+            return complete("couldn't send request");
+
+        read();
+    }
+
+    void read()
+    {
+        std::size_t size;
+        char * buffer = m_reply.prepare(size);
+
+        m_socket->async_read_some(asio::buffer(buffer, size),
+                                  boost::bind(&AsyncCall::onRead, shared_from_this(),
+                                              asio::placeholders::error,
+                                              asio::placeholders::bytes_transferred));
+    }
+
+    void onRead(const boost::system::error_code & error, const std::size_t size)
+    {
+        if (m_done)
+            return;
+        if (error)
+            return complete("no response from server");
+
+        HTTPReply::State state = m_reply.commit(size);
+        if (state == HTTPReply::incomplete)
+            return read();
+        if (state != HTTPReply::complete)
+            return complete("bad reply from server");
+
+        int nStatus = m_reply.status();
+        if (nStatus == HTTP_UNAUTHORIZED)
+            return complete("incorrect rpcuser or rpcpassword (authorization failed)");
+        else if (nStatus >= 400 && nStatus != HTTP_BAD_REQUEST && nStatus != HTTP_NOT_FOUND && nStatus != HTTP_INTERNAL_SERVER_ERROR)
+            return complete(strprintf("server returned HTTP error %d", nStatus));
+        else if (m_reply.bodySize() == 0)
+            return complete("no response from server");
+
+        complete(std::string(), m_reply.body(), m_reply.body() + m_reply.bodySize());
+    }
+
+    void complete(const std::string & error, const char * begin = 0, const char * end = 0);
+
+private:
+    asio::io_service &          m_io;
+    asio::ip::tcp::resolver     m_resolver;
+    asio::deadline_timer        m_timer;
+    SocketPtr                   m_socket;
+
+    AsyncWalletPtr              m_wallet;
+
+    const std::string           m_request;
+    AsyncHandler                m_handler;
+    const unsigned int          m_timeout;
+
+    HTTPReply                   m_reply;
+
+    bool                        m_done;
+};
+
+//******************************************************************************
+// asynchronous calls of one wallet, io thread only
+//
+// at most maxInFlight calls on wire, rest queued in order.
+// keep-alive sockets reused like connections of RPCConnectionPool
+//******************************************************************************
+class AsyncWallet : public boost::enable_shared_from_this<AsyncWallet>
+{
+public:
+    AsyncWallet(const std::string & ip, const std::string & port)
+        : m_ip(ip)
+        , m_port(port)
+        , m_inFlight(0)
+    {
+    }
+
+    void submit(AsyncCallPtr call)
+    {
+        call->arm();
+
+        if (m_inFlight < maxInFlight)
+        {
+            start(call);
+        }
+        else
+        {
+            m_queue.push_back(call);
+        }
+    }
+
+    // call completed, socket returned if may be reused
+    void finished(SocketPtr socket)
+    {
+        --m_inFlight;
+
+        if (socket && m_idle.size() < RPCConnectionPool::maxIdle)
+        {
+            m_idle.push_back(std::make_pair(posix_time::microsec_clock::universal_time(), socket));
+        }
+
+        while (!m_queue.empty() && m_inFlight < maxInFlight)
+        {
+            AsyncCallPtr call = m_queue.front();
+            m_queue.pop_front();
+
+            // timed out while queued
+            if (!call->m_done)
+            {
+                start(call);
+            }
+        }
+    }
+
+private:
+    void start(AsyncCallPtr call)
+    {
+        ++m_inFlight;
+
+        posix_time::ptime now = posix_time::microsec_clock::universal_time();
+
+        SocketPtr idle;
+        while (!m_idle.empty() && !idle)
+        {
+            std::pair<posix_time::ptime, SocketPtr> i = m_idle.back();
+            m_idle.pop_back();
+
+            if ((now - i.first).total_seconds() < RPCConnectionPool::idleTimeout &&
+                    isSocketAlive(*i.second))
+            {
+                idle = i.second;
+            }
+        }
+
+        call->start(shared_from_this(), idle, m_ip, m_port);
+    }
+
+private:
+    const std::string       m_ip;
+    const std::string       m_port;
+
+    unsigned int            m_inFlight;
+    std::deque<AsyncCallPtr> m_queue;
+
+    std::vector<std::pair<posix_time::ptime, SocketPtr> > m_idle;
+};
+
+//******************************************************************************
+//******************************************************************************
+void AsyncCall::start(AsyncWalletPtr wallet, SocketPtr idle,
+                      const std::string & ip, const std::string & port)
+{
+    m_wallet = wallet;
+
+    if (idle)
+    {
+        m_socket = idle;
+        write();
+        return;
+    }
+
+    m_socket.reset(new asio::ip::tcp::socket(m_io));
+
+    asio::ip::tcp::resolver::query query(ip, port);
+    m_resolver.async_resolve(query,
+                             boost::bind(&AsyncCall::onResolve, shared_from_this(),
+                                         asio::placeholders::error,
+                                         asio::placeholders::iterator));
+}
+
+//******************************************************************************
+//******************************************************************************
+void AsyncCall::complete(const std::string & error, const char * begin, const char * end)
+{
+    if (m_done)
+    {
+        return;
+    }
+    m_done = true;
+
+    boost::system::error_code ignored;
+    m_timer.cancel(ignored);
+    m_resolver.cancel();
+
+    SocketPtr socket;
+    if (m_socket)
+    {
+        if (error.empty() && m_reply.keepAlive())
+        {
+            socket = m_socket;
+        }
+        else
+        {
+            m_socket->close(ignored);
+        }
+    }
+
+    if (!error.empty())
+    {
+        LOG() << "async rpc call failed " << error;
+    }
+
+    m_handler(error, begin, end);
+
+    // not started if timed out while queued
+    if (m_wallet)
+    {
+        AsyncWalletPtr wallet;
+        wallet.swap(m_wallet);
+        wallet->finished(socket);
+    }
+}
+
+//******************************************************************************
+// wallets of asynchronous calls, io thread only
+//******************************************************************************
+std::map<std::string, AsyncWalletPtr> asyncWallets;
+
+void submitAsync(const std::string & rpcip, const std::string & rpcport, AsyncCallPtr call)
+{
+    AsyncWalletPtr & wallet = asyncWallets[rpcip + ':' + rpcport];
+    if (!wallet)
+    {
+        wallet.reset(new AsyncWallet(rpcip, rpcport));
+    }
+    wallet->submit(call);
+}
+
+//******************************************************************************
+//******************************************************************************
+AsyncCallPtr CallRPCAsyncRequest(const std::string & rpcuser, const std::string & rpcpasswd,
+                                 const std::string & rpcip, const std::string & rpcport,
+                                 const std::string & strRequest,
+                                 const AsyncHandler & handler, const unsigned int timeout)
+{
+    map<string, string> mapRequestHeaders;
+    mapRequestHeaders["Authorization"] = string("Basic ") +
+            util::base64_encode(rpcuser + ":" + rpcpasswd);
+
+    asio::io_service & io = asyncIo();
+
+    AsyncCallPtr call(new AsyncCall(io,
+                                    HTTPPost(strRequest, mapRequestHeaders),
+                                    handler, timeout));
+    io.post(boost::bind(&submitAsync, rpcip, rpcport, call));
+    return call;
+}
+
+//******************************************************************************
+// completion handler of address batch, addresses or empty
+//******************************************************************************
+struct AddressesReply
+{
+    AddressesHandler handler;
+
+    explicit AddressesReply(const AddressesHandler & h) : handler(h) {}
+
+    void operator()(const std::string & error, const char * begin, const char * end) const
+    {
+        // error logged by call
+        std::vector<std::string> addrs;
+        if (error.empty() && !parseNewAddresses(begin, end, addrs))
+        {
+            addrs.clear();
+        }
+
+        handler(addrs);
+    }
+};
+
+//*****************************************************************************
+//*****************************************************************************
+void getNewAddressesAsync(const std::string & rpcuser,
+                          const std::string & rpcpasswd,
+                          const std::string & rpcip,
+                          const std::string & rpcport,
+                          const unsigned int count,
+                          const AddressesHandler & handler,
+                          const unsigned int timeout)
+{
+    LOG() << "rpc async batch call <getnewaddress> x " << count;
+
+    std::vector<RPCCall> calls(count, RPCCall("getnewaddress", Array()));
+
+    CallRPCAsyncRequest(rpcuser, rpcpasswd, rpcip, rpcport,
+                        JSONRPCBatchRequest(calls),
+                        AddressesReply(handler), timeout);
+}
+
 } // namespace rpc
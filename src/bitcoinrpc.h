@@ -7,8 +7,34 @@
 #include <vector>
 #include <string>
 
+#include <boost/cstdint.hpp>
+#include <boost/function.hpp>
+
 namespace rpc
 {
+    // keep-alive connections of wallet endpoint
+    struct ConnectionStat
+    {
+        boost::uint64_t connects;
+        boost::uint64_t connectFailures;
+        boost::uint64_t totalConnectTime;   // milliseconds
+        boost::uint64_t maxConnectTime;     // milliseconds
+        boost::uint64_t requests;
+        boost::uint64_t totalRequestTime;   // milliseconds
+        boost::uint64_t maxRequestTime;     // milliseconds
+
+        ConnectionStat()
+            : connects(0), connectFailures(0)
+            , totalConnectTime(0), maxConnectTime(0)
+            , requests(0), totalRequestTime(0), maxRequestTime(0)
+        {}
+
+        boost::uint64_t avgConnectTime() const { return connects ? totalConnectTime / connects : 0; }
+        boost::uint64_t avgRequestTime() const { return requests ? totalRequestTime / requests : 0; }
+    };
+    // all wallet endpoints, one line each
+    std::string dumpConnectionStat();
+
     bool DecodeBase58Check(const char * psz, std::vector<unsigned char> & vchRet);
 
     typedef std::pair<std::string, std::vector<std::string> > AddressBookEntry;
@@ -30,6 +56,28 @@ namespace rpc
                      const std::string & rpcport,
                      std::vector<Unspent> & entries);
 
+    // asynchronous calls, run on rpc io thread which never waits for wallet.
+    // at most maxInFlight calls per wallet on wire, rest queued.
+    // only address pool refill, create step calls are synchronous
+    // (outputs from utxo cache, addresses from pool, sign needs both)
+    enum
+    {
+        maxInFlight  = 4,
+        // seconds
+        asyncTimeout = 30
+    };
+
+    // count getnewaddress calls in one batch request, handler called
+    // on rpc io thread with addresses received, empty on error
+    typedef boost::function<void (const std::vector<std::string> & addresses)> AddressesHandler;
+    void getNewAddressesAsync(const std::string & rpcuser,
+                              const std::string & rpcpasswd,
+                              const std::string & rpcip,
+                              const std::string & rpcport,
+                              const unsigned int count,
+                              const AddressesHandler & handler,
+                              const unsigned int timeout = asyncTimeout);
+
     bool signRawTransaction(const std::string & rpcuser,
                             const std::string & rpcpasswd,
                             const std::string & rpcip,
@@ -55,6 +103,28 @@ namespace rpc
                         const std::string & txid);
                         // std::string & tx);
 
+    // transactions of txids known to wallet, one batch request
+    bool getTransactions(const std::string & rpcuser,
+                         const std::string & rpcpasswd,
+                         const std::string & rpcip,
+                         const std::string & rpcport,
+                         const std::vector<std::string> & txids,
+                         std::vector<std::string> & found);
+
+    // wallet transactions in blocks after blockHash (all if empty) and
+    // in mempool. lastBlock is block with targetConfirmations
+    // confirmations, cursor for next call.
+    // blockNotFound - wallet doesn't know blockHash (reindex, other chain)
+    bool listSinceBlock(const std::string & rpcuser,
+                        const std::string & rpcpasswd,
+                        const std::string & rpcip,
+                        const std::string & rpcport,
+                        const std::string & blockHash,
+                        const unsigned int targetConfirmations,
+                        std::vector<std::string> & txids,
+                        std::string & lastBlock,
+                        bool & blockNotFound);
+
 } // namespace rpc
 
 #endif
@@ -0,0 +1,753 @@
+//******************************************************************************
+//******************************************************************************
+
+#include "rpcparser.h"
+
+#include <cstring>
+#include <cctype>
+#include <cmath>
+#include <algorithm>
+
+namespace rpc
+{
+
+//******************************************************************************
+//******************************************************************************
+namespace
+{
+    // header longer than this is not http reply of wallet
+    const std::size_t maxHeaderSize = 65536;
+
+    bool equalsNoCase(const char * begin, const char * end, const char * literal)
+    {
+        for (; begin != end && *literal; ++begin, ++literal)
+        {
+            if (tolower(static_cast<unsigned char>(*begin)) != *literal)
+            {
+                return false;
+            }
+        }
+        return begin == end && *literal == 0;
+    }
+
+    void trim(const char *& begin, const char *& end)
+    {
+        while (begin != end && (*begin == ' ' || *begin == '\t'))
+        {
+            ++begin;
+        }
+        while (end != begin && (end[-1] == ' ' || end[-1] == '\t' || end[-1] == '\r'))
+        {
+            --end;
+        }
+    }
+
+    // exact powers of ten representable by double
+    const double pow10[] =
+    {
+        1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+
+    void appendUtf8(std::string & str, const unsigned int cp)
+    {
+        if (cp < 0x80)
+        {
+            str += static_cast<char>(cp);
+        }
+        else if (cp < 0x800)
+        {
+            str += static_cast<char>(0xc0 | (cp >> 6));
+            str += static_cast<char>(0x80 | (cp & 0x3f));
+        }
+        else if (cp < 0x10000)
+        {
+            str += static_cast<char>(0xe0 | (cp >> 12));
+            str += static_cast<char>(0x80 | ((cp >> 6) & 0x3f));
+            str += static_cast<char>(0x80 | (cp & 0x3f));
+        }
+        else
+        {
+            str += static_cast<char>(0xf0 | (cp >> 18));
+            str += static_cast<char>(0x80 | ((cp >> 12) & 0x3f));
+            str += static_cast<char>(0x80 | ((cp >> 6) & 0x3f));
+            str += static_cast<char>(0x80 | (cp & 0x3f));
+        }
+    }
+
+    bool readHex4(const char *& pos, const char * end, unsigned int & value)
+    {
+        if (end - pos < 4)
+        {
+            return false;
+        }
+
+        value = 0;
+        for (int i = 0; i < 4; ++i, ++pos)
+        {
+            char c = *pos;
+            value <<= 4;
+            if (c >= '0' && c <= '9')      value |= c - '0';
+            else if (c >= 'a' && c <= 'f') value |= c - 'a' + 10;
+            else if (c >= 'A' && c <= 'F') value |= c - 'A' + 10;
+            else return false;
+        }
+        return true;
+    }
+}
+
+//******************************************************************************
+//******************************************************************************
+HTTPReply::HTTPReply()
+    : m_buffer(chunkSize)
+    , m_size(0)
+    , m_scanned(0)
+    , m_headerDone(false)
+    , m_bodyOffset(0)
+    , m_contentLength(0)
+    , m_status(0)
+    , m_keepAlive(false)
+{
+}
+
+//******************************************************************************
+//******************************************************************************
+void HTTPReply::reset()
+{
+    // bytes of next reply already read
+    std::size_t used = m_headerDone ? m_bodyOffset + m_contentLength : m_size;
+    if (used < m_size)
+    {
+        memmove(&m_buffer[0], &m_buffer[used], m_size - used);
+        m_size -= used;
+    }
+    else
+    {
+        m_size = 0;
+    }
+
+    m_scanned       = 0;
+    m_headerDone    = false;
+    m_bodyOffset    = 0;
+    m_contentLength = 0;
+    m_status        = 0;
+    m_keepAlive     = false;
+}
+
+//******************************************************************************
+//******************************************************************************
+char * HTTPReply::prepare(std::size_t & size)
+{
+    // whole reply at once if length known
+    std::size_t need = m_headerDone ? m_bodyOffset + m_contentLength :
+                                      m_size + chunkSize;
+    if (m_buffer.size() < need)
+    {
+        m_buffer.resize(std::max(need, m_buffer.size() * 2));
+    }
+    else if (m_buffer.size() == m_size)
+    {
+        m_buffer.resize(m_buffer.size() * 2);
+    }
+
+    size = m_buffer.size() - m_size;
+    return &m_buffer[m_size];
+}
+
+//******************************************************************************
+//******************************************************************************
+HTTPReply::State HTTPReply::commit(const std::size_t size)
+{
+    if (size == 0)
+    {
+        // closed before reply completed
+        return invalid;
+    }
+
+    m_size += size;
+
+    if (!m_headerDone)
+    {
+        static const char separator[] = "\r\n\r\n";
+
+        const char * begin = &m_buffer[0];
+        const char * from  = begin + (m_scanned > 3 ? m_scanned - 3 : 0);
+        const char * end   = begin + m_size;
+        const char * found = std::search(from, end, separator, separator + 4);
+        if (found == end)
+        {
+            m_scanned = m_size;
+            return m_size > maxHeaderSize ? invalid : incomplete;
+        }
+
+        State state = parseHeader(found + 4 - begin);
+        if (state != complete)
+        {
+            return state;
+        }
+    }
+
+    return m_size >= m_bodyOffset + m_contentLength ? complete : incomplete;
+}
+
+//******************************************************************************
+// status line and headers, body starts at end
+//******************************************************************************
+HTTPReply::State HTTPReply::parseHeader(const std::size_t end)
+{
+    const char * pos  = &m_buffer[0];
+    const char * last = pos + end;
+
+    // status line, HTTP/1.x NNN text
+    const char * eol = std::find(pos, last, '\n');
+    if (eol - pos < 12 || memcmp(pos, "HTTP/1.", 7) != 0)
+    {
+        return invalid;
+    }
+
+    int proto = pos[7] - '0';
+
+    m_status = 0;
+    for (const char * p = pos + 9; p != eol && *p >= '0' && *p <= '9'; ++p)
+    {
+        m_status = m_status * 10 + (*p - '0');
+    }
+
+    bool haveConnection = false;
+
+    for (pos = eol + 1; pos < last; pos = eol + 1)
+    {
+        eol = std::find(pos, last, '\n');
+
+        const char * colon = std::find(pos, eol, ':');
+        if (colon == eol)
+        {
+            continue;
+        }
+
+        const char * nameEnd    = colon;
+        const char * value      = colon + 1;
+        const char * valueEnd   = eol;
+        trim(pos, nameEnd);
+        trim(value, valueEnd);
+
+        if (equalsNoCase(pos, nameEnd, "content-length"))
+        {
+            std::size_t length = 0;
+            for (const char * p = value; p != valueEnd; ++p)
+            {
+                if (*p < '0' || *p > '9')
+                {
+                    return invalid;
+                }
+
+                length = length * 10 + (*p - '0');
+                if (length > maxBodySize)
+                {
+                    return invalid;
+                }
+            }
+            m_contentLength = length;
+        }
+        else if (equalsNoCase(pos, nameEnd, "connection"))
+        {
+            haveConnection = true;
+            m_keepAlive = equalsNoCase(value, valueEnd, "keep-alive");
+        }
+    }
+
+    if (!haveConnection)
+    {
+        // http/1.1 default
+        m_keepAlive = proto >= 1;
+    }
+
+    m_bodyOffset = end;
+    m_headerDone = true;
+
+    return complete;
+}
+
+//******************************************************************************
+//******************************************************************************
+JSONReader::JSONReader(const char * begin, const char * end)
+    : m_pos(begin)
+    , m_end(end)
+    , m_first(false)
+    , m_error(false)
+{
+}
+
+//******************************************************************************
+//******************************************************************************
+char JSONReader::peek()
+{
+    while (m_pos != m_end &&
+           (*m_pos == ' ' || *m_pos == '\t' || *m_pos == '\r' || *m_pos == '\n'))
+    {
+        ++m_pos;
+    }
+    return m_pos == m_end ? 0 : *m_pos;
+}
+
+//******************************************************************************
+//******************************************************************************
+bool JSONReader::fail()
+{
+    m_error = true;
+    return false;
+}
+
+//******************************************************************************
+//******************************************************************************
+bool JSONReader::expect(const char ch)
+{
+    if (m_error || peek() != ch)
+    {
+        return fail();
+    }
+
+    ++m_pos;
+    return true;
+}
+
+//******************************************************************************
+//******************************************************************************
+bool JSONReader::beginObject()
+{
+    if (!expect('{'))
+    {
+        return false;
+    }
+
+    m_first = true;
+    return true;
+}
+
+//******************************************************************************
+//******************************************************************************
+bool JSONReader::beginArray()
+{
+    if (!expect('['))
+    {
+        return false;
+    }
+
+    m_first = true;
+    return true;
+}
+
+//******************************************************************************
+//******************************************************************************
+bool JSONReader::nextMember(std::string & name)
+{
+    if (m_error)
+    {
+        return false;
+    }
+
+    if (peek() == '}')
+    {
+        ++m_pos;
+        m_first = false;
+        return false;
+    }
+
+    if (!m_first && !expect(','))
+    {
+        return false;
+    }
+    m_first = false;
+
+    return readString(name) && expect(':');
+}
+
+//******************************************************************************
+//******************************************************************************
+bool JSONReader::nextElement()
+{
+    if (m_error)
+    {
+        return false;
+    }
+
+    if (peek() == ']')
+    {
+        ++m_pos;
+        m_first = false;
+        return false;
+    }
+
+    if (!m_first && !expect(','))
+    {
+        return false;
+    }
+    m_first = false;
+
+    return true;
+}
+
+//******************************************************************************
+//******************************************************************************
+bool JSONReader::isNull()
+{
+    return !m_error && peek() == 'n';
+}
+
+//******************************************************************************
+//******************************************************************************
+bool JSONReader::isObject()
+{
+    return !m_error && peek() == '{';
+}
+
+//******************************************************************************
+//******************************************************************************
+bool JSONReader::readNull()
+{
+    return peek() == 'n' ? skipLiteral("null") : fail();
+}
+
+//******************************************************************************
+//******************************************************************************
+bool JSONReader::readString(std::string & value)
+{
+    if (!expect('"'))
+    {
+        return false;
+    }
+
+    value.clear();
+
+    while (m_pos != m_end)
+    {
+        // plain run
+        const char * run = m_pos;
+        while (m_pos != m_end && *m_pos != '"' && *m_pos != '\\')
+        {
+            ++m_pos;
+        }
+        value.append(run, m_pos);
+
+        if (m_pos == m_end)
+        {
+            break;
+        }
+
+        if (*m_pos++ == '"')
+        {
+            return true;
+        }
+
+        // escape
+        if (m_pos == m_end)
+        {
+            break;
+        }
+
+        char c = *m_pos++;
+        switch (c)
+        {
+            case '"':
+            case '\\':
+            case '/': value += c;    break;
+            case 'b': value += '\b'; break;
+            case 'f': value += '\f'; break;
+            case 'n': value += '\n'; break;
+            case 'r': value += '\r'; break;
+            case 't': value += '\t'; break;
+            case 'u':
+            {
+                unsigned int cp;
+                if (!readHex4(m_pos, m_end, cp))
+                {
+                    return fail();
+                }
+
+                // surrogate pair
+                if (cp >= 0xd800 && cp < 0xdc00 &&
+                        m_end - m_pos >= 6 && m_pos[0] == '\\' && m_pos[1] == 'u')
+                {
+                    const char * p = m_pos + 2;
+                    unsigned int low;
+                    if (readHex4(p, m_end, low) && low >= 0xdc00 && low < 0xe000)
+                    {
+                        cp = 0x10000 + ((cp - 0xd800) << 10) + (low - 0xdc00);
+                        m_pos = p;
+                    }
+                }
+
+                appendUtf8(value, cp);
+                break;
+            }
+            default:
+                return fail();
+        }
+    }
+
+    // unterminated
+    return fail();
+}
+
+//******************************************************************************
+//******************************************************************************
+bool JSONReader::readInt(int & value)
+{
+    double d;
+    if (!readNumber(d))
+    {
+        return false;
+    }
+
+    if (d != std::floor(d) || d < -2147483648.0 || d > 2147483647.0)
+    {
+        return fail();
+    }
+
+    value = static_cast<int>(d);
+    return true;
+}
+
+//******************************************************************************
+//******************************************************************************
+bool JSONReader::readDouble(double & value)
+{
+    return readNumber(value);
+}
+
+//******************************************************************************
+// locale independent, exact for up to 15 digits and small exponents
+//******************************************************************************
+bool JSONReader::readNumber(double & value)
+{
+    char c = peek();
+    if (m_error || (c != '-' && (c < '0' || c > '9')))
+    {
+        return fail();
+    }
+
+    bool negative = false;
+    if (c == '-')
+    {
+        negative = true;
+        ++m_pos;
+    }
+
+    boost::uint64_t mantissa = 0;
+    int digits   = 0;
+    int exponent = 0;
+
+    const char * start = m_pos;
+    for (; m_pos != m_end && *m_pos >= '0' && *m_pos <= '9'; ++m_pos)
+    {
+        if (digits < 19)
+        {
+            mantissa = mantissa * 10 + (*m_pos - '0');
+            if (mantissa)
+            {
+                ++digits;
+            }
+        }
+        else
+        {
+            ++exponent;
+        }
+    }
+
+    if (m_pos == start)
+    {
+        return fail();
+    }
+
+    if (m_pos != m_end && *m_pos == '.')
+    {
+        ++m_pos;
+
+        start = m_pos;
+        for (; m_pos != m_end && *m_pos >= '0' && *m_pos <= '9'; ++m_pos)
+        {
+            if (digits < 19)
+            {
+                mantissa = mantissa * 10 + (*m_pos - '0');
+                --exponent;
+                if (mantissa)
+                {
+                    ++digits;
+                }
+            }
+        }
+
+        if (m_pos == start)
+        {
+            return fail();
+        }
+    }
+
+    if (m_pos != m_end && (*m_pos == 'e' || *m_pos == 'E'))
+    {
+        ++m_pos;
+
+        bool negativeExp = false;
+        if (m_pos != m_end && (*m_pos == '+' || *m_pos == '-'))
+        {
+            negativeExp = *m_pos == '-';
+            ++m_pos;
+        }
+
+        int e = 0;
+        start = m_pos;
+        for (; m_pos != m_end && *m_pos >= '0' && *m_pos <= '9'; ++m_pos)
+        {
+            if (e < 10000)
+            {
+                e = e * 10 + (*m_pos - '0');
+            }
+        }
+
+        if (m_pos == start)
+        {
+            return fail();
+        }
+
+        exponent += negativeExp ? -e : e;
+    }
+
+    value = static_cast<double>(mantissa);
+    if (mantissa < (boost::uint64_t(1) << 53) && exponent >= -22 && exponent <= 22)
+    {
+        // both operands exact, result correctly rounded
+        value = exponent < 0 ? value / pow10[-exponent] : value * pow10[exponent];
+    }
+    else if (exponent != 0)
+    {
+        value *= std::pow(10.0, exponent);
+    }
+
+    if (negative)
+    {
+        value = -value;
+    }
+
+    return true;
+}
+
+//******************************************************************************
+//******************************************************************************
+bool JSONReader::skipString()
+{
+    // at opening quote
+    for (++m_pos; m_pos != m_end; ++m_pos)
+    {
+        if (*m_pos == '\\')
+        {
+            if (++m_pos == m_end)
+            {
+                break;
+            }
+        }
+        else if (*m_pos == '"')
+        {
+            ++m_pos;
+            return true;
+        }
+    }
+
+    return fail();
+}
+
+//******************************************************************************
+//******************************************************************************
+bool JSONReader::skipLiteral(const char * literal)
+{
+    std::size_t length = strlen(literal);
+    if (static_cast<std::size_t>(m_end - m_pos) < length ||
+            memcmp(m_pos, literal, length) != 0)
+    {
+        return fail();
+    }
+
+    m_pos += length;
+    return true;
+}
+
+//******************************************************************************
+//******************************************************************************
+bool JSONReader::skipValue(const char ** begin, const char ** end)
+{
+    char c = peek();
+    const char * start = m_pos;
+
+    bool result = false;
+    if (m_error)
+    {
+        result = false;
+    }
+    else if (c == '{' || c == '[')
+    {
+        // scan to matching bracket, strings skipped
+        int depth = 0;
+        while (m_pos != m_end)
+        {
+            c = *m_pos;
+            if (c == '"')
+            {
+                if (!skipString())
+                {
+                    break;
+                }
+                continue;
+            }
+
+            ++m_pos;
+
+            if (c == '{' || c == '[')
+            {
+                ++depth;
+            }
+            else if ((c == '}' || c == ']') && --depth == 0)
+            {
+                result = true;
+                break;
+            }
+        }
+
+        if (!result)
+        {
+            fail();
+        }
+    }
+    else if (c == '"')
+    {
+        result = skipString();
+    }
+    else if (c == 't')
+    {
+        result = skipLiteral("true");
+    }
+    else if (c == 'f')
+    {
+        result = skipLiteral("false");
+    }
+    else if (c == 'n')
+    {
+        result = skipLiteral("null");
+    }
+    else
+    {
+        double d;
+        result = readNumber(d);
+    }
+
+    if (begin)
+    {
+        *begin = start;
+    }
+    if (end)
+    {
+        *end = m_pos;
+    }
+
+    return result;
+}
+
+} // namespace rpc
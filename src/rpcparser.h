@@ -0,0 +1,129 @@
+//******************************************************************************
+//******************************************************************************
+
+#ifndef RPCPARSER_H
+#define RPCPARSER_H
+
+#include <vector>
+#include <string>
+
+#include <boost/cstdint.hpp>
+
+namespace rpc
+{
+
+//******************************************************************************
+// incremental HTTP/1.1 reply parser over reusable buffer
+//
+// bytes read directly into buffer (prepare/commit), header scanned
+// in place once, only status, content-length and connection kept.
+// body is range inside buffer, valid until reset
+//******************************************************************************
+class HTTPReply
+{
+public:
+    enum State
+    {
+        incomplete,
+        complete,
+        invalid
+    };
+
+    enum
+    {
+        // read size
+        chunkSize   = 16384,
+        maxBodySize = 0x02000000
+    };
+
+public:
+    HTTPReply();
+
+    // space for next read
+    char * prepare(std::size_t & size);
+    // size bytes read into prepared space
+    State commit(const std::size_t size);
+
+    // next reply on same connection, buffer capacity kept
+    void reset();
+
+    int  status() const      { return m_status; }
+    bool keepAlive() const   { return m_keepAlive; }
+
+    const char * body() const     { return &m_buffer[0] + m_bodyOffset; }
+    std::size_t  bodySize() const { return m_contentLength; }
+
+private:
+    State parseHeader(const std::size_t end);
+
+private:
+    std::vector<char> m_buffer;
+    // bytes in buffer
+    std::size_t       m_size;
+    // header end searched from here
+    std::size_t       m_scanned;
+
+    bool              m_headerDone;
+    std::size_t       m_bodyOffset;
+    std::size_t       m_contentLength;
+
+    int               m_status;
+    bool              m_keepAlive;
+};
+
+//******************************************************************************
+// pull json reader over range, no document tree
+//
+// values read in document order, unknown members skipped without
+// allocation. all functions return false on error or end of container,
+// ok() tells them apart
+//******************************************************************************
+class JSONReader
+{
+public:
+    JSONReader(const char * begin, const char * end);
+
+    bool ok() const { return !m_error; }
+
+    // '{' or '['
+    bool beginObject();
+    bool beginArray();
+
+    // next member name, false after '}'
+    bool nextMember(std::string & name);
+    // next element, false after ']'
+    bool nextElement();
+
+    // peek, reader state unchanged
+    bool isNull();
+    bool isObject();
+
+    bool readNull();
+    bool readString(std::string & value);
+    bool readInt(int & value);
+    bool readDouble(double & value);
+
+    // skip value of any type, range of skipped text returned
+    bool skipValue(const char ** begin = 0, const char ** end = 0);
+
+private:
+    char peek();
+    bool expect(const char ch);
+    bool fail();
+
+    bool skipString();
+    bool skipLiteral(const char * literal);
+    bool readNumber(double & value);
+
+private:
+    const char * m_pos;
+    const char * m_end;
+
+    // container just opened, no comma before first item
+    bool         m_first;
+    bool         m_error;
+};
+
+} // namespace rpc
+
+#endif // RPCPARSER_H
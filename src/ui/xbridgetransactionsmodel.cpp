@@ -9,6 +9,9 @@
 #include "../util/verify.h"
 #include "../util/util.h"
 
+#include <map>
+#include <set>
+
 #include <boost/date_time/posix_time/posix_time.hpp>
 
 //******************************************************************************
@@ -20,8 +23,11 @@ XBridgeTransactionsModel::XBridgeTransactionsModel()
               << trUtf8("To") << trUtf8("Amount")
               << trUtf8("State");
 
-    uiConnector.NotifyXBridgePendingTransactionReceived.connect
-            (boost::bind(&XBridgeTransactionsModel::onTransactionReceived, this, _1));
+    uiConnector.NotifyXBridgePendingTransactionsReceived.connect
+            (boost::bind(&XBridgeTransactionsModel::onTransactionsReceived, this, _1));
+
+    uiConnector.NotifyXBridgePendingTransactionsRemoved.connect
+            (boost::bind(&XBridgeTransactionsModel::onTransactionsRemoved, this, _1));
 
     uiConnector.NotifyXBridgeTransactionStateChanged.connect
             (boost::bind(&XBridgeTransactionsModel::onTransactionStateChanged, this, _1, _2));
@@ -287,42 +293,109 @@ void XBridgeTransactionsModel::onTimer()
 
 //******************************************************************************
 //******************************************************************************
-void XBridgeTransactionsModel::onTransactionReceived(const XBridgeTransactionDescr & tx)
+void XBridgeTransactionsModel::onTransactionsReceived(const std::vector<XBridgeTransactionDescr> & list)
 {
+    // rows of known transactions, one pass for whole list
+    std::map<uint256, unsigned int> rows;
     for (unsigned int i = 0; i < m_transactions.size(); ++i)
     {
-        if (m_transactions[i].id == tx.id)
+        rows[m_transactions[i].id] = i;
+    }
+
+    std::vector<XBridgeTransactionDescr> added;
+    std::set<uint256> addedIds;
+
+    int firstChanged = -1;
+    int lastChanged  = -1;
+
+    for (std::vector<XBridgeTransactionDescr>::const_iterator it = list.begin(); it != list.end(); ++it)
+    {
+        const XBridgeTransactionDescr & tx = *it;
+
+        std::map<uint256, unsigned int>::iterator row = rows.find(tx.id);
+        if (row == rows.end())
         {
-            // found
-            if (m_transactions[i].from.size() == 0)
+            // skip tx with other currencies
+            // std::string tmp = thisCurrency().toStdString();
+            // if (tx.fromCurrency != tmp && tx.toCurrency != tmp)
+            // {
+            //     continue;
+            // }
+
+            if (addedIds.insert(tx.id).second)
             {
-                m_transactions[i] = tx;
+                added.push_back(tx);
             }
+            continue;
+        }
 
-            else if (m_transactions[i].state < tx.state)
+        // found
+        const unsigned int i = row->second;
+        if (m_transactions[i].from.size() == 0)
+        {
+            m_transactions[i] = tx;
+        }
+
+        else
+        {
+            if (m_transactions[i].state < tx.state)
             {
                 m_transactions[i].state = tx.state;
             }
 
-            // update timestamp
-            m_transactions[i].txtime = tx.txtime;
+            // own order, rest after partial fill
+            m_transactions[i].fromAmount = tx.fromAmount;
+            m_transactions[i].toAmount   = tx.toAmount;
+        }
 
-            emit dataChanged(index(i, FirstColumn), index(i, LastColumn));
-            return;
+        // update timestamp
+        m_transactions[i].txtime = tx.txtime;
+
+        if (firstChanged < 0 || static_cast<int>(i) < firstChanged)
+        {
+            firstChanged = i;
         }
+        if (static_cast<int>(i) > lastChanged)
+        {
+            lastChanged = i;
+        }
+    }
+
+    if (firstChanged >= 0)
+    {
+        emit dataChanged(index(firstChanged, FirstColumn), index(lastChanged, LastColumn));
     }
 
-    // skip tx with other currencies
-    // std::string tmp = thisCurrency().toStdString();
-    // if (tx.fromCurrency != tmp && tx.toCurrency != tmp)
-    // {
-    //     return;
-    // }
-
-    emit beginInsertRows(QModelIndex(), 0, 0);
-    m_transactions.insert(m_transactions.begin(), 1, tx);
-    // std::sort(m_transactions.begin(), m_transactions.end(), std::greater<XBridgeTransactionDescr>());
-    emit endInsertRows();
+    if (added.size())
+    {
+        // newest first
+        emit beginInsertRows(QModelIndex(), 0, added.size()-1);
+        m_transactions.insert(m_transactions.begin(), added.rbegin(), added.rend());
+        // std::sort(m_transactions.begin(), m_transactions.end(), std::greater<XBridgeTransactionDescr>());
+        emit endInsertRows();
+    }
+}
+
+//******************************************************************************
+// orders removed from hub order book,
+// only foreign orders still pending are removed from model
+//******************************************************************************
+void XBridgeTransactionsModel::onTransactionsRemoved(const std::vector<uint256> & ids)
+{
+    std::set<uint256> removed(ids.begin(), ids.end());
+
+    for (int i = static_cast<int>(m_transactions.size()) - 1; i >= 0; --i)
+    {
+        const XBridgeTransactionDescr & d = m_transactions[i];
+        if (d.from.size() == 0 &&
+            d.state == XBridgeTransactionDescr::trPending &&
+            removed.count(d.id))
+        {
+            emit beginRemoveRows(QModelIndex(), i, i);
+            m_transactions.erase(m_transactions.begin() + i);
+            emit endRemoveRows();
+        }
+    }
 }
 
 //******************************************************************************
@@ -65,7 +65,8 @@ private slots:
     void onTimer();
 
 private:
-    void onTransactionReceived(const XBridgeTransactionDescr & tx);
+    void onTransactionsReceived(const std::vector<XBridgeTransactionDescr> & list);
+    void onTransactionsRemoved(const std::vector<uint256> & ids);
     void onTransactionIdChanged(const uint256 & id, const uint256 & newid);
     void onTransactionStateChanged(const uint256 & id, const unsigned int state);
 
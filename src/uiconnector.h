@@ -2,6 +2,7 @@
 #define UICONNECTOR_H
 
 #include <string>
+#include <vector>
 #include <boost/signals2/signal.hpp>
 
 class uint256;
@@ -10,7 +11,9 @@ struct XBridgeTransactionDescr;
 class UIConnector
 {
 public:
-    boost::signals2::signal<void (const XBridgeTransactionDescr & tx)> NotifyXBridgePendingTransactionReceived;
+    boost::signals2::signal<void (const std::vector<XBridgeTransactionDescr> & list)> NotifyXBridgePendingTransactionsReceived;
+
+    boost::signals2::signal<void (const std::vector<uint256> & ids)> NotifyXBridgePendingTransactionsRemoved;
 
     boost::signals2::signal<void (const uint256 & id, const uint256 & newid)> NotifyXBridgeTransactionIdChanged;
 
@@ -0,0 +1,148 @@
+//*****************************************************************************
+//*****************************************************************************
+
+#include "crc32c.h"
+
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define CRC32C_SSE42
+#include <nmmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define CRC32C_X64
+#endif
+
+//*****************************************************************************
+//*****************************************************************************
+namespace util
+{
+
+//*****************************************************************************
+// reflected polynomial 0x1edc6f41
+//*****************************************************************************
+static const boost::uint32_t crc32cPoly = 0x82f63b78;
+
+//*****************************************************************************
+//*****************************************************************************
+struct Crc32cTable
+{
+    boost::uint32_t table[256];
+
+    Crc32cTable()
+    {
+        for (boost::uint32_t i = 0; i < 256; ++i)
+        {
+            boost::uint32_t crc = i;
+            for (int k = 0; k < 8; ++k)
+            {
+                crc = (crc & 1) ? (crc >> 1) ^ crc32cPoly : crc >> 1;
+            }
+            table[i] = crc;
+        }
+    }
+};
+
+//*****************************************************************************
+//*****************************************************************************
+static boost::uint32_t crc32cSoft(boost::uint32_t crc,
+                                  const unsigned char * data,
+                                  std::size_t size)
+{
+    static const Crc32cTable t;
+
+    while (size--)
+    {
+        crc = t.table[(crc ^ *data++) & 0xff] ^ (crc >> 8);
+    }
+    return crc;
+}
+
+#ifdef CRC32C_SSE42
+
+//*****************************************************************************
+//*****************************************************************************
+static bool haveSse42()
+{
+#ifdef _MSC_VER
+    int info[4] = { 0 };
+    __cpuid(info, 1);
+    return (info[2] & (1 << 20)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("sse4.2") != 0;
+#endif
+}
+
+//*****************************************************************************
+//*****************************************************************************
+#ifndef _MSC_VER
+__attribute__((target("sse4.2")))
+#endif
+static boost::uint32_t crc32cHard(boost::uint32_t crc,
+                                  const unsigned char * data,
+                                  std::size_t size)
+{
+#ifdef CRC32C_X64
+    boost::uint64_t crc64 = crc;
+    while (size >= sizeof(boost::uint64_t))
+    {
+        boost::uint64_t v;
+        memcpy(&v, data, sizeof(v));
+        crc64 = _mm_crc32_u64(crc64, v);
+        data += sizeof(v);
+        size -= sizeof(v);
+    }
+    crc = static_cast<boost::uint32_t>(crc64);
+#endif
+
+    while (size >= sizeof(boost::uint32_t))
+    {
+        boost::uint32_t v;
+        memcpy(&v, data, sizeof(v));
+        crc = _mm_crc32_u32(crc, v);
+        data += sizeof(v);
+        size -= sizeof(v);
+    }
+
+    while (size--)
+    {
+        crc = _mm_crc32_u8(crc, *data++);
+    }
+
+    return crc;
+}
+
+#endif // CRC32C_SSE42
+
+//*****************************************************************************
+//*****************************************************************************
+bool crc32cHardware()
+{
+#ifdef CRC32C_SSE42
+    static const bool hw = haveSse42();
+    return hw;
+#else
+    return false;
+#endif
+}
+
+//*****************************************************************************
+//*****************************************************************************
+boost::uint32_t crc32c(const unsigned char * data, const std::size_t size)
+{
+#ifdef CRC32C_SSE42
+    if (crc32cHardware())
+    {
+        return ~crc32cHard(0xffffffff, data, size);
+    }
+#endif
+
+    return ~crc32cSoft(0xffffffff, data, size);
+}
+
+} // namespace util
@@ -0,0 +1,23 @@
+//*****************************************************************************
+//*****************************************************************************
+
+#ifndef CRC32C_H
+#define CRC32C_H
+
+#include <cstddef>
+#include <boost/cstdint.hpp>
+
+//*****************************************************************************
+//*****************************************************************************
+namespace util
+{
+    // crc32c (castagnoli), uses sse4.2 crc32 instruction if cpu supports it,
+    // table implementation otherwise
+    boost::uint32_t crc32c(const unsigned char * data, const std::size_t size);
+
+    // true if crc32c is calculated by hardware
+    bool crc32cHardware();
+
+} // namespace util
+
+#endif // CRC32C_H
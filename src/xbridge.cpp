@@ -7,6 +7,7 @@
 #include "util/logger.h"
 #include "util/settings.h"
 
+#include <boost/bind.hpp>
 #include <boost/date_time/posix_time/posix_time.hpp>
 
 //*****************************************************************************
@@ -15,11 +16,19 @@ XBridge::XBridge()
     : m_timerIoWork(m_timerIo)
     , m_timerThread(boost::bind(&boost::asio::io_service::run, &m_timerIo))
     , m_timer(m_timerIo, boost::posix_time::seconds(TIMER_INTERVAL))
+    , m_timerTicks(0)
 {
     try
     {
-        // services and threas
-        for (int i = 0; i < THREAD_COUNT; ++i)
+        // services and threads, matching of different
+        // currency pairs runs in parallel
+        unsigned int threadCount = settings().get<unsigned int>("Main.ThreadCount", THREAD_COUNT);
+        if (threadCount == 0)
+        {
+            threadCount = THREAD_COUNT;
+        }
+
+        for (unsigned int i = 0; i < threadCount; ++i)
         {
             IoServicePtr ios(new boost::asio::io_service);
 
@@ -29,8 +38,6 @@ XBridge::XBridge()
             m_threads.create_thread(boost::bind(&boost::asio::io_service::run, ios));
         }
 
-        m_timer.async_wait(boost::bind(&XBridge::onTimer, this));
-
         // sessions
         XBridgeApp & app = XBridgeApp::instance();
         {
@@ -57,15 +64,32 @@ XBridge::XBridge()
 
                 XBridgeSessionPtr session(new XBridgeSession(*i, ip, port, user, passwd, prefix, COIN));
                 app.addSession(session);
+
+                m_wallets.push_back(Wallet(session, XBridgeWalletExecutorPtr(new XBridgeWalletExecutor(*i))));
                 // session->requestAddressBook();
             }
         }
+
+        // push notifications of wallets, polling stays for wallets without hooks
+        unsigned short notifyPort = settings().get<unsigned short>("Main.NotifyPort", 0);
+        if (notifyPort != 0)
+        {
+            m_notify.reset(new XBridgeWalletNotify(m_timerIo, notifyPort,
+                                                   boost::bind(&XBridge::onWalletNotify, this, _1, _2, _3)));
+            if (!m_notify->start())
+            {
+                m_notify.reset();
+            }
+        }
     }
     catch (std::exception & e)
     {
         ERR() << e.what();
         ERR() << __FUNCTION__;
     }
+
+    // after wallets and hooks, timer thread reads them
+    m_timer.async_wait(boost::bind(&XBridge::onTimer, this));
 }
 
 //*****************************************************************************
@@ -80,12 +104,22 @@ void XBridge::run()
 void XBridge::stop()
 {
     m_timer.cancel();
+    if (m_notify)
+    {
+        // closed here, posted close would not run after io stop
+        m_notify->stop();
+    }
     m_timerIo.stop();
 
     for (auto i = m_services.begin(); i != m_services.end(); ++i)
     {
         (*i)->stop();
     }
+
+    for (auto i = m_wallets.begin(); i != m_wallets.end(); ++i)
+    {
+        i->second->stop();
+    }
 }
 
 //******************************************************************************
@@ -102,26 +136,55 @@ void XBridge::onTimer()
 
         IoServicePtr io = m_services.front();
 
-        // call check expired transactions
+        // call check expired transactions, only due entries touched
         io->post(boost::bind(&XBridgeSession::checkFinishedTransactions, session));
 
-        // send list of wallets (broadcast)
-        // io->post(boost::bind(&XBridgeSession::sendListOfWallets, session));
-
-        // send transactions list
-        io->post(boost::bind(&XBridgeSession::sendListOfTransactions, session));
-
         // erase expired tx
         io->post(boost::bind(&XBridgeSession::eraseExpiredPendingTransactions, session));
 
-        // check unconfirmed tx
-        io->post(boost::bind(&XBridgeSession::checkUnconfirmedTx, session));
+        const bool lists = ++m_timerTicks % LIST_INTERVAL == 0;
 
-        // resend addressbook
-        // io->post(boost::bind(&XBridgeSession::resendAddressBook, session));
-        io->post(boost::bind(&XBridgeSession::getAddressBook, session));
+        // unspent outputs, address pool, and with lists unconfirmed tx
+        // and address book. each wallet on own executor, skipped while
+        // previous call of wallet runs or wallet failing
+        for (std::vector<Wallet>::iterator i = m_wallets.begin(); i != m_wallets.end(); ++i)
+        {
+            i->second->submit(boost::bind(&XBridgeSession::pollWallet, i->first, lists));
+        }
+
+        if (lists)
+        {
+            // send list of wallets (broadcast), announces hub on ring
+            io->post(boost::bind(&XBridgeSession::sendListOfWallets, session));
+
+            // send transactions list
+            io->post(boost::bind(&XBridgeSession::sendListOfTransactions, session));
+
+            // resend addressbook
+            // io->post(boost::bind(&XBridgeSession::resendAddressBook, session));
+        }
     }
 
     m_timer.expires_at(m_timer.expires_at() + boost::posix_time::seconds(TIMER_INTERVAL));
     m_timer.async_wait(boost::bind(&XBridge::onTimer, this));
 }
+
+//******************************************************************************
+// timer io thread, wallet calls made on executor of wallet,
+// after poll if one runs
+//******************************************************************************
+void XBridge::onWalletNotify(const std::string & currency,
+                             const bool isBlock,
+                             const uint256 & hash)
+{
+    for (std::vector<Wallet>::iterator i = m_wallets.begin(); i != m_wallets.end(); ++i)
+    {
+        if (i->first->currency() == currency)
+        {
+            i->second->queue(boost::bind(&XBridgeSession::walletNotify, i->first, isBlock, hash));
+            return;
+        }
+    }
+
+    LOG() << "notification of unknown wallet <" << currency << ">";
+}
@@ -4,23 +4,37 @@
 #ifndef XBRIDGE_H
 #define XBRIDGE_H
 
+#include "xbridgewalletnotify.h"
+#include "xbridgewalletexecutor.h"
+
 #include <deque>
+#include <vector>
+#include <memory>
 
 #include <boost/asio.hpp>
 #include <boost/thread.hpp>
 
+class XBridgeSession;
+
 //*****************************************************************************
 //*****************************************************************************
 class XBridge
 {
     enum
     {
+        // default, Main.ThreadCount in config
         THREAD_COUNT = 2,
-        TIMER_INTERVAL = 20
+        // expiry check, seconds
+        TIMER_INTERVAL = 1,
+        // lists and address book, ticks
+        LIST_INTERVAL = 20
     };
 
     typedef std::shared_ptr<boost::asio::io_service>      IoServicePtr;
 
+    typedef std::pair<std::shared_ptr<XBridgeSession>,
+                      XBridgeWalletExecutorPtr>           Wallet;
+
 public:
     typedef boost::asio::ip::tcp::socket                  Socket;
     typedef std::shared_ptr<boost::asio::ip::tcp::socket> SocketPtr;
@@ -33,6 +47,9 @@ public:
 
 private:
     void onTimer();
+    void onWalletNotify(const std::string & currency,
+                        const bool isBlock,
+                        const uint256 & hash);
 
 private:
     std::deque<IoServicePtr>                        m_services;
@@ -43,6 +60,13 @@ private:
     boost::asio::io_service::work                   m_timerIoWork;
     boost::thread                                   m_timerThread;
     boost::asio::deadline_timer                     m_timer;
+    unsigned int                                    m_timerTicks;
+
+    // periodic calls of wallets, one executor per wallet
+    std::vector<Wallet>                             m_wallets;
+
+    // wallet hooks, runs on timer io
+    std::shared_ptr<XBridgeWalletNotify>            m_notify;
 };
 
 typedef std::shared_ptr<XBridge> XBridgePtr;
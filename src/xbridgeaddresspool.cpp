@@ -0,0 +1,80 @@
+//*****************************************************************************
+//*****************************************************************************
+
+#include "xbridgeaddresspool.h"
+#include "bitcoinrpc.h"
+#include "util/logger.h"
+
+#include <boost/bind.hpp>
+
+//*****************************************************************************
+//*****************************************************************************
+XBridgeAddressPool::XBridgeAddressPool(const std::string & user,
+                                       const std::string & passwd,
+                                       const std::string & address,
+                                       const std::string & port)
+    : m_user(user)
+    , m_passwd(passwd)
+    , m_address(address)
+    , m_port(port)
+    , m_refilling(false)
+{
+}
+
+//*****************************************************************************
+//*****************************************************************************
+bool XBridgeAddressPool::take(std::string & addr)
+{
+    bool found = false;
+    {
+        boost::mutex::scoped_lock l(m_lock);
+
+        if (!m_addrs.empty())
+        {
+            addr = m_addrs.front();
+            m_addrs.pop_front();
+            found = true;
+        }
+    }
+
+    refill();
+
+    return found;
+}
+
+//*****************************************************************************
+//*****************************************************************************
+void XBridgeAddressPool::refill()
+{
+    {
+        boost::mutex::scoped_lock l(m_lock);
+
+        if (m_refilling || m_addrs.size() >= lowWater)
+        {
+            return;
+        }
+
+        m_refilling = true;
+    }
+
+    rpc::getNewAddressesAsync(m_user, m_passwd, m_address, m_port, batchSize,
+                              boost::bind(&XBridgeAddressPool::onRefill,
+                                          shared_from_this(), _1));
+}
+
+//*****************************************************************************
+// rpc io thread
+//*****************************************************************************
+void XBridgeAddressPool::onRefill(const std::vector<std::string> & addrs)
+{
+    boost::mutex::scoped_lock l(m_lock);
+
+    m_addrs.insert(m_addrs.end(), addrs.begin(), addrs.end());
+    m_refilling = false;
+
+    if (addrs.empty())
+    {
+        // next try on take or timer
+        LOG() << "address pool of " << m_address << ":" << m_port << " not refilled";
+    }
+}
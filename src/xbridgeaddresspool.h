@@ -0,0 +1,59 @@
+//*****************************************************************************
+//*****************************************************************************
+
+#ifndef XBRIDGEADDRESSPOOL_H
+#define XBRIDGEADDRESSPOOL_H
+
+#include <string>
+#include <vector>
+#include <deque>
+
+#include <boost/shared_ptr.hpp>
+#include <boost/enable_shared_from_this.hpp>
+#include <boost/thread/mutex.hpp>
+
+//*****************************************************************************
+// fresh wallet addresses generated in advance
+//
+// refilled below lowWater with one batch request of batchSize
+// getnewaddress calls, on rpc io thread. swap takes addresses
+// without wallet call, only empty pool makes caller ask wallet
+//*****************************************************************************
+class XBridgeAddressPool : public boost::enable_shared_from_this<XBridgeAddressPool>
+{
+public:
+    enum
+    {
+        lowWater  = 4,
+        batchSize = 16
+    };
+
+public:
+    XBridgeAddressPool(const std::string & user,
+                       const std::string & passwd,
+                       const std::string & address,
+                       const std::string & port);
+
+    // false if pool empty, refill started below lowWater
+    bool take(std::string & addr);
+
+    // start refill if below lowWater and none running
+    void refill();
+
+private:
+    void onRefill(const std::vector<std::string> & addrs);
+
+private:
+    const std::string       m_user;
+    const std::string       m_passwd;
+    const std::string       m_address;
+    const std::string       m_port;
+
+    boost::mutex            m_lock;
+    std::deque<std::string> m_addrs;
+    bool                    m_refilling;
+};
+
+typedef boost::shared_ptr<XBridgeAddressPool> XBridgeAddressPoolPtr;
+
+#endif // XBRIDGEADDRESSPOOL_H
@@ -10,6 +10,7 @@
 #include "version.h"
 #include "config.h"
 #include "uiconnector.h"
+#include "bitcoinrpc.h"
 
 #ifndef NO_GUI
 #include "ui/mainwindow.h"
@@ -253,7 +254,7 @@ void XBridgeApp::onSearch(const std::string & id)
 //*****************************************************************************
 void XBridgeApp::onSend(const std::vector<unsigned char> & message)
 {
-    m_messages.push_back(std::make_tuple(std::vector<unsigned char>(), message, false));
+    m_messages.push(std::vector<unsigned char>(), message);
     m_signalSend = true;
 }
 
@@ -261,6 +262,8 @@ void XBridgeApp::onSend(const std::vector<unsigned char> & message)
 //*****************************************************************************
 void XBridgeApp::onSend(const XBridgePacketPtr packet)
 {
+    packet->finalize();
+
     UcharVector v;
     std::copy(packet->header(), packet->header()+packet->allSize(), std::back_inserter(v));
     onSend(v);
@@ -272,13 +275,15 @@ void XBridgeApp::onSend(const XBridgePacketPtr packet)
 //*****************************************************************************
 void XBridgeApp::onSend(const UcharVector & id, const UcharVector & message)
 {
-    m_messages.push_back(std::make_tuple(id, message, false));
+    m_messages.push(id, message);
     m_signalSend = true;
 }
 
 //*****************************************************************************
 void XBridgeApp::onSend(const std::vector<unsigned char> & id, const XBridgePacketPtr packet)
 {
+    packet->finalize();
+
     UcharVector v;
     std::copy(packet->header(), packet->header()+packet->allSize(), std::back_inserter(v));
     onSend(id, v);
@@ -291,7 +296,12 @@ void XBridgeApp::onMessageReceived(const UcharVector & id, const UcharVector & m
     static UcharVector localid(m_myid, m_myid+20);
 
     XBridgePacketPtr packet(new XBridgePacket);
-    packet->copyFrom(message);
+    if (!packet->copyFrom(message))
+    {
+        ERR() << "incorrect packet size " << message.size()
+              << ", message dropped " << __FUNCTION__;
+        return;
+    }
 
     LOG() << "received message to" << util::base64_encode(std::string((char *)&id[0], 20)).c_str()
              << " command " << packet->command();
@@ -302,6 +312,13 @@ void XBridgeApp::onMessageReceived(const UcharVector & id, const UcharVector & m
         return;
     }
 
+    if (!XBridgeSession::checkXBridgePacketCrc(packet))
+    {
+        ERR() << "incorrect packet crc, command " << packet->command()
+              << ", message dropped " << __FUNCTION__;
+        return;
+    }
+
     boost::mutex::scoped_lock l(m_sessionsLock);
     if (m_sessionAddrs.count(id))
     {
@@ -334,7 +351,25 @@ void XBridgeApp::onBroadcastReceived(const std::vector<unsigned char> & message)
 
     // process message
     XBridgePacketPtr packet(new XBridgePacket);
-    packet->copyFrom(message);
+    if (!packet->copyFrom(message))
+    {
+        ERR() << "incorrect packet size " << message.size()
+              << ", broadcast dropped " << __FUNCTION__;
+        return;
+    }
+
+    if (!XBridgeSession::checkXBridgePacketVersion(packet))
+    {
+        ERR() << "incorrect protocol version <" << packet->version() << "> " << __FUNCTION__;
+        return;
+    }
+
+    if (!XBridgeSession::checkXBridgePacketCrc(packet))
+    {
+        ERR() << "incorrect packet crc, command " << packet->command()
+              << ", broadcast dropped " << __FUNCTION__;
+        return;
+    }
 
     XBridgeSessionPtr ptr(new XBridgeSession);
     ptr->processPacket(packet);
@@ -367,7 +402,7 @@ void callback(void * closure, int event,
         LOG() << ((event == DHT_EVENT_SEARCH_DONE6) ?
                         "Search done(6)" : "Search done");
 
-        if (app->m_messages.size())
+        if (!app->m_messages.empty())
         {
             app->m_signalSend = true;
         }
@@ -391,8 +426,14 @@ void XBridgeApp::dhtThreadProc()
 
     LOG() << "started";
 
-    // generate random id
-    dht_random_bytes(m_myid, sizeof(m_myid));
+    // generate random id, hash160 of new key
+    {
+        boost::mutex::scoped_lock l(m_keyLock);
+        m_key.MakeNewKey(true);
+
+        CKeyID id = m_key.GetPubKey().GetID();
+        memcpy(m_myid, id.begin(), sizeof(m_myid));
+    }
     LOG() << "generated id <"
              << util::base64_encode(std::string((char *)m_myid, sizeof(m_myid))).c_str()
              << ">";
@@ -505,6 +546,13 @@ void XBridgeApp::dhtThreadProc()
         tv.tv_sec = 1;
         tv.tv_usec = rand() % 1000000;
 
+        if (m_signalSend)
+        {
+            // have queued messages, do not wait
+            tv.tv_sec = 0;
+            tv.tv_usec = 0;
+        }
+
         FD_ZERO(&readfds);
         if(s4 >= 0)
         {
@@ -623,105 +671,115 @@ void XBridgeApp::dhtThreadProc()
         {
             // LOG() << "sendind";
 
-            if (m_messages.size())
+            // reset before sending, new messages can be queued
+            // from other threads while sending
+            m_signalSend = false;
+
+            // messages returned back for resend after search
+            std::list<XBridgeMessageQueue::Message> resend;
+
+            // send by lanes priority, not more than SEND_BUDGET per loop,
+            // rest on next loop without waiting for network
+            XBridgeMessageQueue::Message msg;
+            unsigned int sent = 0;
+            for (; sent < SEND_BUDGET && m_messages.pop(msg); ++sent)
             {
-                // TODO sync
-                std::list<MessagePair> messages = m_messages;
-                m_messages.clear();
+                std::vector<unsigned char> & id      = msg.id;
+                std::vector<unsigned char> & message = msg.message;
 
-                while (messages.size())
+                if (isKnownMessage(message))
                 {
-                    MessagePair mpair = messages.front();
-                    messages.pop_front();
-
-                    std::vector<unsigned char> & id      = std::get<0>(mpair);
-                    std::vector<unsigned char> & message = std::get<1>(mpair);
+                    continue;
+                }
 
-                    if (isKnownMessage(message))
+                // check broadcast
+                if (id.empty())
+                {
+                    // send to all local clients
                     {
-                        continue;
+                        boost::mutex::scoped_lock l(m_sessionsLock);
+                        for (SessionIdMap::iterator i = m_sessionIds.begin(); i != m_sessionIds.end(); ++i)
+                        {
+                            std::get<1>(*i)->sendXBridgeMessage(message);
+                        }
                     }
 
-                    // check broadcast
-                    if (id.empty())
+                    // send to xbridge network
+                    dht_send_broadcast(&message[0], message.size());
+
+                    // add to known
+                    boost::mutex::scoped_lock l(m_messagesLock);
+                    m_processedMessages.insert(util::hash(message.begin(), message.end())).second;
+                }
+
+                else
+                {
+                    bool isFoundLocal = false;
+
+                    // check local
                     {
-                        // send to all local clients
+                        boost::mutex::scoped_lock l(m_sessionsLock);
+                        if (m_sessionAddrs.count(id))
                         {
-                            boost::mutex::scoped_lock l(m_sessionsLock);
-                            for (SessionIdMap::iterator i = m_sessionIds.begin(); i != m_sessionIds.end(); ++i)
-                            {
-                                std::get<1>(*i)->sendXBridgeMessage(message);
-                            }
-                        }
-
-                        // send to xbridge network
-                        dht_send_broadcast(&message[0], message.size());
+                            // found local client
+                            XBridgeSessionPtr ptr = m_sessionAddrs[id];
+                            ptr->sendXBridgeMessage(message);
 
-                        // add to known
-                        boost::mutex::scoped_lock l(m_messagesLock);
-                        m_processedMessages.insert(util::hash(message.begin(), message.end())).second;
+                            isFoundLocal = true;
+                        }
                     }
 
-                    else
+                    if (!isFoundLocal)
                     {
-                        bool isFoundLocal = false;
-
-                        // check local
+                        // not local
+                        int err = dht_send_message(&id[0], &message[0], message.size());
+                        if (!err)
                         {
-                            boost::mutex::scoped_lock l(m_sessionsLock);
-                            if (m_sessionAddrs.count(id))
-                            {
-                                // found local client
-                                XBridgeSessionPtr ptr = m_sessionAddrs[id];
-                                ptr->sendXBridgeMessage(message);
-
-                                isFoundLocal = true;
-                            }
+                            // add to known
+                            boost::mutex::scoped_lock l(m_messagesLock);
+                            m_processedMessages.insert(util::hash(message.begin(), message.end())).second;
                         }
 
-                        if (!isFoundLocal)
+                        if (err != 0 && err != DHT_NETWORK_BUFFER_OWERFLOW)
                         {
-                            // not local
-                            int err = dht_send_message(&id[0], &message[0], message.size());
-                            if (!err)
-                            {
-                                // add to known
-                                boost::mutex::scoped_lock l(m_messagesLock);
-                                m_processedMessages.insert(util::hash(message.begin(), message.end())).second;
-                            }
+                            // not send - go to search peer
+                            std::string _id;
+                            std::copy(id.begin(), id.end(), std::back_inserter(_id));
 
-                            if (err != 0 && err != DHT_NETWORK_BUFFER_OWERFLOW)
+                            if (msg.resent)
                             {
-                                // not send - go to search peer
-                                std::string _id;
-                                std::copy(id.begin(), id.end(), std::back_inserter(_id));
-
-                                if (std::get<2>(mpair))
-                                {
-                                    // error resend after search, drop this message
-                                    LOG() << "drop message to <"
-                                             << _id.c_str()
-                                             << "> (not found)";
-                                }
-                                else
-                                {
-                                    // return message back and try search
-                                    std::get<2>(mpair) = true;
-                                    m_messages.push_back(mpair);
-                                    m_searchStrings.push_back(util::base64_encode(_id));
-                                    m_signalSearch = true;
-                                }
+                                // error resend after search, drop this message
+                                LOG() << "drop message to <"
+                                         << _id.c_str()
+                                         << "> (not found)";
                             }
-                            else if (err == DHT_NETWORK_BUFFER_OWERFLOW)
+                            else
                             {
-                                LOG() << "NETWORK_BUFFER_OWERFLOW";
+                                // return message back and try search
+                                msg.resent = true;
+                                resend.push_back(msg);
+                                m_searchStrings.push_back(util::base64_encode(_id));
+                                m_signalSearch = true;
                             }
                         }
+                        else if (err == DHT_NETWORK_BUFFER_OWERFLOW)
+                        {
+                            LOG() << "NETWORK_BUFFER_OWERFLOW";
+                        }
                     }
                 }
             }
 
-            m_signalSend = false;
+            for (const XBridgeMessageQueue::Message & m : resend)
+            {
+                m_messages.push(m.id, m.message, m.resent);
+            }
+
+            if (sent == SEND_BUDGET)
+            {
+                // budget exhausted, continue on next loop
+                m_signalSend = true;
+            }
         }
 
         // For debugging, or idle curiosity
@@ -731,6 +789,8 @@ void XBridgeApp::dhtThreadProc()
             std::string dump;
             dht_dump_tables(dump);
             LOG() << dump.c_str();
+            LOG() << "outbound queue" << std::endl << m_messages.dumpStat();
+            LOG() << "wallet connections" << std::endl << rpc::dumpConnectionStat();
             m_signalDump = false;
         }
     }
@@ -951,30 +1011,6 @@ void XBridgeApp::resendAddressBook()
     }
 }
 
-//*****************************************************************************
-//*****************************************************************************
-void XBridgeApp::getAddressBook()
-{
-    boost::mutex::scoped_lock l(m_addressBookLock);
-
-    for (SessionIdMap::iterator i = m_sessionIds.begin(); i != m_sessionIds.end(); ++i)
-    {
-        i->second->requestAddressBook();
-    }
-}
-
-//*****************************************************************************
-//*****************************************************************************
-void XBridgeApp::checkUnconfirmedTx()
-{
-    boost::mutex::scoped_lock l(m_addressBookLock);
-
-    for (SessionIdMap::iterator i = m_sessionIds.begin(); i != m_sessionIds.end(); ++i)
-    {
-        i->second->requestUnconfirmedTx();
-    }
-}
-
 //******************************************************************************
 //******************************************************************************
 uint256 XBridgeApp::sendXBridgeTransaction(const std::vector<unsigned char> & from,
@@ -1025,31 +1061,30 @@ bool XBridgeApp::sendPendingTransaction(XBridgeTransactionDescrPtr & ptr)
 {
     // if (!ptr->packet)
     {
-        ptr->packet.reset(new XBridgePacket(xbcTransaction));
-
-        // field length must be 8 bytes
-        std::vector<unsigned char> fc(8, 0);
-        std::copy(ptr->fromCurrency.begin(), ptr->fromCurrency.end(), fc.begin());
-
-        // field length must be 8 bytes
-        std::vector<unsigned char> tc(8, 0);
-        std::copy(ptr->toCurrency.begin(), ptr->toCurrency.end(), tc.begin());
-
-        // 20 bytes - id of transaction
-        // 2x
-        // 20 bytes - address
-        //  8 bytes - currency
-        //  4 bytes - amount
-        ptr->packet->append(ptr->id.begin(), 32);
-        ptr->packet->append(ptr->from);
-        ptr->packet->append(fc);
-        ptr->packet->append(ptr->fromAmount);
-        ptr->packet->append(ptr->to);
-        ptr->packet->append(tc);
-        ptr->packet->append(ptr->toAmount);
+        typedef XBridgeLayoutTransaction L;
+        XBridgePacketWriter<L> packet(xbcTransaction);
+
+        packet.set<L::Id>(ptr->id)
+              .set<L::SourceAddress>(ptr->from)
+              .setString<L::SourceCurrency>(ptr->fromCurrency)
+              .set<L::SourceAmount>(ptr->fromAmount)
+              .set<L::DestAddress>(ptr->to)
+              .setString<L::DestCurrency>(ptr->toCurrency)
+              .set<L::DestAmount>(ptr->toAmount);
+
+        ptr->packet = packet.packet();
     }
 
-    onSend(ptr->packet);
+    // to hub owning pair, broadcast if no hub known
+    std::vector<unsigned char> hub;
+    if (m_hubRing.owner(ptr->fromCurrency, ptr->toCurrency, hub))
+    {
+        onSend(hub, ptr->packet);
+    }
+    else
+    {
+        onSend(ptr->packet);
+    }
 
     ptr->state = XBridgeTransactionDescr::trPending;
     uiConnector.NotifyXBridgeTransactionStateChanged(ptr->id, XBridgeTransactionDescr::trPending);
@@ -1057,6 +1092,64 @@ bool XBridgeApp::sendPendingTransaction(XBridgeTransactionDescrPtr & ptr)
     return true;
 }
 
+//******************************************************************************
+// resend all pending orders to hubs owning pairs,
+// as many orders per packet as fits into datagram
+//******************************************************************************
+bool XBridgeApp::sendPendingTransactions()
+{
+    typedef XBridgeLayoutTransaction L;
+
+    // group by hub owning pair, empty - no hub known, broadcast
+    typedef std::map<std::vector<unsigned char>, std::vector<XBridgeTransactionDescrPtr> > HubOrders;
+    HubOrders orders;
+
+    for (std::map<uint256, XBridgeTransactionDescrPtr>::iterator i = m_pendingTransactions.begin();
+         i != m_pendingTransactions.end(); ++i)
+    {
+        std::vector<unsigned char> hub;
+        m_hubRing.owner(i->second->fromCurrency, i->second->toCurrency, hub);
+        orders[hub].push_back(i->second);
+    }
+
+    for (HubOrders::iterator h = orders.begin(); h != orders.end(); ++h)
+    {
+        std::vector<XBridgeTransactionDescrPtr>::iterator i = h->second.begin();
+        while (i != h->second.end())
+        {
+            XBridgeRecordsWriter<L> packet(xbcTransaction);
+
+            for (; i != h->second.end() && !packet.full(); ++i)
+            {
+                XBridgeTransactionDescrPtr & ptr = *i;
+
+                packet.addRecord()
+                      .set<L::Id>(ptr->id)
+                      .set<L::SourceAddress>(ptr->from)
+                      .setString<L::SourceCurrency>(ptr->fromCurrency)
+                      .set<L::SourceAmount>(ptr->fromAmount)
+                      .set<L::DestAddress>(ptr->to)
+                      .setString<L::DestCurrency>(ptr->toCurrency)
+                      .set<L::DestAmount>(ptr->toAmount);
+
+                ptr->state = XBridgeTransactionDescr::trPending;
+                uiConnector.NotifyXBridgeTransactionStateChanged(ptr->id, XBridgeTransactionDescr::trPending);
+            }
+
+            if (h->first.empty())
+            {
+                onSend(packet.packet());
+            }
+            else
+            {
+                onSend(h->first, packet.packet());
+            }
+        }
+    }
+
+    return true;
+}
+
 //******************************************************************************
 //******************************************************************************
 bool XBridgeApp::cancelXBridgeTransaction(const uint256 & id)
@@ -1077,15 +1170,52 @@ bool XBridgeApp::cancelXBridgeTransaction(const uint256 & id)
 //******************************************************************************
 bool XBridgeApp::sendCancelTransaction(const uint256 & txid)
 {
-    XBridgePacketPtr reply(new XBridgePacket(xbcTransactionCancel));
-    reply->append(txid.begin(), 32);
+    XBridgePacketWriter<XBridgeLayoutTxId> reply(xbcTransactionCancel);
+    reply.set<XBridgeLayoutTxId::Id>(txid);
+
+    // to hub holding order, broadcast if not known
+    std::vector<unsigned char> hub;
+    {
+        boost::mutex::scoped_lock l(m_txLocker);
+
+        std::map<uint256, XBridgeTransactionDescrPtr>::iterator i = m_transactions.find(txid);
+        if (i != m_transactions.end())
+        {
+            hub = i->second->hubAddress;
+            if (hub.empty())
+            {
+                m_hubRing.owner(i->second->fromCurrency, i->second->toCurrency, hub);
+            }
+        }
+    }
 
-    onSend(reply);
+    if (hub.empty())
+    {
+        onSend(reply.packet());
+    }
+    else
+    {
+        onSend(hub, reply.packet());
+    }
 
     // cancelled
     return true;
 }
 
+//******************************************************************************
+//******************************************************************************
+bool XBridgeApp::signRecord(const uint256 & hash, std::vector<unsigned char> & signature)
+{
+    boost::mutex::scoped_lock l(m_keyLock);
+
+    if (m_key.IsNull())
+    {
+        return false;
+    }
+
+    return m_key.SignCompact(hash, signature);
+}
+
 //******************************************************************************
 //******************************************************************************
 int XBridgeApp::peersCount() const
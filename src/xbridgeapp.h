@@ -8,6 +8,11 @@
 #include "xbridgesession.h"
 #include "util/uint256.h"
 #include "xbridgetransactiondescr.h"
+#include "xbridgemessagequeue.h"
+#include "xbridgeorderbook.h"
+#include "xbridgehubring.h"
+#include "xbridgeutxocache.h"
+#include "key.h"
 
 #include <thread>
 #include <atomic>
@@ -32,6 +37,12 @@ class XBridgeApp
                          const unsigned char * info_hash,
                          const void * data, size_t data_len);
 
+    enum
+    {
+        // max messages sent per one dht loop
+        SEND_BUDGET = 64
+    };
+
 private:
     XBridgeApp();
     virtual ~XBridgeApp();
@@ -53,6 +64,8 @@ public:
                                    const std::string & toCurrency,
                                    const boost::uint64_t toAmount);
     bool sendPendingTransaction(XBridgeTransactionDescrPtr & ptr);
+    // m_txLocker must be locked
+    bool sendPendingTransactions();
 
     bool cancelXBridgeTransaction(const uint256 & id);
     bool sendCancelTransaction(const uint256 & txid);
@@ -65,6 +78,18 @@ public:
 public:
     const unsigned char * myid() const { return m_myid; }
 
+    // compact signature by key of myid, false if id not generated yet
+    bool signRecord(const uint256 & hash, std::vector<unsigned char> & signature);
+
+    // copies of hubs order books
+    XBridgeOrderBooks & orderBooks() { return m_orderBooks; }
+
+    // owners of currency pairs
+    XBridgeHubRing & hubRing() { return m_hubRing; }
+
+    // unspent outputs of local wallets
+    XBridgeUtxoCache & utxoCache() { return m_utxoCache; }
+
     bool initDht();
     bool stopDht();
 
@@ -102,10 +127,6 @@ public:// slots:
                                const std::string & address);
     void resendAddressBook();
 
-    void getAddressBook();
-
-    void checkUnconfirmedTx();
-
 public:
     static void sleep(const unsigned int umilliseconds);
 
@@ -116,6 +137,10 @@ private:
 private:
     unsigned char     m_myid[20];
 
+    // myid is hash160 of public key, signs capability records of hub
+    boost::mutex      m_keyLock;
+    CKey              m_key;
+
     boost::thread_group m_threads;
     // std::thread       m_dhtThread;
     std::atomic<bool> m_dhtStarted;
@@ -127,10 +152,15 @@ private:
     std::atomic<bool> m_signalSend;
 
     typedef std::vector<unsigned char> UcharVector;
-    typedef std::tuple<UcharVector, UcharVector, bool> MessagePair;
 
     std::list<std::string> m_searchStrings;
-    std::list<MessagePair> m_messages;
+    XBridgeMessageQueue    m_messages;
+
+    XBridgeOrderBooks      m_orderBooks;
+
+    XBridgeHubRing         m_hubRing;
+
+    XBridgeUtxoCache       m_utxoCache;
 
     const bool        m_ipv4;
     const bool        m_ipv6;
@@ -0,0 +1,381 @@
+//*****************************************************************************
+//*****************************************************************************
+
+#include "xbridgecoinselector.h"
+#include "util/logger.h"
+
+#include <algorithm>
+#include <random>
+
+//*****************************************************************************
+//*****************************************************************************
+namespace
+{
+
+//*****************************************************************************
+// indexes ordered by value, largest first
+//*****************************************************************************
+struct ValueGreater
+{
+    const std::vector<boost::uint64_t> & values;
+
+    explicit ValueGreater(const std::vector<boost::uint64_t> & v) : values(v) {}
+
+    bool operator()(const std::size_t l, const std::size_t r) const
+    {
+        return values[l] > values[r];
+    }
+};
+
+//*****************************************************************************
+// random subsets of values (sorted descending) with sum closest above
+// target, stops early at sum not above stopAt. returns best sum,
+// all values included if nothing better found
+//*****************************************************************************
+boost::uint64_t approximateBestSubset(const std::vector<boost::uint64_t> & values,
+                                      const boost::uint64_t total,
+                                      const boost::uint64_t target,
+                                      const boost::uint64_t stopAt,
+                                      const unsigned int passes,
+                                      std::mt19937 & rng,
+                                      std::vector<char> & best)
+{
+    std::vector<char> included;
+
+    best.assign(values.size(), 1);
+    boost::uint64_t bestSum = total;
+
+    for (unsigned int rep = 0; rep < passes && bestSum > stopAt; ++rep)
+    {
+        included.assign(values.size(), 0);
+        boost::uint64_t sum = 0;
+        bool reached = false;
+
+        // random subset first, then fill up with rest
+        for (unsigned int pass = 0; pass < 2 && !reached; ++pass)
+        {
+            for (std::size_t i = 0; i < values.size(); ++i)
+            {
+                if (pass == 0 ? (rng() & 1) != 0 : !included[i])
+                {
+                    sum += values[i];
+                    included[i] = 1;
+
+                    if (sum >= target)
+                    {
+                        reached = true;
+                        if (sum < bestSum)
+                        {
+                            bestSum = sum;
+                            best = included;
+                        }
+
+                        // try without it
+                        sum -= values[i];
+                        included[i] = 0;
+                    }
+                }
+            }
+        }
+    }
+
+    return bestSum;
+}
+
+} // namespace
+
+//*****************************************************************************
+//*****************************************************************************
+// static
+XBridgeCoinSelectorPtr XBridgeCoinSelector::create(const std::string & name)
+{
+    if (name == "largest")
+    {
+        return XBridgeCoinSelectorPtr(new XBridgeLargestFirstSelector);
+    }
+
+    boost::shared_ptr<XBridgeCoinSelectorChain> chain(new XBridgeCoinSelectorChain);
+
+    if (name != "knapsack")
+    {
+        if (name != "bnb" && !name.empty())
+        {
+            LOG() << "unknown coin selection <" << name << ">, bnb used";
+        }
+        chain->append(XBridgeCoinSelectorPtr(new XBridgeBnBSelector));
+    }
+
+    chain->append(XBridgeCoinSelectorPtr(new XBridgeKnapsackSelector));
+    chain->append(XBridgeCoinSelectorPtr(new XBridgeLargestFirstSelector));
+
+    return chain;
+}
+
+//*****************************************************************************
+//*****************************************************************************
+bool XBridgeBnBSelector::select(const std::vector<boost::uint64_t> & values,
+                                const boost::uint64_t target,
+                                const boost::uint64_t changeCost,
+                                std::vector<std::size_t> & selected)
+{
+    const boost::uint64_t upper = target + changeCost;
+
+    // outputs above window never part of match
+    std::vector<std::size_t> pool;
+    boost::uint64_t available = 0;
+    for (std::size_t i = 0; i < values.size(); ++i)
+    {
+        if (values[i] > 0 && values[i] <= upper)
+        {
+            pool.push_back(i);
+            available += values[i];
+        }
+    }
+
+    if (available < target)
+    {
+        return false;
+    }
+
+    std::sort(pool.begin(), pool.end(), ValueGreater(values));
+
+    // positions in pool
+    std::vector<std::size_t> current;
+    std::vector<std::size_t> best;
+    boost::uint64_t sum = 0;
+    boost::uint64_t bestSum = 0;
+
+    std::size_t pos = 0;
+    for (unsigned int tries = 0; tries < maxTries; ++tries, ++pos)
+    {
+        bool backtrack = false;
+        if (sum + available < target || sum > upper)
+        {
+            backtrack = true;
+        }
+        else if (sum >= target)
+        {
+            // match, fewer inputs or same inputs and smaller excess
+            if (best.empty() || current.size() < best.size() ||
+                (current.size() == best.size() && sum < bestSum))
+            {
+                best    = current;
+                bestSum = sum;
+            }
+            backtrack = true;
+        }
+        else if (!best.empty() && current.size() + 1 > best.size())
+        {
+            // only more inputs down this branch
+            backtrack = true;
+        }
+
+        if (backtrack)
+        {
+            if (current.empty())
+            {
+                // all branches done
+                break;
+            }
+
+            // skipped outputs back to available, then exclude last included
+            for (--pos; pos > current.back(); --pos)
+            {
+                available += values[pool[pos]];
+            }
+
+            sum -= values[pool[pos]];
+            current.pop_back();
+        }
+        else
+        {
+            const boost::uint64_t value = values[pool[pos]];
+            available -= value;
+
+            // equal value after excluded one gives same subsets
+            if (current.empty() || pos - 1 == current.back() ||
+                value != values[pool[pos - 1]])
+            {
+                current.push_back(pos);
+                sum += value;
+            }
+        }
+    }
+
+    if (best.empty())
+    {
+        return false;
+    }
+
+    for (std::size_t i = 0; i < best.size(); ++i)
+    {
+        selected.push_back(pool[best[i]]);
+    }
+    return true;
+}
+
+//*****************************************************************************
+//*****************************************************************************
+bool XBridgeKnapsackSelector::select(const std::vector<boost::uint64_t> & values,
+                                     const boost::uint64_t target,
+                                     const boost::uint64_t changeCost,
+                                     std::vector<std::size_t> & selected)
+{
+    const boost::uint64_t upper = target + changeCost;
+
+    std::vector<std::size_t> smaller;
+    boost::uint64_t totalSmaller = 0;
+
+    // smallest single output not above window, smallest above window
+    std::size_t exact  = values.size();
+    std::size_t larger = values.size();
+
+    for (std::size_t i = 0; i < values.size(); ++i)
+    {
+        const boost::uint64_t value = values[i];
+        if (value == 0)
+        {
+            continue;
+        }
+
+        if (value >= target && value <= upper)
+        {
+            if (exact == values.size() || value < values[exact])
+            {
+                exact = i;
+            }
+        }
+        else if (value > upper)
+        {
+            if (larger == values.size() || value < values[larger])
+            {
+                larger = i;
+            }
+        }
+        else
+        {
+            smaller.push_back(i);
+            totalSmaller += value;
+        }
+    }
+
+    // one input, no change
+    if (exact != values.size())
+    {
+        selected.push_back(exact);
+        return true;
+    }
+
+    if (totalSmaller < target)
+    {
+        if (larger == values.size())
+        {
+            return false;
+        }
+
+        selected.push_back(larger);
+        return true;
+    }
+
+    std::sort(smaller.begin(), smaller.end(), ValueGreater(values));
+
+    std::vector<boost::uint64_t> smallerValues;
+    smallerValues.reserve(smaller.size());
+    for (std::size_t i = 0; i < smaller.size(); ++i)
+    {
+        smallerValues.push_back(values[smaller[i]]);
+    }
+
+    unsigned int passes = maxPasses;
+    if (smaller.size() * passes > maxWork)
+    {
+        passes = std::max<unsigned int>(1, maxWork / smaller.size());
+    }
+
+    std::mt19937 rng(static_cast<boost::uint32_t>(target));
+
+    // no change first, then change above changeCost
+    std::vector<char> best;
+    boost::uint64_t bestSum = approximateBestSubset(smallerValues, totalSmaller,
+                                                    target, upper, passes, rng, best);
+    if (bestSum > upper && totalSmaller > upper)
+    {
+        bestSum = approximateBestSubset(smallerValues, totalSmaller,
+                                        upper + 1, upper + 1, passes, rng, best);
+    }
+
+    // single larger output if subset gives change and is not smaller
+    if (larger != values.size() && bestSum > upper && values[larger] <= bestSum)
+    {
+        selected.push_back(larger);
+        return true;
+    }
+
+    for (std::size_t i = 0; i < best.size(); ++i)
+    {
+        if (best[i])
+        {
+            selected.push_back(smaller[i]);
+        }
+    }
+    return true;
+}
+
+//*****************************************************************************
+//*****************************************************************************
+bool XBridgeLargestFirstSelector::select(const std::vector<boost::uint64_t> & values,
+                                         const boost::uint64_t target,
+                                         const boost::uint64_t /*changeCost*/,
+                                         std::vector<std::size_t> & selected)
+{
+    std::vector<std::size_t> order;
+    order.reserve(values.size());
+    for (std::size_t i = 0; i < values.size(); ++i)
+    {
+        order.push_back(i);
+    }
+
+    std::sort(order.begin(), order.end(), ValueGreater(values));
+
+    boost::uint64_t sum = 0;
+    std::size_t count = 0;
+    while (count < order.size() && sum < target)
+    {
+        sum += values[order[count++]];
+    }
+
+    if (sum < target)
+    {
+        return false;
+    }
+
+    selected.insert(selected.end(), order.begin(), order.begin() + count);
+    return true;
+}
+
+//*****************************************************************************
+//*****************************************************************************
+void XBridgeCoinSelectorChain::append(XBridgeCoinSelectorPtr selector)
+{
+    m_selectors.push_back(selector);
+}
+
+//*****************************************************************************
+//*****************************************************************************
+bool XBridgeCoinSelectorChain::select(const std::vector<boost::uint64_t> & values,
+                                      const boost::uint64_t target,
+                                      const boost::uint64_t changeCost,
+                                      std::vector<std::size_t> & selected)
+{
+    for (std::vector<XBridgeCoinSelectorPtr>::iterator i = m_selectors.begin(); i != m_selectors.end(); ++i)
+    {
+        selected.clear();
+        if ((*i)->select(values, target, changeCost, selected))
+        {
+            return true;
+        }
+    }
+
+    selected.clear();
+    return false;
+}
@@ -0,0 +1,114 @@
+//*****************************************************************************
+//*****************************************************************************
+
+#ifndef XBRIDGECOINSELECTOR_H
+#define XBRIDGECOINSELECTOR_H
+
+#include <string>
+#include <vector>
+
+#include <boost/cstdint.hpp>
+#include <boost/shared_ptr.hpp>
+
+class XBridgeCoinSelector;
+typedef boost::shared_ptr<XBridgeCoinSelector> XBridgeCoinSelectorPtr;
+
+//*****************************************************************************
+// choice of inputs for payment
+//
+// values are amounts of candidate outputs, selected gets indexes of
+// chosen outputs. sum of selection at least target. excess up to
+// changeCost is left to fee, transaction then has no change output
+//*****************************************************************************
+class XBridgeCoinSelector
+{
+public:
+    virtual ~XBridgeCoinSelector() {}
+
+    virtual bool select(const std::vector<boost::uint64_t> & values,
+                        const boost::uint64_t target,
+                        const boost::uint64_t changeCost,
+                        std::vector<std::size_t> & selected) = 0;
+
+    // by name from config (Main.CoinSelection), bnb, knapsack or largest.
+    // bnb falls back to knapsack, knapsack to largest
+    static XBridgeCoinSelectorPtr create(const std::string & name);
+};
+
+//*****************************************************************************
+// branch and bound, exact match without change
+//
+// depth first over values sorted descending, branch cut when sum
+// exceeds target + changeCost or remaining values can not reach target.
+// match with fewest inputs kept, search bounded by maxTries
+//*****************************************************************************
+class XBridgeBnBSelector : public XBridgeCoinSelector
+{
+public:
+    enum
+    {
+        maxTries = 100000
+    };
+
+public:
+    virtual bool select(const std::vector<boost::uint64_t> & values,
+                        const boost::uint64_t target,
+                        const boost::uint64_t changeCost,
+                        std::vector<std::size_t> & selected);
+};
+
+//*****************************************************************************
+// knapsack with change
+//
+// exact single output taken at once. otherwise random subsets of
+// outputs smaller than target + changeCost approximated to smallest
+// sum above target, compared with smallest single larger output.
+// passes bounded by maxWork / number of outputs for large wallets
+//*****************************************************************************
+class XBridgeKnapsackSelector : public XBridgeCoinSelector
+{
+public:
+    enum
+    {
+        maxPasses = 1000,
+        maxWork   = 4000000
+    };
+
+public:
+    virtual bool select(const std::vector<boost::uint64_t> & values,
+                        const boost::uint64_t target,
+                        const boost::uint64_t changeCost,
+                        std::vector<std::size_t> & selected);
+};
+
+//*****************************************************************************
+// largest outputs first, fewest inputs, always succeeds if balance
+// is enough
+//*****************************************************************************
+class XBridgeLargestFirstSelector : public XBridgeCoinSelector
+{
+public:
+    virtual bool select(const std::vector<boost::uint64_t> & values,
+                        const boost::uint64_t target,
+                        const boost::uint64_t changeCost,
+                        std::vector<std::size_t> & selected);
+};
+
+//*****************************************************************************
+// first selector which succeeds
+//*****************************************************************************
+class XBridgeCoinSelectorChain : public XBridgeCoinSelector
+{
+public:
+    void append(XBridgeCoinSelectorPtr selector);
+
+    virtual bool select(const std::vector<boost::uint64_t> & values,
+                        const boost::uint64_t target,
+                        const boost::uint64_t changeCost,
+                        std::vector<std::size_t> & selected);
+
+private:
+    std::vector<XBridgeCoinSelectorPtr> m_selectors;
+};
+
+#endif // XBRIDGECOINSELECTOR_H
@@ -9,9 +9,13 @@
 
 #include <algorithm>
 
+#include <boost/date_time/posix_time/posix_time.hpp>
+
 //*****************************************************************************
 //*****************************************************************************
 XBridgeExchange::XBridgeExchange()
+    : m_hubRingEnabled(false)
+    , m_fee(0)
 {
 }
 
@@ -42,6 +46,9 @@ bool XBridgeExchange::init()
 
     Settings & s = settings();
 
+    m_hubRingEnabled = s.get<bool>("Main.HubRing", false);
+    m_fee            = s.get<boost::uint32_t>("Main.Fee", 0);
+
     std::vector<std::string> wallets = s.exchangeWallets();
     for (std::vector<std::string>::iterator i = wallets.begin(); i != wallets.end(); ++i)
     {
@@ -86,6 +93,11 @@ bool XBridgeExchange::init()
     if (isEnabled())
     {
         LOG() << "exchange enabled";
+
+        if (m_hubRingEnabled)
+        {
+            LOG() << "hub ring enabled, currency pairs shared with other hubs";
+        }
     }
 
     return true;
@@ -120,6 +132,9 @@ std::vector<unsigned char> XBridgeExchange::walletAddress(const std::string & wa
 }
 
 //*****************************************************************************
+// match order against order book, each fill (complete or partial)
+// creates joined transaction, rest of order placed into book.
+// dropped - rest of order too small to fill or rest, client must cancel
 //*****************************************************************************
 bool XBridgeExchange::createTransaction(const uint256 & id,
                                         const std::vector<unsigned char> & sourceAddr,
@@ -128,19 +143,12 @@ bool XBridgeExchange::createTransaction(const uint256 & id,
                                         const std::vector<unsigned char> & destAddr,
                                         const std::string & destCurrency,
                                         const boost::uint64_t & destAmount,
-                                        uint256 & transactionId)
+                                        std::vector<XBridgeFill> & fills,
+                                        bool & dropped)
 {
-    DEBUG_TRACE();
+    dropped = false;
 
-//    {
-//        boost::mutex::scoped_lock l(m_knownTxLock);
-//        if (m_knownTransactions.count(transactionId))
-//        {
-//            return false;
-//        }
-//        m_knownTransactions.insert(transactionId);
-//    }
-    // transactionId = id;
+    DEBUG_TRACE();
 
     XBridgeTransactionPtr tr(new XBridgeTransaction(id,
                                                     sourceAddr, sourceCurrency,
@@ -148,78 +156,87 @@ bool XBridgeExchange::createTransaction(const uint256 & id,
                                                     destAddr, destCurrency,
                                                     destAmount));
 
-    LOG() << tr->hash1().ToString();
-    LOG() << tr->hash2().ToString();
-
-    if (!tr->isValid())
+    if (!tr->isValid() || !sourceAmount || !destAmount || sourceCurrency == destCurrency)
     {
         return false;
     }
 
-    uint256 h = tr->hash2();
+    std::vector<XBridgeTransactionPtr> joined;
 
-    XBridgeTransactionPtr tmp;
+    PairBookPtr book = pairBook(sourceCurrency, destCurrency);
 
     {
-        boost::mutex::scoped_lock l(m_pendingTransactionsLock);
+        boost::mutex::scoped_lock l(book->lock);
 
-        if (!m_pendingTransactions.count(h))
+        if (m_pendingTransactions.contains(id))
         {
-            // new transaction or update existing (update timestamp)
-            h = tr->hash1();
-            m_pendingTransactions[h] = tr;
+            // resent by client, rest of order is in book, update timestamp
+            m_pendingTransactions.set(id, tr);
+            m_pendingDeadlines.schedule(id, XBridgeTransaction::TTL);
+            return true;
         }
-        else
+
+        XBridgeOrder rest = book->matcher.add(XBridgeOrder(id,
+                                                       sourceCurrency, sourceAmount,
+                                                       destCurrency, destAmount),
+                                          fills, dropped);
+
+        for (std::vector<XBridgeFill>::iterator i = fills.begin(); i != fills.end(); ++i)
         {
-            boost::mutex::scoped_lock l2(m_pendingTransactions[h]->m_lock);
+            XBridgeTransactionPtr resting;
+            if (!m_pendingTransactions.get(i->restingId, resting))
+            {
+                assert(!"resting order without transaction");
+                continue;
+            }
 
-            // found, check if expired
-            if (m_pendingTransactions[h]->isExpired())
+            // first member - resting order, second - incoming order
+            XBridgeTransactionPtr first(new XBridgeTransaction(i->restingId,
+                                                               resting->firstAddress(),
+                                                               resting->firstCurrency(),
+                                                               i->sourceAmount,
+                                                               resting->firstDestination(),
+                                                               resting->secondCurrency(),
+                                                               i->destAmount));
+            XBridgeTransactionPtr second(new XBridgeTransaction(id,
+                                                                sourceAddr, sourceCurrency,
+                                                                i->destAmount,
+                                                                destAddr, destCurrency,
+                                                                i->sourceAmount));
+
+            if (!first->tryJoin(second))
             {
-                // if expired - delete old transaction
-                m_pendingTransactions.erase(h);
+                ERR() << "fill of <" << i->restingId.GetHex() << "> not joined " << __FUNCTION__;
+                continue;
+            }
+
+            LOG() << "transactions joined, new id <" << first->id().GetHex() << ">";
+
+            i->transactionId = first->id();
+            joined.push_back(first);
 
-                // create new
-                h = tr->hash1();
-                m_pendingTransactions[h] = tr;
+            if (i->restingRest.fromAmount)
+            {
+                // partial fill, rest of order stays in book
+                m_orderBook.add(i->restingId, i->restingRest);
             }
             else
             {
-                // try join with existing transaction
-                if (!m_pendingTransactions[h]->tryJoin(tr))
-                {
-                    LOG() << "transaction not joined";
-                    // return false;
-
-                    // create new transaction
-                    h = tr->hash1();
-                    m_pendingTransactions[h] = tr;
-                }
-                else
-                {
-                    LOG() << "transactions joined, new id <" << tr->id().GetHex() << ">";
-
-                    tmp = m_pendingTransactions[h];
-                }
+                erasePendingTransaction(*book, i->restingId);
             }
         }
-    }
 
-    if (tmp)
-    {
-        // new transaction id
-        transactionId = tmp->id();
-
-        // move to transactions
-        {
-            boost::mutex::scoped_lock l(m_transactionsLock);
-            m_transactions[tmp->id()] = tmp;
-        }
+        if (rest.fromAmount)
         {
-            boost::mutex::scoped_lock l(m_pendingTransactionsLock);
-            m_pendingTransactions.erase(h);
+            setPendingTransaction(id, tr, rest);
         }
+    }
 
+    // move to transactions
+    for (std::vector<XBridgeTransactionPtr>::iterator i = joined.begin(); i != joined.end(); ++i)
+    {
+        m_transactions.set((*i)->id(), *i);
+        stateChanged(*i);
     }
 
     return true;
@@ -229,23 +246,70 @@ bool XBridgeExchange::createTransaction(const uint256 & id,
 //*****************************************************************************
 bool XBridgeExchange::deletePendingTransactions(const uint256 & id)
 {
-    boost::mutex::scoped_lock l(m_pendingTransactionsLock);
+    XBridgeTransactionPtr tr;
+    if (!m_pendingTransactions.get(id, tr))
+    {
+        return true;
+    }
+
+    PairBookPtr book = pairBook(tr->firstCurrency(), tr->secondCurrency());
+    boost::mutex::scoped_lock l(book->lock);
 
     LOG() << "delete pending transaction <" << id.GetHex() << ">";
 
-    m_pendingTransactions.erase(id);
+    erasePendingTransaction(*book, id);
     return true;
 }
 
 //*****************************************************************************
 //*****************************************************************************
-bool XBridgeExchange::deleteTransaction(const uint256 & id)
+XBridgeExchange::PairBookPtr XBridgeExchange::pairBook(const std::string & currency1,
+                                                       const std::string & currency2)
 {
-    boost::mutex::scoped_lock l(m_transactionsLock);
+    PairKey key = currency1 < currency2 ? PairKey(currency1, currency2) :
+                                          PairKey(currency2, currency1);
+
+    boost::mutex::scoped_lock l(m_pairBooksLock);
+
+    PairBookPtr & book = m_pairBooks[key];
+    if (!book)
+    {
+        book.reset(new PairBook);
+    }
+    return book;
+}
 
+//*****************************************************************************
+// book of pair must be locked
+//*****************************************************************************
+void XBridgeExchange::setPendingTransaction(const uint256 & id,
+                                            const XBridgeTransactionPtr & tr,
+                                            const XBridgeOrder & rest)
+{
+    m_pendingTransactions.set(id, tr);
+    m_pendingDeadlines.schedule(id, XBridgeTransaction::TTL);
+    m_orderBook.add(id, rest);
+}
+
+//*****************************************************************************
+// book of pair must be locked
+//*****************************************************************************
+void XBridgeExchange::erasePendingTransaction(PairBook & book, const uint256 & id)
+{
+    m_pendingTransactions.erase(id);
+    m_pendingDeadlines.cancel(id);
+    book.matcher.remove(id);
+    m_orderBook.remove(id);
+}
+
+//*****************************************************************************
+//*****************************************************************************
+bool XBridgeExchange::deleteTransaction(const uint256 & id)
+{
     LOG() << "delete transaction <" << id.GetHex() << ">";
 
     m_transactions.erase(id);
+    m_deadlines.cancel(id);
     return true;
 }
 
@@ -254,7 +318,7 @@ bool XBridgeExchange::deleteTransaction(const uint256 & id)
 bool XBridgeExchange::updateTransactionWhenHoldApplyReceived(XBridgeTransactionPtr tx,
                                                              const std::vector<unsigned char> & from)
 {
-    if (tx->increaseStateCounter(XBridgeTransaction::trJoined, from) == XBridgeTransaction::trHold)
+    if (increaseStateCounter(tx, XBridgeTransaction::trJoined, from) == XBridgeTransaction::trHold)
     {
         return true;
     }
@@ -267,7 +331,7 @@ bool XBridgeExchange::updateTransactionWhenHoldApplyReceived(XBridgeTransactionP
 bool XBridgeExchange::updateTransactionWhenInitializedReceived(XBridgeTransactionPtr tx,
                                                                const std::vector<unsigned char> & from)
 {
-    if (tx->increaseStateCounter(XBridgeTransaction::trHold, from) == XBridgeTransaction::trInitialized)
+    if (increaseStateCounter(tx, XBridgeTransaction::trHold, from) == XBridgeTransaction::trInitialized)
     {
         return true;
     }
@@ -279,8 +343,8 @@ bool XBridgeExchange::updateTransactionWhenInitializedReceived(XBridgeTransactio
 //*****************************************************************************
 bool XBridgeExchange::updateTransactionWhenCreatedReceived(XBridgeTransactionPtr tx,
                                                            const std::vector<unsigned char> & from,
-                                                           const std::string & rawpaytx,
-                                                           const std::string & rawrevtx)
+                                                           const std::vector<unsigned char> & rawpaytx,
+                                                           const std::vector<unsigned char> & rawrevtx)
 {
     if (!tx->setRawPayTx(from, rawpaytx, rawrevtx))
     {
@@ -289,7 +353,7 @@ bool XBridgeExchange::updateTransactionWhenCreatedReceived(XBridgeTransactionPtr
         return false;
     }
 
-    if (tx->increaseStateCounter(XBridgeTransaction::trInitialized, from) == XBridgeTransaction::trCreated)
+    if (increaseStateCounter(tx, XBridgeTransaction::trInitialized, from) == XBridgeTransaction::trCreated)
     {
         return true;
     }
@@ -301,7 +365,7 @@ bool XBridgeExchange::updateTransactionWhenCreatedReceived(XBridgeTransactionPtr
 //*****************************************************************************
 bool XBridgeExchange::updateTransactionWhenSignedReceived(XBridgeTransactionPtr tx,
                                                           const std::vector<unsigned char> & from,
-                                                          const std::string & rawrevtx)
+                                                          const std::vector<unsigned char> & rawrevtx)
 {
     if (!tx->updateRawRevTx(from, rawrevtx))
     {
@@ -311,7 +375,7 @@ bool XBridgeExchange::updateTransactionWhenSignedReceived(XBridgeTransactionPtr
     }
 
     // update transaction state
-    if (tx->increaseStateCounter(XBridgeTransaction::trCreated, from) == XBridgeTransaction::trSigned)
+    if (increaseStateCounter(tx, XBridgeTransaction::trCreated, from) == XBridgeTransaction::trSigned)
     {
         return true;
     }
@@ -332,18 +396,25 @@ bool XBridgeExchange::updateTransactionWhenCommitedReceived(XBridgeTransactionPt
         return false;
     }
 
-    {
-        boost::mutex::scoped_lock l (m_unconfirmedLock);
-        m_unconfirmed[txhash] = tx->id();
-    }
-
     // update transaction state
-    if (tx->increaseStateCounter(XBridgeTransaction::trSigned, from) == XBridgeTransaction::trCommited)
+    bool commited = increaseStateCounter(tx, XBridgeTransaction::trSigned, from) == XBridgeTransaction::trCommited;
+
+    // wait for pay tx in wallet
     {
-        return true;
+        boost::mutex::scoped_lock l(m_walletTransactionsLock);
+
+        if (isRecentWalletTransaction(txhash))
+        {
+            // already seen
+            confirm(tx, txhash);
+        }
+        else
+        {
+            m_unconfirmed.set(txhash, tx->id());
+        }
     }
 
-    return false;
+    return commited;
 }
 
 //*****************************************************************************
@@ -352,7 +423,7 @@ bool XBridgeExchange::updateTransactionWhenConfirmedReceived(XBridgeTransactionP
                                                              const std::vector<unsigned char> & from)
 {
     // update transaction state
-    if (tx->increaseStateCounter(XBridgeTransaction::trCommited, from) == XBridgeTransaction::trFinished)
+    if (increaseStateCounter(tx, XBridgeTransaction::trCommited, from) == XBridgeTransaction::trFinished)
     {
         return true;
     }
@@ -362,137 +433,205 @@ bool XBridgeExchange::updateTransactionWhenConfirmedReceived(XBridgeTransactionP
 
 //*****************************************************************************
 //*****************************************************************************
-bool XBridgeExchange::updateTransaction(const uint256 & hash)
+namespace
 {
-    // DEBUG_TRACE();
 
-    // store
-    m_walletTransactions.insert(hash);
+// copy of map values
+struct CollectTransactions
+{
+    std::list<XBridgeTransactionPtr> & list;
+
+    explicit CollectTransactions(std::list<XBridgeTransactionPtr> & l) : list(l) {}
 
-    // check unconfirmed
-    boost::mutex::scoped_lock l (m_unconfirmedLock);
-    if (m_unconfirmed.size())
+    void operator()(const uint256 &, const XBridgeTransactionPtr & tr) const
     {
-        for (std::map<uint256, uint256>::iterator i = m_unconfirmed.begin(); i != m_unconfirmed.end();)
-        {
-            if (m_walletTransactions.count(i->first))
-            {
-                LOG() << "confirm transaction, id <" << i->second.GetHex()
-                      << "> hash <" << i->first.GetHex() << ">";
+        list.push_back(tr);
+    }
+};
 
-                XBridgeTransactionPtr tr = transaction(i->second);
-                boost::mutex::scoped_lock l(tr->m_lock);
+} // namespace
 
-                tr->confirm(i->first);
+//*****************************************************************************
+// transaction seen in wallet, direct lookup by pay tx hash
+//*****************************************************************************
+bool XBridgeExchange::updateTransaction(const uint256 & hash,
+                                        std::list<XBridgeTransactionPtr> & confirmed)
+{
+    // DEBUG_TRACE();
 
-                i = m_unconfirmed.erase(i);
-            }
-            else
-            {
-                ++i;
-            }
-        }
-    }
+    uint256 txid;
 
+    {
+        boost::mutex::scoped_lock l(m_walletTransactionsLock);
 
-//    uint256 txid;
+        if (!m_unconfirmed.take(hash, txid))
+        {
+            // not our transaction or commit not received yet
+            rememberWalletTransaction(hash);
+            return true;
+        }
+    }
 
-//    boost::mutex::scoped_lock l (m_unconfirmedLock);
-//    if (m_unconfirmed.count(hash))
-//    {
-//        txid = m_unconfirmed[hash];
+    LOG() << "confirm transaction, id <" << txid.GetHex()
+          << "> hash <" << hash.GetHex() << ">";
 
-//        LOG() << "confirm transaction, id <"
-//              << util::base64_encode(std::string((char *)(txid.begin()), 32))
-//              << "> hash <"
-//              << util::base64_encode(std::string((char *)(hash.begin()), 32))
-//              << ">";
+    XBridgeTransactionPtr tr = transaction(txid);
+    if (!tr)
+    {
+        return true;
+    }
 
-//        m_unconfirmed.erase(hash);
-//    }
+    boost::mutex::scoped_lock l(tr->m_lock);
 
-//    if (txid != uint256())
-//    {
-//        XBridgeTransactionPtr tr = transaction(txid);
-//        boost::mutex::scoped_lock l(tr->m_lock);
+    confirm(tr, hash);
 
-//        tr->confirm(hash);
-//    }
+    if (tr->state() == XBridgeTransaction::trConfirmed)
+    {
+        // both sides confirmed, finished by caller at once
+        confirmed.push_back(tr);
+    }
 
     return true;
 }
 
 //*****************************************************************************
+// tx must be locked
 //*****************************************************************************
-const XBridgeTransactionPtr XBridgeExchange::transaction(const uint256 & hash)
+void XBridgeExchange::confirm(XBridgeTransactionPtr tx, const uint256 & txhash)
 {
+    if (tx->confirm(txhash))
     {
-        boost::mutex::scoped_lock l(m_transactionsLock);
+        stateChanged(tx);
+    }
+}
 
-        if (m_transactions.count(hash))
-        {
-            return m_transactions[hash];
-        }
-        else
-        {
-            assert(false || "cannot find transaction");
+//*****************************************************************************
+// m_walletTransactionsLock must be locked
+//*****************************************************************************
+bool XBridgeExchange::isRecentWalletTransaction(const uint256 & txhash) const
+{
+    return m_walletTransactions.count(txhash) != 0;
+}
 
-            // unknown transaction
-            LOG() << "unknown transaction, id <" << hash.GetHex() << ">";
-        }
+//*****************************************************************************
+// m_walletTransactionsLock must be locked
+//*****************************************************************************
+void XBridgeExchange::rememberWalletTransaction(const uint256 & txhash)
+{
+    boost::posix_time::ptime now = boost::posix_time::second_clock::universal_time();
+
+    // drop old and over limit
+    while (!m_walletTransactionsQueue.empty() &&
+           (m_walletTransactionsQueue.size() >= maxWalletTransactions ||
+            (now - m_walletTransactionsQueue.front().first).total_seconds() > walletTransactionsTTL))
+    {
+        m_walletTransactions.erase(m_walletTransactionsQueue.front().second);
+        m_walletTransactionsQueue.pop_front();
     }
 
-    // TODO not search in pending transactions
-//    {
-//        boost::mutex::scoped_lock l(m_pendingTransactionsLock);
+    if (m_walletTransactions.insert(txhash).second)
+    {
+        m_walletTransactionsQueue.push_back(std::make_pair(now, txhash));
+    }
+}
 
-//        if (m_pendingTransactions.count(hash))
-//        {
-//            return m_pendingTransactions[hash];
-//        }
-//    }
+//*****************************************************************************
+//*****************************************************************************
+XBridgeTransactionPtr XBridgeExchange::transaction(const uint256 & id) const
+{
+    XBridgeTransactionPtr tr;
+    if (!m_transactions.get(id, tr))
+    {
+        // unknown transaction
+        LOG() << "unknown transaction, id <" << id.GetHex() << ">";
+    }
 
-    // return XBridgeTransaction::trInvalid;
-    return XBridgeTransactionPtr(new XBridgeTransaction);
+    return tr;
 }
 
 //*****************************************************************************
 //*****************************************************************************
 std::list<XBridgeTransactionPtr> XBridgeExchange::pendingTransactions() const
 {
-    boost::mutex::scoped_lock l(m_pendingTransactionsLock);
+    std::list<XBridgeTransactionPtr> list;
+    m_pendingTransactions.forEach(CollectTransactions(list));
+    return list;
+}
 
+//*****************************************************************************
+//*****************************************************************************
+std::list<XBridgeTransactionPtr> XBridgeExchange::transactions() const
+{
     std::list<XBridgeTransactionPtr> list;
+    m_transactions.forEach(CollectTransactions(list));
+    return list;
+}
 
-    for (std::map<uint256, XBridgeTransactionPtr>::const_iterator i = m_pendingTransactions.begin();
-         i != m_pendingTransactions.end(); ++i)
+//*****************************************************************************
+// tx must be locked
+//*****************************************************************************
+void XBridgeExchange::updateTimestamp(XBridgeTransactionPtr tx)
+{
+    tx->updateTimestamp();
+    m_deadlines.schedule(tx->id(), XBridgeTransaction::stateTimeout(tx->state()));
+}
+
+//*****************************************************************************
+// tx must be locked
+//*****************************************************************************
+XBridgeTransaction::State XBridgeExchange::increaseStateCounter(XBridgeTransactionPtr tx,
+                                                                const XBridgeTransaction::State state,
+                                                                const std::vector<unsigned char> & from)
+{
+    XBridgeTransaction::State prev = tx->state();
+    XBridgeTransaction::State next = tx->increaseStateCounter(state, from);
+
+    if (next != XBridgeTransaction::trInvalid && next != prev)
     {
-        list.push_back(i->second);
+        stateChanged(tx);
     }
 
-    return list;
+    return next;
 }
 
 //*****************************************************************************
+// timeout of new state, terminal states handled on next tick
 //*****************************************************************************
-std::list<XBridgeTransactionPtr> XBridgeExchange::transactions(bool onlyFinished) const
+void XBridgeExchange::stateChanged(XBridgeTransactionPtr tx)
 {
-    boost::mutex::scoped_lock l(m_transactionsLock);
+    LOG() << "transaction <" << tx->id().GetHex() << "> state " << tx->strState();
 
-    std::list<XBridgeTransactionPtr> list;
+    m_deadlines.schedule(tx->id(), XBridgeTransaction::stateTimeout(tx->state()));
+}
+
+//*****************************************************************************
+//*****************************************************************************
+void XBridgeExchange::scheduleTransaction(const uint256 & id, const boost::uint32_t seconds)
+{
+    m_deadlines.schedule(id, seconds);
+}
 
-    for (std::map<uint256, XBridgeTransactionPtr>::const_iterator i = m_transactions.begin(); i != m_transactions.end(); ++i)
+//*****************************************************************************
+//*****************************************************************************
+void XBridgeExchange::schedulePendingTransaction(const uint256 & id, const boost::uint32_t seconds)
+{
+    m_pendingDeadlines.schedule(id, seconds);
+}
+
+//*****************************************************************************
+//*****************************************************************************
+std::list<XBridgeTransactionPtr> XBridgeExchange::dueTransactions()
+{
+    std::vector<uint256> due;
+    m_deadlines.advance(due);
+
+    std::list<XBridgeTransactionPtr> list;
+    for (std::vector<uint256>::iterator i = due.begin(); i != due.end(); ++i)
     {
-        if (!onlyFinished)
+        XBridgeTransactionPtr tr;
+        if (m_transactions.get(*i, tr))
         {
-            list.push_back(i->second);
-        }
-        else if (i->second->isExpired() ||
-                 !i->second->isValid() ||
-                 i->second->isFinished() ||
-                 i->second->state() == XBridgeTransaction::trConfirmed)
-        {
-            list.push_back(i->second);
+            list.push_back(tr);
         }
     }
 
@@ -501,16 +640,29 @@ std::list<XBridgeTransactionPtr> XBridgeExchange::transactions(bool onlyFinished
 
 //*****************************************************************************
 //*****************************************************************************
-std::list<XBridgeTransactionPtr> XBridgeExchange::transactions() const
+std::list<XBridgeTransactionPtr> XBridgeExchange::duePendingTransactions()
 {
-    return transactions(false);
+    std::vector<uint256> due;
+    m_pendingDeadlines.advance(due);
+
+    std::list<XBridgeTransactionPtr> list;
+    for (std::vector<uint256>::iterator i = due.begin(); i != due.end(); ++i)
+    {
+        XBridgeTransactionPtr tr;
+        if (m_pendingTransactions.get(*i, tr))
+        {
+            list.push_back(tr);
+        }
+    }
+
+    return list;
 }
 
 //*****************************************************************************
 //*****************************************************************************
-std::list<XBridgeTransactionPtr> XBridgeExchange::finishedTransactions() const
+boost::uint32_t XBridgeExchange::load() const
 {
-    return transactions(true);
+    return static_cast<boost::uint32_t>(m_pendingTransactions.size() + m_transactions.size());
 }
 
 //*****************************************************************************
@@ -6,14 +6,22 @@
 
 #include "util/uint256.h"
 #include "xbridgetransaction.h"
+#include "xbridgeorderbook.h"
+#include "xbridgematcher.h"
+#include "xbridgeshardedmap.h"
+#include "xbridgetimingwheel.h"
 
 #include <string>
 #include <set>
 #include <map>
 #include <list>
+#include <deque>
 
 #include <boost/cstdint.hpp>
+#include <boost/shared_ptr.hpp>
 #include <boost/thread/mutex.hpp>
+#include <boost/unordered_set.hpp>
+#include <boost/date_time/posix_time/ptime.hpp>
 
 //*****************************************************************************
 //*****************************************************************************
@@ -35,6 +43,15 @@ struct WalletParam
 //*****************************************************************************
 class XBridgeExchange
 {
+public:
+    enum
+    {
+        // wallet transactions remembered for late commits
+        maxWalletTransactions = 4096,
+        // seconds
+        walletTransactionsTTL = 600
+    };
+
 public:
     static XBridgeExchange & instance();
 
@@ -46,6 +63,15 @@ public:
     bool init();
 
     bool isEnabled();
+
+    // match only pairs owned by this hub on hub ring, Main.HubRing
+    bool isHubRingEnabled() const { return m_hubRingEnabled; }
+
+    // announced in capability record of hub
+    // fee in basis points, Main.Fee
+    boost::uint32_t fee() const { return m_fee; }
+    // open orders and swaps
+    boost::uint32_t load() const;
     bool haveConnectedWallet(const std::string & walletName);
 
     std::vector<unsigned char> walletAddress(const std::string & walletName);
@@ -57,7 +83,8 @@ public:
                            const std::vector<unsigned char> & destAddr,
                            const std::string & destCurrency,
                            const boost::uint64_t & destAmount,
-                           uint256 & transactionId);
+                           std::vector<XBridgeFill> & fills,
+                           bool & dropped);
     bool deletePendingTransactions(const uint256 & id);
     bool deleteTransaction(const uint256 & id);
 
@@ -67,45 +94,115 @@ public:
                                                   const std::vector<unsigned char> & from);
     bool updateTransactionWhenCreatedReceived(XBridgeTransactionPtr tx,
                                               const std::vector<unsigned char> & from,
-                                              const std::string & rawpaytx,
-                                              const std::string & rawrevtx);
+                                              const std::vector<unsigned char> & rawpaytx,
+                                              const std::vector<unsigned char> & rawrevtx);
     bool updateTransactionWhenSignedReceived(XBridgeTransactionPtr tx,
                                              const std::vector<unsigned char> & from,
-                                             const std::string & rawrevtx);
+                                             const std::vector<unsigned char> & rawrevtx);
     bool updateTransactionWhenCommitedReceived(XBridgeTransactionPtr tx,
                                                const std::vector<unsigned char> & from,
                                                const uint256 & txhash);
     bool updateTransactionWhenConfirmedReceived(XBridgeTransactionPtr tx,
                                                 const std::vector<unsigned char> & from);
 
-    bool updateTransaction(const uint256 & hash);
+    // transaction seen in wallet, confirmed swaps returned
+    bool updateTransaction(const uint256 & hash,
+                           std::list<XBridgeTransactionPtr> & confirmed);
+
+    // refresh ttl of transaction, tx must be locked
+    void updateTimestamp(XBridgeTransactionPtr tx);
 
-    const XBridgeTransactionPtr transaction(const uint256 & hash);
+    // check transaction after seconds, 0 - on next tick
+    void scheduleTransaction(const uint256 & id, const boost::uint32_t seconds);
+    void schedulePendingTransaction(const uint256 & id, const boost::uint32_t seconds);
+
+    // transactions with elapsed deadline, not checked again until rescheduled
+    std::list<XBridgeTransactionPtr> dueTransactions();
+    std::list<XBridgeTransactionPtr> duePendingTransactions();
+
+    // empty pointer if not found
+    XBridgeTransactionPtr transaction(const uint256 & id) const;
     std::list<XBridgeTransactionPtr> pendingTransactions() const;
     std::list<XBridgeTransactionPtr> transactions() const;
-    std::list<XBridgeTransactionPtr> finishedTransactions() const;
 
     std::vector<StringPair> listOfWallets() const;
 
+    // published copy of pending transactions
+    XBridgeOrderBookJournal & orderBook() { return m_orderBook; }
+
 private:
-    std::list<XBridgeTransactionPtr> transactions(bool onlyFinished) const;
+    // matching engine of one currency pair, both directions
+    struct PairBook
+    {
+        boost::mutex   lock;
+        XBridgeMatcher matcher;
+    };
+    typedef boost::shared_ptr<PairBook> PairBookPtr;
+
+    // book of pair, created on first use
+    PairBookPtr pairBook(const std::string & currency1, const std::string & currency2);
+
+    XBridgeTransaction::State increaseStateCounter(XBridgeTransactionPtr tx,
+                                                   const XBridgeTransaction::State state,
+                                                   const std::vector<unsigned char> & from);
+
+    // every state change, schedules timeout of new state
+    void stateChanged(XBridgeTransactionPtr tx);
+
+    void confirm(XBridgeTransactionPtr tx, const uint256 & txhash);
+
+    bool isRecentWalletTransaction(const uint256 & txhash) const;
+    void rememberWalletTransaction(const uint256 & txhash);
+
+    void setPendingTransaction(const uint256 & id,
+                               const XBridgeTransactionPtr & tr,
+                               const XBridgeOrder & rest);
+    void erasePendingTransaction(PairBook & book, const uint256 & id);
 
 private:
     // connected wallets
     typedef std::map<std::string, WalletParam> WalletList;
     WalletList                               m_wallets;
 
-    mutable boost::mutex                     m_pendingTransactionsLock;
-    std::map<uint256, XBridgeTransactionPtr> m_pendingTransactions;
+    bool                                     m_hubRingEnabled;
+    boost::uint32_t                          m_fee;
+
+    // lock order:
+    //   XBridgeTransaction::m_lock
+    //     -> PairBook::lock
+    //       -> m_orderBook lock, shard locks of transaction tables
+    // one PairBook locked at a time, m_pairBooksLock is leaf lock
+    //   XBridgeTransaction::m_lock -> m_walletTransactionsLock -> shard locks of m_unconfirmed
+    // timing wheel locks are leaf locks
+    // shard locks are leaf locks, transaction is locked after lookup only
+
+    // matching of pair serialized by lock of pair book,
+    // different pairs matched in parallel
+    typedef std::pair<std::string, std::string> PairKey;
+
+    boost::mutex                             m_pairBooksLock;
+    std::map<PairKey, PairBookPtr>           m_pairBooks;
+
+    // resting orders of all pairs by client id, changed under pair book lock
+    typedef XBridgeShardedMap<uint256, XBridgeTransactionPtr> TransactionMap;
+
+    TransactionMap                           m_pendingTransactions;
+    XBridgeOrderBookJournal                  m_orderBook;
+
+    TransactionMap                           m_transactions;
 
-    mutable boost::mutex                     m_transactionsLock;
-    std::map<uint256, XBridgeTransactionPtr> m_transactions;
+    // deadlines of pending and joined transactions
+    XBridgeTimingWheel                       m_pendingDeadlines;
+    XBridgeTimingWheel                       m_deadlines;
 
-    mutable boost::mutex                     m_unconfirmedLock;
-    std::map<uint256, uint256>               m_unconfirmed;
+    // pay tx hash -> transaction id, changed under m_walletTransactionsLock
+    XBridgeShardedMap<uint256, uint256>      m_unconfirmed;
 
-    // TODO use deque and limit size
-    std::set<uint256>                        m_walletTransactions;
+    // wallet transactions not matched yet, commit may come after
+    // wallet notification. bounded by count and age
+    mutable boost::mutex                     m_walletTransactionsLock;
+    boost::unordered_set<uint256, XBridgeIdHash> m_walletTransactions;
+    std::deque<std::pair<boost::posix_time::ptime, uint256> > m_walletTransactionsQueue;
 
     mutable boost::mutex                     m_knownTxLock;
     std::set<uint256>                        m_knownTransactions;
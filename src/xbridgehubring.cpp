@@ -0,0 +1,172 @@
+//*****************************************************************************
+//*****************************************************************************
+
+#include "xbridgehubring.h"
+#include "util/util.h"
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+//*****************************************************************************
+//*****************************************************************************
+bool XBridgeHubRing::update(const std::vector<unsigned char> & hub,
+                            const std::vector<std::string> & currencies,
+                            const boost::uint32_t fee,
+                            const boost::uint32_t load,
+                            const boost::uint32_t timestamp)
+{
+    boost::mutex::scoped_lock l(m_lock);
+
+    std::map<HubAddress, Hub>::iterator i = m_hubs.find(hub);
+    if (i != m_hubs.end() && i->second.timestamp >= timestamp)
+    {
+        // replayed or reordered record
+        return false;
+    }
+
+    bool isNew = i == m_hubs.end();
+
+    std::set<std::string> c(currencies.begin(), currencies.end());
+    bool changed = isNew || i->second.currencies != c;
+
+    Hub & h = m_hubs[hub];
+    h.currencies.swap(c);
+    h.fee        = fee;
+    h.load       = load;
+    h.timestamp  = timestamp;
+    h.seen       = boost::posix_time::second_clock::universal_time();
+
+    if (changed)
+    {
+        rebuild();
+    }
+
+    return true;
+}
+
+//*****************************************************************************
+//*****************************************************************************
+bool XBridgeHubRing::owner(const std::string & currency1,
+                           const std::string & currency2,
+                           std::vector<unsigned char> & hub)
+{
+    boost::mutex::scoped_lock l(m_lock);
+
+    removeExpired();
+
+    std::map<std::string, std::set<HubAddress> >::const_iterator c1 = m_index.find(currency1);
+    std::map<std::string, std::set<HubAddress> >::const_iterator c2 = m_index.find(currency2);
+    if (c1 == m_index.end() || c2 == m_index.end())
+    {
+        return false;
+    }
+
+    // same key for both directions
+    std::string key = currency1 < currency2 ? currency1 + '|' + currency2 :
+                                              currency2 + '|' + currency1;
+    uint256 point = util::hash(key.begin(), key.end());
+
+    std::map<uint256, HubAddress>::const_iterator start = m_ring.lower_bound(point);
+    if (start == m_ring.end())
+    {
+        start = m_ring.begin();
+    }
+
+    // clockwise, first hub with both wallets
+    std::map<uint256, HubAddress>::const_iterator i = start;
+    do
+    {
+        if (c1->second.count(i->second) && c2->second.count(i->second))
+        {
+            hub = i->second;
+            return true;
+        }
+
+        if (++i == m_ring.end())
+        {
+            i = m_ring.begin();
+        }
+    }
+    while (i != start);
+
+    return false;
+}
+
+//*****************************************************************************
+//*****************************************************************************
+bool XBridgeHubRing::isOwner(const std::vector<unsigned char> & hub,
+                             const std::string & currency1,
+                             const std::string & currency2)
+{
+    std::vector<unsigned char> ownerHub;
+    if (!owner(currency1, currency2, ownerHub))
+    {
+        return true;
+    }
+    return ownerHub == hub;
+}
+
+//*****************************************************************************
+//*****************************************************************************
+void XBridgeHubRing::hubs(std::set<std::vector<unsigned char> > & hubs)
+{
+    boost::mutex::scoped_lock l(m_lock);
+
+    removeExpired();
+
+    for (std::map<HubAddress, Hub>::const_iterator i = m_hubs.begin(); i != m_hubs.end(); ++i)
+    {
+        hubs.insert(i->first);
+    }
+}
+
+//*****************************************************************************
+// m_lock must be locked
+//*****************************************************************************
+void XBridgeHubRing::removeExpired()
+{
+    boost::posix_time::ptime now = boost::posix_time::second_clock::universal_time();
+
+    bool removed = false;
+    for (std::map<HubAddress, Hub>::iterator i = m_hubs.begin(); i != m_hubs.end(); )
+    {
+        if ((now - i->second.seen).total_seconds() > hubTTL)
+        {
+            m_hubs.erase(i++);
+            removed = true;
+        }
+        else
+        {
+            ++i;
+        }
+    }
+
+    if (removed)
+    {
+        rebuild();
+    }
+}
+
+//*****************************************************************************
+// m_lock must be locked
+//*****************************************************************************
+void XBridgeHubRing::rebuild()
+{
+    m_ring.clear();
+    m_index.clear();
+
+    for (std::map<HubAddress, Hub>::const_iterator i = m_hubs.begin(); i != m_hubs.end(); ++i)
+    {
+        for (std::set<std::string>::const_iterator c = i->second.currencies.begin();
+             c != i->second.currencies.end(); ++c)
+        {
+            m_index[*c].insert(i->first);
+        }
+
+        for (unsigned int n = 0; n < virtualNodes; ++n)
+        {
+            uint256 point = util::hash(i->first.begin(), i->first.end(),
+                                       BEGIN(n), END(n));
+            m_ring[point] = i->first;
+        }
+    }
+}
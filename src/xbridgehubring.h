@@ -0,0 +1,86 @@
+//*****************************************************************************
+//*****************************************************************************
+
+#ifndef XBRIDGEHUBRING_H
+#define XBRIDGEHUBRING_H
+
+#include "util/uint256.h"
+
+#include <string>
+#include <vector>
+#include <set>
+#include <map>
+
+#include <boost/cstdint.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/date_time/posix_time/ptime.hpp>
+
+//*****************************************************************************
+// directory of hubs, consistent hashing of currency pairs to hubs
+//
+// each hub placed on ring with virtualNodes points, pair owned by first
+// hub clockwise from hash of pair which serves both currencies.
+// hubs learned from signed capability records (wallet announcements),
+// dropped after hubTTL without announcement. adding or removing hub
+// moves only pairs of neighbouring points.
+// hubs indexed by currency, pair without hub serving both currencies
+// answered without walking ring
+//*****************************************************************************
+class XBridgeHubRing
+{
+public:
+    enum
+    {
+        virtualNodes = 64,
+        // seconds, three announcement intervals
+        hubTTL       = 60
+    };
+
+public:
+    // capability record of hub, wallet ids are currencies,
+    // false if record older than known one
+    bool update(const std::vector<unsigned char> & hub,
+                const std::vector<std::string> & currencies,
+                const boost::uint32_t fee,
+                const boost::uint32_t load,
+                const boost::uint32_t timestamp);
+
+    // owner of pair, false if no known hub serves both currencies
+    bool owner(const std::string & currency1,
+               const std::string & currency2,
+               std::vector<unsigned char> & hub);
+
+    // true if hub owns pair or no owner known
+    bool isOwner(const std::vector<unsigned char> & hub,
+                 const std::string & currency1,
+                 const std::string & currency2);
+
+    // hubs not expired
+    void hubs(std::set<std::vector<unsigned char> > & hubs);
+
+private:
+    void removeExpired();
+    void rebuild();
+
+private:
+    struct Hub
+    {
+        std::set<std::string>     currencies;
+        boost::uint32_t           fee;
+        boost::uint32_t           load;
+        // timestamp of record, older records ignored
+        boost::uint32_t           timestamp;
+        boost::posix_time::ptime  seen;
+    };
+
+    typedef std::vector<unsigned char> HubAddress;
+
+    boost::mutex                   m_lock;
+    std::map<HubAddress, Hub>      m_hubs;
+    std::map<uint256, HubAddress>  m_ring;
+
+    // currency -> hubs with wallet, rebuilt with ring
+    std::map<std::string, std::set<HubAddress> > m_index;
+};
+
+#endif // XBRIDGEHUBRING_H
@@ -0,0 +1,262 @@
+//*****************************************************************************
+//*****************************************************************************
+
+#include "xbridgematcher.h"
+
+#include <limits>
+#include <algorithm>
+
+//*****************************************************************************
+// 64 x 64 -> 128 bit
+//*****************************************************************************
+static void mul64(const boost::uint64_t a, const boost::uint64_t b,
+                  boost::uint64_t & hi, boost::uint64_t & lo)
+{
+    const boost::uint64_t a0 = a & 0xffffffff;
+    const boost::uint64_t a1 = a >> 32;
+    const boost::uint64_t b0 = b & 0xffffffff;
+    const boost::uint64_t b1 = b >> 32;
+
+    const boost::uint64_t p00 = a0 * b0;
+    const boost::uint64_t p01 = a0 * b1;
+    const boost::uint64_t p10 = a1 * b0;
+    const boost::uint64_t p11 = a1 * b1;
+
+    const boost::uint64_t mid = (p00 >> 32) + (p01 & 0xffffffff) + (p10 & 0xffffffff);
+
+    lo = (mid << 32) | (p00 & 0xffffffff);
+    hi = p11 + (p01 >> 32) + (p10 >> 32) + (mid >> 32);
+}
+
+//*****************************************************************************
+// amount * mul / div, saturated to uint64
+//*****************************************************************************
+static boost::uint64_t mulDiv(const boost::uint64_t amount,
+                              const boost::uint64_t mul,
+                              const boost::uint64_t div,
+                              const bool roundUp)
+{
+    if (div == 0)
+    {
+        return std::numeric_limits<boost::uint64_t>::max();
+    }
+
+    boost::uint64_t hi = 0;
+    boost::uint64_t lo = 0;
+    mul64(amount, mul, hi, lo);
+
+    if (hi >= div)
+    {
+        // quotient does not fit
+        return std::numeric_limits<boost::uint64_t>::max();
+    }
+
+    // long division of 128 bit by 64 bit
+    boost::uint64_t q = 0;
+    boost::uint64_t r = hi;
+    for (int i = 63; i >= 0; --i)
+    {
+        const bool carry = (r >> 63) != 0;
+        r = (r << 1) | ((lo >> i) & 1);
+        q <<= 1;
+        if (carry || r >= div)
+        {
+            r -= div;
+            q |= 1;
+        }
+    }
+
+    if (roundUp && r != 0 && q != std::numeric_limits<boost::uint64_t>::max())
+    {
+        ++q;
+    }
+    return q;
+}
+
+//*****************************************************************************
+//*****************************************************************************
+bool XBridgePrice::operator < (const XBridgePrice & other) const
+{
+    boost::uint64_t lhi, llo, rhi, rlo;
+    mul64(num, other.den, lhi, llo);
+    mul64(other.num, den, rhi, rlo);
+    return lhi < rhi || (lhi == rhi && llo < rlo);
+}
+
+//*****************************************************************************
+//*****************************************************************************
+boost::uint64_t XBridgePrice::apply(const boost::uint64_t amount) const
+{
+    return mulDiv(amount, num, den, true);
+}
+
+//*****************************************************************************
+//*****************************************************************************
+// static
+XBridgeOrder XBridgeMatcher::makeOrder(const SideKey & side, const Entry & entry)
+{
+    return XBridgeOrder(entry.id,
+                        side.first, entry.amount,
+                        side.second, entry.price.apply(entry.amount));
+}
+
+//*****************************************************************************
+//*****************************************************************************
+XBridgeOrder XBridgeMatcher::add(const XBridgeOrder & order, std::vector<XBridgeFill> & fills, bool & dust)
+{
+    dust = false;
+
+    // rest of incoming order
+    boost::uint64_t restSource = order.fromAmount;
+    boost::uint64_t restDest   = order.toAmount;
+
+    // incoming order pays not more than limit, in units of opposite side
+    const XBridgePrice limit(order.fromAmount, order.toAmount);
+
+    std::map<SideKey, Side>::iterator opposite = m_sides.find(SideKey(order.toCurrency, order.fromCurrency));
+    if (opposite != m_sides.end())
+    {
+        Side & side = opposite->second;
+
+        while (restSource && restDest && !side.empty())
+        {
+            Side::iterator best = side.begin();
+            if (limit < best->first)
+            {
+                // best level does not cross
+                break;
+            }
+
+            Level & level = best->second;
+            while (restSource && restDest && !level.empty())
+            {
+                Entry & resting = level.front();
+
+                // resting gives source currency, incoming gives dest currency
+                boost::uint64_t source = std::min(resting.amount, restDest);
+                boost::uint64_t dest   = resting.price.apply(source);
+                if (dest > restSource)
+                {
+                    source = mulDiv(restSource, resting.price.den, resting.price.num, false);
+                    dest   = resting.price.apply(source);
+                }
+
+                if (source == 0 || dest == 0)
+                {
+                    // resting in book would cross best level
+                    dust       = true;
+                    restSource = 0;
+                    break;
+                }
+
+                resting.amount -= source;
+                restSource     -= dest;
+                restDest       -= std::min(restDest, source);
+
+                XBridgeFill f;
+                f.restingId    = resting.id;
+                f.incomingId   = order.id;
+                f.sourceAmount = source;
+                f.destAmount   = dest;
+
+                if (resting.amount && resting.price.apply(resting.amount))
+                {
+                    f.restingRest = makeOrder(opposite->first, resting);
+                }
+                else
+                {
+                    f.restingRest = XBridgeOrder(resting.id, opposite->first.first, 0, opposite->first.second, 0);
+
+                    m_index.erase(resting.id);
+                    level.pop_front();
+                }
+
+                // rest of incoming order keeps own price for amount
+                // still wanted, price improvement stays with trader
+                restSource = std::min(restSource, mulDiv(restDest, order.fromAmount, order.toAmount, true));
+                if (restDest == 0 || restSource == 0)
+                {
+                    restSource = 0;
+                    restDest   = 0;
+                }
+                f.incomingRest = XBridgeOrder(order.id,
+                                              order.fromCurrency, restSource,
+                                              order.toCurrency, restDest);
+
+                fills.push_back(f);
+            }
+
+            if (level.empty())
+            {
+                side.erase(best);
+            }
+        }
+
+        if (side.empty())
+        {
+            m_sides.erase(opposite);
+        }
+    }
+
+    if (!restSource || !restDest)
+    {
+        return XBridgeOrder(order.id, order.fromCurrency, 0, order.toCurrency, 0);
+    }
+
+    // rest of order into book, time priority inside price level
+    Entry e;
+    e.id     = order.id;
+    e.price  = XBridgePrice(order.toAmount, order.fromAmount);
+    e.amount = restSource;
+
+    SideKey key(order.fromCurrency, order.toCurrency);
+    Side & side = m_sides[key];
+
+    Location & loc = m_index[order.id];
+    loc.side  = key;
+    loc.level = side.insert(std::make_pair(e.price, Level())).first;
+    loc.entry = loc.level->second.insert(loc.level->second.end(), e);
+
+    return makeOrder(key, e);
+}
+
+//*****************************************************************************
+//*****************************************************************************
+bool XBridgeMatcher::remove(const uint256 & id)
+{
+    std::map<uint256, Location>::iterator i = m_index.find(id);
+    if (i == m_index.end())
+    {
+        return false;
+    }
+
+    Location & loc = i->second;
+    loc.level->second.erase(loc.entry);
+
+    if (loc.level->second.empty())
+    {
+        std::map<SideKey, Side>::iterator side = m_sides.find(loc.side);
+        side->second.erase(loc.level);
+        if (side->second.empty())
+        {
+            m_sides.erase(side);
+        }
+    }
+
+    m_index.erase(i);
+    return true;
+}
+
+//*****************************************************************************
+//*****************************************************************************
+bool XBridgeMatcher::order(const uint256 & id, XBridgeOrder & order) const
+{
+    std::map<uint256, Location>::const_iterator i = m_index.find(id);
+    if (i == m_index.end())
+    {
+        return false;
+    }
+
+    order = makeOrder(i->second.side, *i->second.entry);
+    return true;
+}
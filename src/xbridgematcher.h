@@ -0,0 +1,111 @@
+//*****************************************************************************
+//*****************************************************************************
+
+#ifndef XBRIDGEMATCHER_H
+#define XBRIDGEMATCHER_H
+
+#include "util/uint256.h"
+#include "xbridgeorderbook.h"
+
+#include <string>
+#include <vector>
+#include <list>
+#include <map>
+
+#include <boost/cstdint.hpp>
+
+//*****************************************************************************
+// limit price of order, dest amount per unit of source amount,
+// compared exactly (cross multiplication in 128 bit)
+//*****************************************************************************
+struct XBridgePrice
+{
+    boost::uint64_t num;
+    boost::uint64_t den;
+
+    XBridgePrice() : num(0), den(1) {}
+    XBridgePrice(const boost::uint64_t n, const boost::uint64_t d) : num(n), den(d) {}
+
+    bool operator < (const XBridgePrice & other) const;
+
+    // amount * num / den, rounded up
+    boost::uint64_t apply(const boost::uint64_t amount) const;
+};
+
+//*****************************************************************************
+// part of resting order matched with incoming order,
+// amounts from resting order side
+//*****************************************************************************
+struct XBridgeFill
+{
+    uint256         restingId;
+    uint256         incomingId;
+
+    // id of joined transaction, set by exchange
+    uint256         transactionId;
+
+    // resting order gives source, incoming order gives dest
+    boost::uint64_t sourceAmount;
+    boost::uint64_t destAmount;
+
+    // rest of orders after this fill, empty amounts if filled completely
+    XBridgeOrder    restingRest;
+    XBridgeOrder    incomingRest;
+};
+
+//*****************************************************************************
+// price level order book, one side per currency pair direction
+//
+// levels of side sorted by price, orders of level in time priority.
+// incoming order matched with best levels of opposite side
+// at price of resting order, rest of incoming order placed into book.
+// best price lookup O(log n), cancel O(log n)
+//
+// not thread safe, locked by owner
+//*****************************************************************************
+class XBridgeMatcher
+{
+public:
+    // match incoming order, partial fills allowed,
+    // return rest of order placed into book (empty amounts if filled).
+    // dust - rest too small for one unit at best crossing price,
+    // dropped and not placed into book, owner must be told
+    XBridgeOrder add(const XBridgeOrder & order, std::vector<XBridgeFill> & fills, bool & dust);
+
+    bool remove(const uint256 & id);
+
+    // rest of resting order
+    bool order(const uint256 & id, XBridgeOrder & order) const;
+
+    std::size_t size() const { return m_index.size(); }
+
+private:
+    struct Entry
+    {
+        uint256         id;
+        XBridgePrice    price;
+        // rest of source amount
+        boost::uint64_t amount;
+    };
+
+    typedef std::list<Entry>                 Level;
+    typedef std::map<XBridgePrice, Level>    Side;
+
+    // from currency, to currency
+    typedef std::pair<std::string, std::string> SideKey;
+
+    struct Location
+    {
+        SideKey                 side;
+        Side::iterator          level;
+        Level::iterator         entry;
+    };
+
+    static XBridgeOrder makeOrder(const SideKey & side, const Entry & entry);
+
+private:
+    std::map<SideKey, Side>      m_sides;
+    std::map<uint256, Location>  m_index;
+};
+
+#endif // XBRIDGEMATCHER_H
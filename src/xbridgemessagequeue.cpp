@@ -0,0 +1,235 @@
+//*****************************************************************************
+//*****************************************************************************
+
+#include "xbridgemessagequeue.h"
+#include "xbridgepacket.h"
+
+#include <sstream>
+#include <cstring>
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+//*****************************************************************************
+//*****************************************************************************
+XBridgeMessageQueue::XBridgeMessageQueue()
+    : m_current(laneOrderFlow)
+    , m_quantumAdded(false)
+{
+    for (int i = 0; i < laneCount; ++i)
+    {
+        m_deficit[i] = 0;
+    }
+}
+
+//*****************************************************************************
+//*****************************************************************************
+// static
+XBridgeMessageQueue::Lane XBridgeMessageQueue::lane(const UcharVector & message)
+{
+    if (message.size() < XBridgePacket::headerSize)
+    {
+        return laneBulk;
+    }
+
+    // command is the second field of packet header
+    boost::uint32_t command = 0;
+    memcpy(&command, &message[sizeof(boost::uint32_t)], sizeof(command));
+
+    switch (command)
+    {
+        case xbcTransactionHold:
+        case xbcTransactionHoldApply:
+        case xbcTransactionInit:
+        case xbcTransactionInitialized:
+        case xbcTransactionCreate:
+        case xbcTransactionCreated:
+        case xbcTransactionSign:
+        case xbcTransactionSigned:
+        case xbcTransactionCommit:
+        case xbcTransactionCommited:
+        case xbcTransactionConfirm:
+        case xbcTransactionConfirmed:
+        case xbcTransactionCancel:
+        case xbcTransactionRollback:
+        case xbcTransactionFinished:
+        case xbcTransactionDropped:
+        case xbcReceivedTransaction:
+            return laneControl;
+
+        case xbcTransaction:
+        case xbcOrderBookDelta:
+        case xbcOrderBookDigest:
+        case xbcOrderBookRequest:
+        case xbcExchangeWallets:
+            return laneOrderFlow;
+
+        default:
+            return laneBulk;
+    }
+}
+
+//*****************************************************************************
+//*****************************************************************************
+// static
+const char * XBridgeMessageQueue::laneName(const Lane lane)
+{
+    static const char * names[] = { "control", "orderflow", "bulk" };
+    return lane < laneCount ? names[lane] : "unknown";
+}
+
+//*****************************************************************************
+//*****************************************************************************
+void XBridgeMessageQueue::push(const UcharVector & id,
+                               const UcharVector & message,
+                               const bool resent)
+{
+    Message m;
+    m.id      = id;
+    m.message = message;
+    m.resent  = resent;
+    m.lane    = lane(message);
+    m.queued  = boost::posix_time::microsec_clock::universal_time();
+
+    boost::mutex::scoped_lock l(m_lock);
+
+    std::deque<Message> & q = m_lanes[m.lane];
+    q.push_back(m);
+
+    LaneStat & s = m_stat[m.lane];
+    s.depth = q.size();
+    if (s.depth > s.maxDepth)
+    {
+        s.maxDepth = s.depth;
+    }
+}
+
+//*****************************************************************************
+// control lane first, then deficit round robin
+// between order flow and bulk lanes
+//*****************************************************************************
+bool XBridgeMessageQueue::pop(Message & msg)
+{
+    boost::mutex::scoped_lock l(m_lock);
+
+    Lane from = laneCount;
+
+    if (!m_lanes[laneControl].empty())
+    {
+        from = laneControl;
+    }
+    else
+    {
+        while (!m_lanes[laneOrderFlow].empty() || !m_lanes[laneBulk].empty())
+        {
+            std::deque<Message> & q = m_lanes[m_current];
+            if (q.empty())
+            {
+                // idle lane does not accumulate credit
+                m_deficit[m_current] = 0;
+                nextLane();
+                continue;
+            }
+
+            if (!m_quantumAdded)
+            {
+                m_deficit[m_current] += (m_current == laneOrderFlow) ?
+                                            orderFlowQuantum : bulkQuantum;
+                m_quantumAdded = true;
+            }
+
+            std::size_t size = q.front().message.size();
+            if (m_deficit[m_current] >= size)
+            {
+                m_deficit[m_current] -= size;
+                from = m_current;
+                break;
+            }
+
+            nextLane();
+        }
+    }
+
+    if (from == laneCount)
+    {
+        return false;
+    }
+
+    std::deque<Message> & q = m_lanes[from];
+    msg = q.front();
+    q.pop_front();
+
+    boost::uint64_t latency = (boost::posix_time::microsec_clock::universal_time() -
+                               msg.queued).total_milliseconds();
+
+    LaneStat & s = m_stat[from];
+    s.depth = q.size();
+    ++s.sent;
+    s.totalLatency += latency;
+    if (latency > s.maxLatency)
+    {
+        s.maxLatency = latency;
+    }
+
+    return true;
+}
+
+//*****************************************************************************
+//*****************************************************************************
+void XBridgeMessageQueue::nextLane()
+{
+    m_current      = (m_current == laneOrderFlow) ? laneBulk : laneOrderFlow;
+    m_quantumAdded = false;
+}
+
+//*****************************************************************************
+//*****************************************************************************
+bool XBridgeMessageQueue::empty() const
+{
+    boost::mutex::scoped_lock l(m_lock);
+    for (int i = 0; i < laneCount; ++i)
+    {
+        if (!m_lanes[i].empty())
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+//*****************************************************************************
+//*****************************************************************************
+std::size_t XBridgeMessageQueue::size() const
+{
+    boost::mutex::scoped_lock l(m_lock);
+    std::size_t result = 0;
+    for (int i = 0; i < laneCount; ++i)
+    {
+        result += m_lanes[i].size();
+    }
+    return result;
+}
+
+//*****************************************************************************
+//*****************************************************************************
+XBridgeMessageQueue::LaneStat XBridgeMessageQueue::stat(const Lane lane) const
+{
+    boost::mutex::scoped_lock l(m_lock);
+    return lane < laneCount ? m_stat[lane] : LaneStat();
+}
+
+//*****************************************************************************
+//*****************************************************************************
+std::string XBridgeMessageQueue::dumpStat() const
+{
+    std::ostringstream o;
+    for (int i = 0; i < laneCount; ++i)
+    {
+        LaneStat s = stat(static_cast<Lane>(i));
+        o << laneName(static_cast<Lane>(i))
+          << " depth " << s.depth << " (max " << s.maxDepth << ")"
+          << " sent " << s.sent
+          << " latency avg " << s.avgLatency() << "ms max " << s.maxLatency << "ms"
+          << std::endl;
+    }
+    return o.str();
+}
@@ -0,0 +1,104 @@
+//*****************************************************************************
+//*****************************************************************************
+
+#ifndef XBRIDGEMESSAGEQUEUE_H
+#define XBRIDGEMESSAGEQUEUE_H
+
+#include <vector>
+#include <deque>
+#include <string>
+
+#include <boost/cstdint.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/date_time/posix_time/ptime.hpp>
+
+//*****************************************************************************
+// outbound messages queue, classified by lanes
+//
+// laneControl   - swap steps (hold, init, create, sign, commit, confirm,
+//                 cancel, rollback, finished...), strict priority
+// laneOrderFlow - orders and order book announcements
+// laneBulk      - address book, xchat and other relayed messages
+//
+// order flow and bulk lanes share what is left after control lane
+// by deficit round robin, order flow lane have a bigger quantum
+//*****************************************************************************
+class XBridgeMessageQueue
+{
+public:
+    enum Lane
+    {
+        laneControl = 0,
+        laneOrderFlow,
+        laneBulk,
+        laneCount
+    };
+
+    enum
+    {
+        // deficit round robin quantums, bytes per round
+        orderFlowQuantum = 4096,
+        bulkQuantum      = 1024
+    };
+
+    typedef std::vector<unsigned char> UcharVector;
+
+    struct Message
+    {
+        // destination, empty for broadcast
+        UcharVector              id;
+        UcharVector              message;
+        // true if message already returned to queue after search
+        bool                     resent;
+
+        Lane                     lane;
+        boost::posix_time::ptime queued;
+    };
+
+    struct LaneStat
+    {
+        std::size_t     depth;
+        std::size_t     maxDepth;
+        boost::uint64_t sent;
+        boost::uint64_t totalLatency;   // milliseconds
+        boost::uint64_t maxLatency;     // milliseconds
+
+        LaneStat()
+            : depth(0), maxDepth(0)
+            , sent(0), totalLatency(0), maxLatency(0)
+        {}
+
+        boost::uint64_t avgLatency() const { return sent ? totalLatency / sent : 0; }
+    };
+
+public:
+    XBridgeMessageQueue();
+
+    static Lane lane(const UcharVector & message);
+    static const char * laneName(const Lane lane);
+
+    void push(const UcharVector & id, const UcharVector & message, const bool resent = false);
+    bool pop(Message & msg);
+
+    bool empty() const;
+    std::size_t size() const;
+
+    LaneStat stat(const Lane lane) const;
+    std::string dumpStat() const;
+
+private:
+    void nextLane();
+
+private:
+    mutable boost::mutex m_lock;
+
+    std::deque<Message>  m_lanes[laneCount];
+    LaneStat             m_stat[laneCount];
+
+    // deficit round robin state, used only for order flow and bulk lanes
+    Lane                 m_current;
+    bool                 m_quantumAdded;
+    std::size_t          m_deficit[laneCount];
+};
+
+#endif // XBRIDGEMESSAGEQUEUE_H
@@ -0,0 +1,436 @@
+//*****************************************************************************
+//*****************************************************************************
+
+#include "xbridgeorderbook.h"
+#include "xbridgepacket.h"
+#include "util/util.h"
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+//*****************************************************************************
+//*****************************************************************************
+XBridgeOrder::XBridgeOrder()
+    : fromAmount(0)
+    , toAmount(0)
+{
+}
+
+//*****************************************************************************
+// currency truncated to packet field
+//*****************************************************************************
+XBridgeOrder::XBridgeOrder(const uint256 & _id,
+                           const std::string & _fromCurrency,
+                           const boost::uint64_t _fromAmount,
+                           const std::string & _toCurrency,
+                           const boost::uint64_t _toAmount)
+    : id(_id)
+    , fromCurrency(_fromCurrency.substr(0, XBridgeFieldSize::currency))
+    , fromAmount(_fromAmount)
+    , toCurrency(_toCurrency.substr(0, XBridgeFieldSize::currency))
+    , toAmount(_toAmount)
+{
+}
+
+//*****************************************************************************
+//*****************************************************************************
+uint256 XBridgeOrder::hash() const
+{
+    typedef XBridgeLayoutPendingTransaction L;
+
+    unsigned char record[L::size];
+    XBridgeRecordWriter<L>(record)
+            .set<L::Id>(id)
+            .setString<L::SourceCurrency>(fromCurrency)
+            .set<L::SourceAmount>(fromAmount)
+            .setString<L::DestCurrency>(toCurrency)
+            .set<L::DestAmount>(toAmount);
+
+    return util::hash(record, record + L::size);
+}
+
+//*****************************************************************************
+//*****************************************************************************
+bool XBridgeOrder::operator == (const XBridgeOrder & other) const
+{
+    return id           == other.id &&
+           fromCurrency == other.fromCurrency &&
+           fromAmount   == other.fromAmount &&
+           toCurrency   == other.toCurrency &&
+           toAmount     == other.toAmount;
+}
+
+//*****************************************************************************
+//*****************************************************************************
+XBridgeOrderBookJournal::XBridgeOrderBookJournal()
+    : m_published(0)
+{
+}
+
+//*****************************************************************************
+//*****************************************************************************
+void XBridgeOrderBookJournal::add(const uint256 & key, const XBridgeOrder & order)
+{
+    boost::mutex::scoped_lock l(m_lock);
+
+    std::map<uint256, XBridgeOrder>::iterator i = m_orders.find(key);
+    if (i == m_orders.end())
+    {
+        m_orders[key] = order;
+        m_digest.digest ^= order.hash();
+        ++m_digest.count;
+        push(XBridgeOrderDelta::opAdd, order);
+        return;
+    }
+
+    if (i->second == order)
+    {
+        // resent by client, nothing changed
+        return;
+    }
+
+    m_digest.digest ^= i->second.hash();
+    m_digest.digest ^= order.hash();
+
+    if (i->second.id == order.id)
+    {
+        push(XBridgeOrderDelta::opUpdate, order);
+    }
+    else
+    {
+        // clients store orders by id
+        push(XBridgeOrderDelta::opRemove, i->second);
+        push(XBridgeOrderDelta::opAdd, order);
+    }
+
+    i->second = order;
+}
+
+//*****************************************************************************
+//*****************************************************************************
+void XBridgeOrderBookJournal::remove(const uint256 & key)
+{
+    boost::mutex::scoped_lock l(m_lock);
+
+    std::map<uint256, XBridgeOrder>::iterator i = m_orders.find(key);
+    if (i == m_orders.end())
+    {
+        return;
+    }
+
+    m_digest.digest ^= i->second.hash();
+    --m_digest.count;
+    push(XBridgeOrderDelta::opRemove, i->second);
+
+    m_orders.erase(i);
+}
+
+//*****************************************************************************
+//*****************************************************************************
+XBridgeOrderBookDigest XBridgeOrderBookJournal::digest() const
+{
+    boost::mutex::scoped_lock l(m_lock);
+    return m_digest;
+}
+
+//*****************************************************************************
+//*****************************************************************************
+void XBridgeOrderBookJournal::takeUnpublished(std::vector<XBridgeOrderDelta> & deltas)
+{
+    boost::mutex::scoped_lock l(m_lock);
+
+    // changes dropped from journal before publishing
+    // are recovered by clients through digest
+    for (std::deque<XBridgeOrderDelta>::const_iterator i = m_journal.begin(); i != m_journal.end(); ++i)
+    {
+        if (i->seq > m_published)
+        {
+            deltas.push_back(*i);
+        }
+    }
+
+    m_published = m_digest.seq;
+}
+
+//*****************************************************************************
+//*****************************************************************************
+bool XBridgeOrderBookJournal::changesSince(const boost::uint32_t seq,
+                                           std::vector<XBridgeOrderDelta> & deltas) const
+{
+    boost::mutex::scoped_lock l(m_lock);
+
+    if (seq >= m_digest.seq)
+    {
+        // up to date
+        return true;
+    }
+
+    if (m_journal.empty() || m_journal.front().seq > seq + 1)
+    {
+        return false;
+    }
+
+    if (m_digest.seq - seq > m_orders.size())
+    {
+        // snapshot is cheaper
+        return false;
+    }
+
+    for (std::deque<XBridgeOrderDelta>::const_iterator i = m_journal.begin(); i != m_journal.end(); ++i)
+    {
+        if (i->seq > seq)
+        {
+            deltas.push_back(*i);
+        }
+    }
+
+    return true;
+}
+
+//*****************************************************************************
+//*****************************************************************************
+XBridgeOrderBookDigest XBridgeOrderBookJournal::snapshot(std::vector<XBridgeOrder> & orders) const
+{
+    boost::mutex::scoped_lock l(m_lock);
+
+    orders.reserve(m_orders.size());
+    for (std::map<uint256, XBridgeOrder>::const_iterator i = m_orders.begin(); i != m_orders.end(); ++i)
+    {
+        orders.push_back(i->second);
+    }
+
+    return m_digest;
+}
+
+//*****************************************************************************
+// m_lock must be locked
+//*****************************************************************************
+void XBridgeOrderBookJournal::push(const XBridgeOrderDelta::Op op, const XBridgeOrder & order)
+{
+    XBridgeOrderDelta d;
+    d.seq   = ++m_digest.seq;
+    d.op    = op;
+    d.order = order;
+
+    m_journal.push_back(d);
+    while (m_journal.size() > maxJournalSize)
+    {
+        m_journal.pop_front();
+    }
+}
+
+//*****************************************************************************
+//*****************************************************************************
+bool XBridgeOrderBooks::applyDeltas(const std::vector<unsigned char> & hub,
+                                    const std::vector<XBridgeOrderDelta> & deltas,
+                                    Changes & changes)
+{
+    boost::mutex::scoped_lock l(m_lock);
+
+    Book & book = m_books[hub];
+
+    std::vector<XBridgeOrderDelta>::const_iterator i = deltas.begin();
+
+    // skip already applied
+    while (i != deltas.end() && i->seq <= book.digest.seq)
+    {
+        ++i;
+    }
+
+    if (i != deltas.end() && i->seq != book.digest.seq + 1)
+    {
+        // gap
+        return false;
+    }
+
+    for (; i != deltas.end(); ++i)
+    {
+        apply(book, *i, changes);
+        book.digest.seq = i->seq;
+    }
+
+    return true;
+}
+
+//*****************************************************************************
+//*****************************************************************************
+void XBridgeOrderBooks::applySnapshot(const std::vector<unsigned char> & hub,
+                                      const XBridgeOrderBookDigest & digest,
+                                      const std::vector<XBridgeOrder> & orders,
+                                      Changes & changes)
+{
+    boost::mutex::scoped_lock l(m_lock);
+
+    Book & book = m_books[hub];
+
+    if (digest.seq < book.digest.seq)
+    {
+        // copy already newer
+        return;
+    }
+
+    if (digest.seq != book.snapshotDigest.seq || digest.count != book.snapshotDigest.count)
+    {
+        // new snapshot
+        book.snapshot.clear();
+        book.snapshotDigest = digest;
+    }
+
+    for (std::vector<XBridgeOrder>::const_iterator i = orders.begin(); i != orders.end(); ++i)
+    {
+        book.snapshot[i->id] = *i;
+    }
+
+    if (book.snapshot.size() < digest.count)
+    {
+        // wait for rest
+        return;
+    }
+
+    for (std::map<uint256, XBridgeOrder>::const_iterator i = book.orders.begin(); i != book.orders.end(); ++i)
+    {
+        if (!book.snapshot.count(i->first))
+        {
+            changes.removed.push_back(i->first);
+        }
+    }
+
+    book.digest = XBridgeOrderBookDigest();
+    book.digest.seq = digest.seq;
+
+    for (std::map<uint256, XBridgeOrder>::const_iterator i = book.snapshot.begin(); i != book.snapshot.end(); ++i)
+    {
+        std::map<uint256, XBridgeOrder>::const_iterator old = book.orders.find(i->first);
+        if (old == book.orders.end() || old->second != i->second)
+        {
+            changes.updated.push_back(i->second);
+        }
+
+        book.digest.digest ^= i->second.hash();
+        ++book.digest.count;
+    }
+
+    book.orders.swap(book.snapshot);
+    book.snapshot.clear();
+    book.snapshotDigest = XBridgeOrderBookDigest();
+}
+
+//*****************************************************************************
+//*****************************************************************************
+bool XBridgeOrderBooks::checkDigest(const std::vector<unsigned char> & hub,
+                                    const XBridgeOrderBookDigest & digest)
+{
+    boost::mutex::scoped_lock l(m_lock);
+
+    Book & book = m_books[hub];
+
+    if (digest.seq < book.digest.seq)
+    {
+        // hub restarted, full book needed
+        book.digest.seq = 0;
+        return false;
+    }
+
+    if (digest.seq > book.digest.seq)
+    {
+        // changes lost
+        return false;
+    }
+
+    if (!book.digest.sameBook(digest))
+    {
+        // diverged, full book needed
+        book.digest.seq = 0;
+        return false;
+    }
+
+    return true;
+}
+
+//*****************************************************************************
+//*****************************************************************************
+bool XBridgeOrderBooks::needRequest(const std::vector<unsigned char> & hub, boost::uint32_t & seq)
+{
+    boost::mutex::scoped_lock l(m_lock);
+
+    Book & book = m_books[hub];
+
+    boost::posix_time::ptime now = boost::posix_time::second_clock::universal_time();
+    if (!book.requested.is_not_a_date_time() &&
+        (now - book.requested).total_seconds() < requestInterval)
+    {
+        return false;
+    }
+
+    book.requested = now;
+    seq = book.digest.seq;
+    return true;
+}
+
+//*****************************************************************************
+//*****************************************************************************
+void XBridgeOrderBooks::expire(const std::set<std::vector<unsigned char> > & hubs, Changes & changes)
+{
+    boost::mutex::scoped_lock l(m_lock);
+
+    for (std::map<std::vector<unsigned char>, Book>::iterator i = m_books.begin(); i != m_books.end(); )
+    {
+        if (hubs.count(i->first))
+        {
+            ++i;
+            continue;
+        }
+
+        const std::map<uint256, XBridgeOrder> & orders = i->second.orders;
+        for (std::map<uint256, XBridgeOrder>::const_iterator o = orders.begin(); o != orders.end(); ++o)
+        {
+            changes.removed.push_back(o->first);
+        }
+
+        m_books.erase(i++);
+    }
+}
+
+//*****************************************************************************
+// m_lock must be locked
+//*****************************************************************************
+void XBridgeOrderBooks::apply(Book & book, const XBridgeOrderDelta & delta, Changes & changes)
+{
+    std::map<uint256, XBridgeOrder>::iterator i = book.orders.find(delta.order.id);
+
+    switch (delta.op)
+    {
+        case XBridgeOrderDelta::opAdd:
+        case XBridgeOrderDelta::opUpdate:
+        {
+            if (i != book.orders.end())
+            {
+                book.digest.digest ^= i->second.hash();
+                i->second = delta.order;
+            }
+            else
+            {
+                book.orders[delta.order.id] = delta.order;
+                ++book.digest.count;
+            }
+            book.digest.digest ^= delta.order.hash();
+            changes.updated.push_back(delta.order);
+            break;
+        }
+
+        case XBridgeOrderDelta::opRemove:
+        {
+            if (i != book.orders.end())
+            {
+                book.digest.digest ^= i->second.hash();
+                --book.digest.count;
+                book.orders.erase(i);
+                changes.removed.push_back(delta.order.id);
+            }
+            break;
+        }
+
+        default:
+            // unknown operation, sequence number consumed
+            break;
+    }
+}
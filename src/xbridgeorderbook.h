@@ -0,0 +1,185 @@
+//*****************************************************************************
+//*****************************************************************************
+
+#ifndef XBRIDGEORDERBOOK_H
+#define XBRIDGEORDERBOOK_H
+
+#include "util/uint256.h"
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <set>
+
+#include <boost/cstdint.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/date_time/posix_time/ptime.hpp>
+
+//*****************************************************************************
+// pending order as published by hub
+//*****************************************************************************
+struct XBridgeOrder
+{
+    uint256         id;
+    std::string     fromCurrency;
+    boost::uint64_t fromAmount;
+    std::string     toCurrency;
+    boost::uint64_t toAmount;
+
+    XBridgeOrder();
+    XBridgeOrder(const uint256 & id,
+                 const std::string & fromCurrency,
+                 const boost::uint64_t fromAmount,
+                 const std::string & toCurrency,
+                 const boost::uint64_t toAmount);
+
+    // hash of order packet record, used for order book digest
+    uint256 hash() const;
+
+    bool operator == (const XBridgeOrder & other) const;
+    bool operator != (const XBridgeOrder & other) const { return !(*this == other); }
+};
+
+//*****************************************************************************
+// change of order book, sequence numbers are consecutive per hub
+//*****************************************************************************
+struct XBridgeOrderDelta
+{
+    enum Op
+    {
+        opAdd    = 1,
+        opRemove = 2,
+        opUpdate = 3
+    };
+
+    boost::uint32_t seq;
+    Op              op;
+    XBridgeOrder    order;
+};
+
+//*****************************************************************************
+// summary of order book, digest is xor of order hashes,
+// updated in O(1) on each add and remove
+//*****************************************************************************
+struct XBridgeOrderBookDigest
+{
+    boost::uint32_t seq;
+    boost::uint32_t count;
+    uint256         digest;
+
+    XBridgeOrderBookDigest() : seq(0), count(0) {}
+
+    bool sameBook(const XBridgeOrderBookDigest & other) const
+    {
+        return count == other.count && digest == other.digest;
+    }
+};
+
+//*****************************************************************************
+// hub side, own pending orders and journal of last changes
+//*****************************************************************************
+class XBridgeOrderBookJournal
+{
+public:
+    enum
+    {
+        // changes kept for incremental sync
+        maxJournalSize = 1024
+    };
+
+    XBridgeOrderBookJournal();
+
+    // add new order or replace order with same key
+    void add(const uint256 & key, const XBridgeOrder & order);
+    void remove(const uint256 & key);
+
+    XBridgeOrderBookDigest digest() const;
+
+    // changes not published yet, marks them published
+    void takeUnpublished(std::vector<XBridgeOrderDelta> & deltas);
+
+    // changes after seq, false if journal does not cover them
+    // or full book is smaller than changes
+    bool changesSince(const boost::uint32_t seq, std::vector<XBridgeOrderDelta> & deltas) const;
+
+    XBridgeOrderBookDigest snapshot(std::vector<XBridgeOrder> & orders) const;
+
+private:
+    void push(const XBridgeOrderDelta::Op op, const XBridgeOrder & order);
+
+private:
+    mutable boost::mutex            m_lock;
+
+    // orders by key of pending transaction
+    std::map<uint256, XBridgeOrder> m_orders;
+    XBridgeOrderBookDigest          m_digest;
+
+    // last published sequence number
+    boost::uint32_t                 m_published;
+    std::deque<XBridgeOrderDelta>   m_journal;
+};
+
+//*****************************************************************************
+// client side, copies of order books of hubs
+//*****************************************************************************
+class XBridgeOrderBooks
+{
+public:
+    enum
+    {
+        // min interval between sync requests to one hub, seconds
+        requestInterval = 10
+    };
+
+    // changes for ui
+    struct Changes
+    {
+        std::vector<XBridgeOrder> updated;
+        std::vector<uint256>      removed;
+    };
+
+    // apply changes from hub in order, stale changes skipped,
+    // false if sequence gap found, nothing applied
+    bool applyDeltas(const std::vector<unsigned char> & hub,
+                     const std::vector<XBridgeOrderDelta> & deltas,
+                     Changes & changes);
+
+    // collect part of snapshot, book replaced when all orders received
+    void applySnapshot(const std::vector<unsigned char> & hub,
+                       const XBridgeOrderBookDigest & digest,
+                       const std::vector<XBridgeOrder> & orders,
+                       Changes & changes);
+
+    // false if copy is behind or differs from hub book
+    bool checkDigest(const std::vector<unsigned char> & hub,
+                     const XBridgeOrderBookDigest & digest);
+
+    // sequence number for sync request,
+    // false if request was sent recently
+    bool needRequest(const std::vector<unsigned char> & hub, boost::uint32_t & seq);
+
+    // drop books of hubs not in hubs, orders reported removed
+    void expire(const std::set<std::vector<unsigned char> > & hubs, Changes & changes);
+
+private:
+    struct Book
+    {
+        std::map<uint256, XBridgeOrder> orders;
+        XBridgeOrderBookDigest          digest;
+
+        // snapshot in progress
+        XBridgeOrderBookDigest          snapshotDigest;
+        std::map<uint256, XBridgeOrder> snapshot;
+
+        boost::posix_time::ptime        requested;
+    };
+
+    void apply(Book & book, const XBridgeOrderDelta & delta, Changes & changes);
+
+private:
+    boost::mutex                                 m_lock;
+    std::map<std::vector<unsigned char>, Book>   m_books;
+};
+
+#endif // XBRIDGEORDERBOOK_H
@@ -5,15 +5,25 @@
 #define XBRIDGEPACKET_H
 
 #include <vector>
+#include <string>
 #include <deque>
 #include <memory>
+#include <atomic>
 #include <ctime>
+#include <cstring>
+#include <cassert>
 #include <boost/cstdint.hpp>
-#include <boost/shared_ptr.hpp>
+#include <boost/array.hpp>
+#include <boost/static_assert.hpp>
+#include <boost/intrusive_ptr.hpp>
+
+#include "util/crc32c.h"
+#include "util/uint256.h"
+#include "xbridgepacketpool.h"
 
 //******************************************************************************
 //******************************************************************************
-#define XBRIDGE_PROTOCOL_VERSION 0xff000003
+#define XBRIDGE_PROTOCOL_VERSION 0xff00000b
 
 //******************************************************************************
 //******************************************************************************
@@ -57,7 +67,7 @@ enum XBridgeCommand
     // xbcTransactionFinish     <--    |     --> xbcTransactionFinish
 
 
-    // exchange transaction
+    // exchange transaction, packet contains one or more records
     //
     // xbcTransaction
     //    uint256 client transaction id
@@ -74,6 +84,10 @@ enum XBridgeCommand
     //    uint160 hub address
     //    uint256 client transaction id
     //    uint256 hub transaction id
+    //    uint64 rest of source amount (0 if order filled)
+    //    uint64 rest of destination amount
+    //    uint64 filled source amount, given by client in this swap
+    //    uint64 filled destination amount, received by client
     xbcTransactionHold = 4,
     //
     // xbcTransactionHoldApply
@@ -113,28 +127,30 @@ enum XBridgeCommand
     //    uint160 hub address
     //    uint160 client address
     //    uint256 hub transaction id
-    //    string  raw transaction
+    //    blob    pay transaction (uint32 length, serialized tx)
+    //    blob    revert transaction (uint32 length, serialized tx)
     xbcTransactionCreated = 9,
     //
     // xbcTransactionSign
     //    uint160 client address
     //    uint160 hub address
     //    uint256 hub transaction id
-    //    string  raw transaction
+    //    blob    pay transaction (uint32 length, serialized tx)
+    //    blob    revert transaction (uint32 length, serialized tx)
     xbcTransactionSign = 10,
     //
     // xbcTransactionSigned
     //    uint160 hub address
     //    uint160 client address
     //    uint256 hub transaction id
-    //    string  raw transaction (signed)
+    //    blob    signed revert transaction (uint32 length, serialized tx)
     xbcTransactionSigned = 11,
     //
     // xbcTransactionCommit
-    //    uint160 hub address
     //    uint160 client address
+    //    uint160 hub address
     //    uint256 hub transaction id
-    //    string  raw transaction (signed)
+    //    blob    signed revert transaction (uint32 length, serialized tx)
     xbcTransactionCommit = 12,
     //
     // xbcTransactionCommited
@@ -158,23 +174,20 @@ enum XBridgeCommand
     xbcTransactionConfirmed = 15,
     //
     // xbcTransactionCancel
-    //    uint160 hub address
     //    uint256 hub transaction id
     xbcTransactionCancel = 16,
     //
     // xbcTransactionRollback
-    //    uint160 hub address
+    //    uint160 client address
     //    uint256 hub transaction id
     xbcTransactionRollback = 17,
     //
     // xbcTransactionFinished
-    //    uint160 client address
     //    uint256 hub transaction id
     //
     xbcTransactionFinished = 18,
     //
     // xbcTransactionDropped
-    //    uint160 address
     //    uint256 hub transaction id
     //
     xbcTransactionDropped = 19,
@@ -182,9 +195,16 @@ enum XBridgeCommand
     // smart hub periodically send this message for invitations to trading
     // this message contains address of smart hub and
     // list of connected wallets (btc, xc, etc...)
-    // broadcast message
+    // broadcast message, signed capability record of hub.
+    // clients keep directory of hubs and send orders and cancels
+    // directly to hub owning pair (XBridgeHubRing)
     //
     // xbcExchangeWallets
+    //     uint160 hub address (hash160 of signing public key)
+    //     uint32  fee (basis points)
+    //     uint32  load (count of open orders and swaps)
+    //     uint32  timestamp (seconds since epoch)
+    //     65 bytes compact signature of all other fields and wallet list
     //     {wallet id (string)}|{wallet title (string)}|{wallet id (string)}|{wallet title (string)}
     xbcExchangeWallets = 20,
 
@@ -194,7 +214,8 @@ enum XBridgeCommand
     //     uint256 transaction id (bitcoin transaction hash)
     xbcReceivedTransaction = 21,
 
-    // smart hub broadcast send this message, send list of opened transactions
+    // retired, order books are synced by xbcOrderBookDelta and
+    // xbcOrderBookSnapshot, code not reused, received packets dropped
     //
     // xbcPendingTransaction
     //    uint256 transaction id
@@ -207,7 +228,62 @@ enum XBridgeCommand
     // address book entry
     //
     // xbcAddressBook
-    xbcAddressBookEntry = 23
+    xbcAddressBookEntry = 23,
+
+    // order book sync, hub numbers each change of own order book,
+    // clients apply changes in order and request missing ones
+    //
+    //      client                     hub
+    //                                 |     --> xbcOrderBookDelta (broadcast)
+    //                                 |     --> xbcOrderBookDigest (broadcast)
+    // xbcOrderBookRequest      -->    |
+    //                                 |     --> xbcOrderBookDelta
+    //                                 |         or xbcOrderBookSnapshot
+    //
+    // changes of order book, packet contains header and one or more records
+    //
+    // xbcOrderBookDelta
+    //    uint160 hub address
+    //    uint32  sequence number of first record
+    //  record:
+    //    uint32  operation (XBridgeOrderDelta::Op)
+    //    uint256 transaction id
+    //    8 bytes source currency
+    //    uint64 source amount
+    //    8 bytes destination currency
+    //    uint64 destination amount
+    xbcOrderBookDelta = 24,
+    //
+    // summary of order book, sent by hub every timer tick
+    //
+    // xbcOrderBookDigest
+    //    uint160 hub address
+    //    uint32  sequence number of last change
+    //    uint32  count of orders
+    //    uint256 xor of order hashes
+    xbcOrderBookDigest = 25,
+    //
+    // client request changes after sequence number (0 - full book)
+    //
+    // xbcOrderBookRequest
+    //    uint160 hub address
+    //    uint160 client address
+    //    uint32  last applied sequence number
+    xbcOrderBookRequest = 26,
+    //
+    // full order book, may be splitted into several packets
+    //
+    // xbcOrderBookSnapshot
+    //    uint160 hub address
+    //    uint32  sequence number of last change
+    //    uint32  count of orders in snapshot
+    //  record:
+    //    uint256 transaction id
+    //    8 bytes source currency
+    //    uint64 source amount
+    //    8 bytes destination currency
+    //    uint64 destination amount
+    xbcOrderBookSnapshot = 27
 };
 
 //******************************************************************************
@@ -221,34 +297,56 @@ typedef boost::uint32_t crc_t;
 // boost::uint32_t command
 // boost::uint32_t timestamp
 // boost::uint32_t size
-// boost::uint32_t crc
+// boost::uint32_t crc      crc32c of packet data, without header
 //
 // boost::uint32_t rezerved
 // boost::uint32_t rezerved
 // boost::uint32_t rezerved
+//
+// packet objects and packet buffers allocated from XBridgePacketPool,
+// packets are reference counted by XBridgePacketPtr (intrusive_ptr)
 //******************************************************************************
 class XBridgePacket
 {
-    std::vector<unsigned char> m_body;
+public:
+    typedef std::vector<unsigned char, XBridgePacketAllocator<unsigned char> > Buffer;
+
+private:
+    Buffer                    m_body;
+
+    mutable std::atomic<int> m_refCount;
+
+    friend void intrusive_ptr_add_ref(const XBridgePacket * p);
+    friend void intrusive_ptr_release(const XBridgePacket * p);
 
 public:
     enum
     {
         headerSize    = 8*sizeof(boost::uint32_t),
         commandSize   = sizeof(boost::uint32_t),
-        timestampSize = sizeof(boost::uint32_t)
+        timestampSize = sizeof(boost::uint32_t),
+
+        // payload budget of packet with records, packet is base64
+        // encoded by dht and must fit into 4k udp datagram
+        maxRecordsSize = 2048
     };
 
     std::size_t     size()    const     { return sizeField(); }
     std::size_t     allSize() const     { return m_body.size(); }
+    // payload really in buffer, size() is taken from header
+    std::size_t     payloadSize() const { return allSize() > headerSize ? allSize() - headerSize : 0; }
 
-    crc_t           crc()     const
-    {
-        // TODO implement this
-        assert(false || "not implemented");
-        return (0);
-        // return crcField();
-    }
+    crc_t           crc()     const       { return crcField(); }
+
+    // calculate crc of packet data
+    crc_t           calcCrc() const       { return size() ? util::crc32c(data(), size()) : 0; }
+    // size field must match buffer, crc never read past body
+    bool            isCrcValid() const    { return isSizeValid() && crcField() == calcCrc(); }
+    bool            isSizeValid() const   { return allSize() >= headerSize &&
+                                                   size() == allSize() - headerSize; }
+
+    // packet complete, ready for sending
+    void            finalize()            { crcField() = calcCrc(); }
 
     boost::uint32_t version() const       { return versionField(); }
 
@@ -256,10 +354,10 @@ public:
 
     void    alloc()                       { m_body.resize(headerSize + size()); }
 
-    const std::vector<unsigned char> & body() const
-                                          { return m_body; }
+    const Buffer &   body() const         { return m_body; }
     unsigned char  * header()             { return &m_body[0]; }
     unsigned char  * data()               { return &m_body[headerSize]; }
+    const unsigned char * data() const    { return &m_body[headerSize]; }
 
     // boost::int32_t int32Data() const { return field32<2>(); }
 
@@ -268,9 +366,7 @@ public:
         m_body.resize(headerSize);
         commandField() = 0;
         sizeField() = 0;
-
-        // TODO crc
-        // crcField() = 0;
+        crcField() = 0;
     }
 
     void resize(const unsigned int size)
@@ -322,79 +418,115 @@ public:
         }
     }
 
+    // appends do not reserve, buffer grows geometrically,
+    // use XBridgePacket(command, payloadSize) for exact allocation
     void append(const boost::uint32_t data)
     {
-        m_body.reserve(m_body.size() + sizeof(data));
-        unsigned char * ptr = (unsigned char *)&data;
-        std::copy(ptr, ptr+sizeof(data), std::back_inserter(m_body));
+        const unsigned char * ptr = (const unsigned char *)&data;
+        m_body.insert(m_body.end(), ptr, ptr+sizeof(data));
         sizeField() = m_body.size() - headerSize;
     }
 
     void append(const boost::uint64_t data)
     {
-        m_body.reserve(m_body.size() + sizeof(data));
-        unsigned char * ptr = (unsigned char *)&data;
-        std::copy(ptr, ptr+sizeof(data), std::back_inserter(m_body));
+        const unsigned char * ptr = (const unsigned char *)&data;
+        m_body.insert(m_body.end(), ptr, ptr+sizeof(data));
         sizeField() = m_body.size() - headerSize;
     }
 
     void append(const unsigned char * data, const int size)
     {
-        m_body.reserve(m_body.size() + size);
-        std::copy(data, data+size, std::back_inserter(m_body));
+        m_body.insert(m_body.end(), data, data+size);
         sizeField() = m_body.size() - headerSize;
     }
 
     void append(const std::string & data)
     {
-        m_body.reserve(m_body.size() + data.size()+1);
-        std::copy(data.begin(), data.end(), std::back_inserter(m_body));
+        m_body.insert(m_body.end(), data.begin(), data.end());
         m_body.push_back(0);
         sizeField() = m_body.size() - headerSize;
     }
 
     void append(const std::vector<unsigned char> & data)
     {
-        m_body.reserve(m_body.size() + data.size());
-        std::copy(data.begin(), data.end(), std::back_inserter(m_body));
+        m_body.insert(m_body.end(), data.begin(), data.end());
         sizeField() = m_body.size() - headerSize;
     }
 
-    void    copyFrom(const std::vector<unsigned char> & data)
+    // size of string appended by append(const std::string &)
+    static std::size_t stringSize(const std::string & data) { return data.size() + 1; }
+
+    // size of length prefixed blob
+    static std::size_t blobSize(const std::vector<unsigned char> & data)
+                                        { return sizeof(boost::uint32_t) + data.size(); }
+
+    // false if data shorter than header or size field not matching
+    // data length, packet left empty then
+    bool    copyFrom(const std::vector<unsigned char> & data)
     {
-        m_body = data;
+        if (data.size() < headerSize)
+        {
+            m_body.assign(headerSize, 0);
+            return false;
+        }
+
+        m_body.assign(data.begin(), data.end());
 
         if (sizeField() != data.size()-headerSize)
         {
-            assert(false || "incorrect data size in XBridgePacket::copyFrom");
+            m_body.assign(headerSize, 0);
+            return false;
         }
 
-        // TODO check packet crc
+        // crc checked by receiver before processing,
+        // see XBridgeSession::checkXBridgePacketCrc
+        return true;
     }
 
-    XBridgePacket() : m_body(headerSize, 0)
+    XBridgePacket() : m_body(headerSize, 0), m_refCount(0)
     {
         versionField()   = static_cast<boost::uint32_t>(XBRIDGE_PROTOCOL_VERSION);
         timestampField() = static_cast<boost::uint32_t>(time(0));
     }
 
-    explicit XBridgePacket(const std::string& raw) : m_body(raw.begin(), raw.end())
+    explicit XBridgePacket(const std::string& raw) : m_body(raw.begin(), raw.end()), m_refCount(0)
     {
         timestampField() = static_cast<boost::uint32_t>(time(0));
     }
 
-    XBridgePacket(const XBridgePacket & other)
+    XBridgePacket(const XBridgePacket & other) : m_body(other.m_body), m_refCount(0)
     {
-        m_body = other.m_body;
     }
 
-    XBridgePacket(XBridgeCommand c) : m_body(headerSize, 0)
+    XBridgePacket(XBridgeCommand c) : m_body(headerSize, 0), m_refCount(0)
     {
         versionField()   = static_cast<boost::uint32_t>(XBRIDGE_PROTOCOL_VERSION);
         commandField()   = static_cast<boost::uint32_t>(c);
         timestampField() = static_cast<boost::uint32_t>(time(0));
     }
 
+    // packet with buffer allocated once for payload of exact size,
+    // following appends of payloadSize bytes does not reallocate
+    XBridgePacket(XBridgeCommand c, const std::size_t payloadSize) : m_refCount(0)
+    {
+        m_body.reserve(headerSize + payloadSize);
+        m_body.resize(headerSize, 0);
+
+        versionField()   = static_cast<boost::uint32_t>(XBRIDGE_PROTOCOL_VERSION);
+        commandField()   = static_cast<boost::uint32_t>(c);
+        timestampField() = static_cast<boost::uint32_t>(time(0));
+    }
+
+    static void * operator new(std::size_t size)
+    {
+        return XBridgePacketPool::allocatePacket(size);
+    }
+
+    static void operator delete(void * ptr, std::size_t size)
+    {
+        XBridgePacketPool::deallocatePacket(ptr, size);
+    }
+
     XBridgePacket & operator = (const XBridgePacket & other)
     {
         m_body    = other.m_body;
@@ -423,7 +555,837 @@ private:
     boost::uint32_t const & crcField() const       { return field32<4>(); }
 };
 
-typedef boost::shared_ptr<XBridgePacket> XBridgePacketPtr;
+//******************************************************************************
+//******************************************************************************
+inline void intrusive_ptr_add_ref(const XBridgePacket * p)
+{
+    ++p->m_refCount;
+}
+
+inline void intrusive_ptr_release(const XBridgePacket * p)
+{
+    if (--p->m_refCount == 0)
+    {
+        delete p;
+    }
+}
+
+typedef boost::intrusive_ptr<XBridgePacket> XBridgePacketPtr;
 typedef std::deque<XBridgePacketPtr>   XBridgePacketQueue;
 
+//******************************************************************************
+// packet layouts
+//
+// payload of each command described by list of fields,
+// offset of field calculated at compile time from previous field.
+// fixed part of payload is followed by optional variable tail:
+//   xbtNone    - no tail, payload size must be eq fixed size
+//   xbtStrings - tail contains `items` zero terminated strings
+//   xbtBlobs   - tail contains `items` binary blobs,
+//                each prefixed by uint32 length
+//   xbtBytes   - tail contains any data
+//
+// some commands carry array of fixed size records after optional
+// fixed header, count of records calculated from payload size
+// (see XBridgeRecordsView, XBridgeRecordsWriter)
+//
+// layout of received packet checked once before dispatching
+// (see checkXBridgePacketLayout), handlers read fields
+// through XBridgePacketView without any size checks
+//******************************************************************************
+template <std::size_t OFFSET, std::size_t SIZE>
+struct XBridgeField
+{
+    static const std::size_t offset = OFFSET;
+    static const std::size_t size   = SIZE;
+    static const std::size_t end    = OFFSET + SIZE;
+};
+
+template <typename PREV, std::size_t SIZE>
+struct XBridgeNextField : public XBridgeField<PREV::end, SIZE>
+{
+};
+
+enum XBridgeTail
+{
+    xbtNone = 0,
+    xbtStrings,
+    xbtBlobs,
+    xbtBytes
+};
+
+struct XBridgeFieldSize
+{
+    enum
+    {
+        address  = 20,
+        hash     = 32,
+        currency = 8,
+        amount   = sizeof(boost::uint64_t),
+        lockTime = sizeof(boost::uint32_t),
+        sequence = sizeof(boost::uint32_t),
+        count    = sizeof(boost::uint32_t),
+        op       = sizeof(boost::uint32_t),
+        fee      = sizeof(boost::uint32_t),
+        time     = sizeof(boost::uint32_t),
+        // compact recoverable signature
+        signature = 65
+    };
+};
+
+//******************************************************************************
+//******************************************************************************
+struct XBridgeLayoutEmpty
+{
+    enum { size = 0, items = 0 };
+    static const XBridgeTail tail = xbtNone;
+};
+
+struct XBridgeLayoutAnnounceAddresses
+{
+    typedef XBridgeField<0, XBridgeFieldSize::address>              Address;
+
+    enum { size = Address::end, items = 0 };
+    static const XBridgeTail tail = xbtNone;
+};
+
+struct XBridgeLayoutXChatMessage
+{
+    typedef XBridgeField<0, XBridgeFieldSize::address>              DestAddress;
+
+    enum { size = DestAddress::end, items = 0 };
+    static const XBridgeTail tail = xbtBytes;
+};
+
+struct XBridgeLayoutTransaction
+{
+    typedef XBridgeField<0, XBridgeFieldSize::hash>                 Id;
+    typedef XBridgeNextField<Id, XBridgeFieldSize::address>         SourceAddress;
+    typedef XBridgeNextField<SourceAddress, XBridgeFieldSize::currency> SourceCurrency;
+    typedef XBridgeNextField<SourceCurrency, XBridgeFieldSize::amount>  SourceAmount;
+    typedef XBridgeNextField<SourceAmount, XBridgeFieldSize::address>   DestAddress;
+    typedef XBridgeNextField<DestAddress, XBridgeFieldSize::currency>   DestCurrency;
+    typedef XBridgeNextField<DestCurrency, XBridgeFieldSize::amount>    DestAmount;
+
+    enum { size = DestAmount::end, items = 0 };
+    static const XBridgeTail tail = xbtNone;
+};
+
+struct XBridgeLayoutTransactionHold
+{
+    typedef XBridgeField<0, XBridgeFieldSize::address>              ClientAddress;
+    typedef XBridgeNextField<ClientAddress, XBridgeFieldSize::address> HubAddress;
+    typedef XBridgeNextField<HubAddress, XBridgeFieldSize::hash>    ClientTxId;
+    typedef XBridgeNextField<ClientTxId, XBridgeFieldSize::hash>    HubTxId;
+    typedef XBridgeNextField<HubTxId, XBridgeFieldSize::amount>     RestSourceAmount;
+    typedef XBridgeNextField<RestSourceAmount, XBridgeFieldSize::amount> RestDestAmount;
+    typedef XBridgeNextField<RestDestAmount, XBridgeFieldSize::amount> FillSourceAmount;
+    typedef XBridgeNextField<FillSourceAmount, XBridgeFieldSize::amount> FillDestAmount;
+
+    enum { size = FillDestAmount::end, items = 0 };
+    static const XBridgeTail tail = xbtNone;
+};
+
+// common part of replies from client to hub
+// (hold apply, initialized, confirmed)
+struct XBridgeLayoutClientReply
+{
+    typedef XBridgeField<0, XBridgeFieldSize::address>              HubAddress;
+    typedef XBridgeNextField<HubAddress, XBridgeFieldSize::address> ClientAddress;
+    typedef XBridgeNextField<ClientAddress, XBridgeFieldSize::hash> HubTxId;
+
+    enum { size = HubTxId::end, items = 0 };
+    static const XBridgeTail tail = xbtNone;
+};
+
+struct XBridgeLayoutTransactionInit
+{
+    typedef XBridgeField<0, XBridgeFieldSize::address>              ClientAddress;
+    typedef XBridgeNextField<ClientAddress, XBridgeFieldSize::address> HubAddress;
+    typedef XBridgeNextField<HubAddress, XBridgeFieldSize::hash>    HubTxId;
+    typedef XBridgeNextField<HubTxId, XBridgeFieldSize::address>    SourceAddress;
+    typedef XBridgeNextField<SourceAddress, XBridgeFieldSize::currency> SourceCurrency;
+    typedef XBridgeNextField<SourceCurrency, XBridgeFieldSize::amount>  SourceAmount;
+    typedef XBridgeNextField<SourceAmount, XBridgeFieldSize::address>   DestAddress;
+    typedef XBridgeNextField<DestAddress, XBridgeFieldSize::currency>   DestCurrency;
+    typedef XBridgeNextField<DestCurrency, XBridgeFieldSize::amount>    DestAmount;
+
+    enum { size = DestAmount::end, items = 0 };
+    static const XBridgeTail tail = xbtNone;
+};
+
+struct XBridgeLayoutTransactionCreate
+{
+    typedef XBridgeField<0, XBridgeFieldSize::address>              ClientAddress;
+    typedef XBridgeNextField<ClientAddress, XBridgeFieldSize::address> HubAddress;
+    typedef XBridgeNextField<HubAddress, XBridgeFieldSize::hash>    HubTxId;
+    typedef XBridgeNextField<HubTxId, XBridgeFieldSize::address>    DestAddress;
+    typedef XBridgeNextField<DestAddress, XBridgeFieldSize::lockTime> LockTimeTx1;
+    typedef XBridgeNextField<LockTimeTx1, XBridgeFieldSize::lockTime> LockTimeTx2;
+
+    enum { size = LockTimeTx2::end, items = 0 };
+    static const XBridgeTail tail = xbtNone;
+};
+
+// created - pay and revert tx, signed - revert tx,
+// serialized transactions in blobs
+struct XBridgeLayoutTransactionCreated
+{
+    typedef XBridgeField<0, XBridgeFieldSize::address>              HubAddress;
+    typedef XBridgeNextField<HubAddress, XBridgeFieldSize::address> ClientAddress;
+    typedef XBridgeNextField<ClientAddress, XBridgeFieldSize::hash> HubTxId;
+
+    enum { size = HubTxId::end, items = 2 };
+    static const XBridgeTail tail = xbtBlobs;
+};
+
+struct XBridgeLayoutTransactionSigned
+{
+    typedef XBridgeLayoutTransactionCreated::HubAddress             HubAddress;
+    typedef XBridgeLayoutTransactionCreated::ClientAddress          ClientAddress;
+    typedef XBridgeLayoutTransactionCreated::HubTxId                HubTxId;
+
+    enum { size = HubTxId::end, items = 1 };
+    static const XBridgeTail tail = xbtBlobs;
+};
+
+// sign - pay and revert tx of other side, commit - revert tx,
+// serialized transactions in blobs
+struct XBridgeLayoutTransactionSign
+{
+    typedef XBridgeField<0, XBridgeFieldSize::address>              ClientAddress;
+    typedef XBridgeNextField<ClientAddress, XBridgeFieldSize::address> HubAddress;
+    typedef XBridgeNextField<HubAddress, XBridgeFieldSize::hash>    HubTxId;
+
+    enum { size = HubTxId::end, items = 2 };
+    static const XBridgeTail tail = xbtBlobs;
+};
+
+struct XBridgeLayoutTransactionCommit
+{
+    typedef XBridgeLayoutTransactionSign::ClientAddress             ClientAddress;
+    typedef XBridgeLayoutTransactionSign::HubAddress                HubAddress;
+    typedef XBridgeLayoutTransactionSign::HubTxId                   HubTxId;
+
+    enum { size = HubTxId::end, items = 1 };
+    static const XBridgeTail tail = xbtBlobs;
+};
+
+struct XBridgeLayoutTransactionCommited
+{
+    typedef XBridgeField<0, XBridgeFieldSize::address>              HubAddress;
+    typedef XBridgeNextField<HubAddress, XBridgeFieldSize::address> ClientAddress;
+    typedef XBridgeNextField<ClientAddress, XBridgeFieldSize::hash> HubTxId;
+    typedef XBridgeNextField<HubTxId, XBridgeFieldSize::hash>       TxHash;
+
+    enum { size = TxHash::end, items = 0 };
+    static const XBridgeTail tail = xbtNone;
+};
+
+struct XBridgeLayoutTransactionConfirm
+{
+    typedef XBridgeField<0, XBridgeFieldSize::address>              ClientAddress;
+    typedef XBridgeNextField<ClientAddress, XBridgeFieldSize::address> HubAddress;
+    typedef XBridgeNextField<HubAddress, XBridgeFieldSize::hash>    HubTxId;
+    typedef XBridgeNextField<HubTxId, XBridgeFieldSize::hash>       TxHash;
+
+    enum { size = TxHash::end, items = 0 };
+    static const XBridgeTail tail = xbtNone;
+};
+
+// cancel, finished, dropped, received transaction
+struct XBridgeLayoutTxId
+{
+    typedef XBridgeField<0, XBridgeFieldSize::hash>                 Id;
+
+    enum { size = Id::end, items = 0 };
+    static const XBridgeTail tail = xbtNone;
+};
+
+struct XBridgeLayoutTransactionRollback
+{
+    typedef XBridgeField<0, XBridgeFieldSize::address>              ClientAddress;
+    typedef XBridgeNextField<ClientAddress, XBridgeFieldSize::hash> HubTxId;
+
+    enum { size = HubTxId::end, items = 0 };
+    static const XBridgeTail tail = xbtNone;
+};
+
+struct XBridgeLayoutExchangeWallets
+{
+    typedef XBridgeField<0, XBridgeFieldSize::address>              HubAddress;
+    typedef XBridgeNextField<HubAddress, XBridgeFieldSize::fee>     Fee;
+    typedef XBridgeNextField<Fee, XBridgeFieldSize::count>          Load;
+    typedef XBridgeNextField<Load, XBridgeFieldSize::time>          Timestamp;
+    typedef XBridgeNextField<Timestamp, XBridgeFieldSize::signature> Signature;
+
+    enum { size = Signature::end, items = 0 };
+    static const XBridgeTail tail = xbtBytes;
+};
+
+struct XBridgeLayoutPendingTransaction
+{
+    typedef XBridgeField<0, XBridgeFieldSize::hash>                 Id;
+    typedef XBridgeNextField<Id, XBridgeFieldSize::currency>        SourceCurrency;
+    typedef XBridgeNextField<SourceCurrency, XBridgeFieldSize::amount> SourceAmount;
+    typedef XBridgeNextField<SourceAmount, XBridgeFieldSize::currency> DestCurrency;
+    typedef XBridgeNextField<DestCurrency, XBridgeFieldSize::amount>   DestAmount;
+
+    enum { size = DestAmount::end, items = 0 };
+    static const XBridgeTail tail = xbtNone;
+};
+
+struct XBridgeLayoutAddressBookEntry
+{
+    // currency, name, address
+    enum { size = 0, items = 3 };
+    static const XBridgeTail tail = xbtStrings;
+};
+
+struct XBridgeLayoutOrderBookDeltaHeader
+{
+    typedef XBridgeField<0, XBridgeFieldSize::address>              HubAddress;
+    typedef XBridgeNextField<HubAddress, XBridgeFieldSize::sequence> Sequence;
+
+    enum { size = Sequence::end, items = 0 };
+    static const XBridgeTail tail = xbtNone;
+};
+
+struct XBridgeLayoutOrderBookDelta
+{
+    typedef XBridgeField<0, XBridgeFieldSize::op>                   Op;
+    typedef XBridgeNextField<Op, XBridgeFieldSize::hash>            Id;
+    typedef XBridgeNextField<Id, XBridgeFieldSize::currency>        SourceCurrency;
+    typedef XBridgeNextField<SourceCurrency, XBridgeFieldSize::amount> SourceAmount;
+    typedef XBridgeNextField<SourceAmount, XBridgeFieldSize::currency> DestCurrency;
+    typedef XBridgeNextField<DestCurrency, XBridgeFieldSize::amount>   DestAmount;
+
+    enum { size = DestAmount::end, items = 0 };
+    static const XBridgeTail tail = xbtNone;
+};
+
+struct XBridgeLayoutOrderBookDigest
+{
+    typedef XBridgeField<0, XBridgeFieldSize::address>              HubAddress;
+    typedef XBridgeNextField<HubAddress, XBridgeFieldSize::sequence> Sequence;
+    typedef XBridgeNextField<Sequence, XBridgeFieldSize::count>     Count;
+    typedef XBridgeNextField<Count, XBridgeFieldSize::hash>         Digest;
+
+    enum { size = Digest::end, items = 0 };
+    static const XBridgeTail tail = xbtNone;
+};
+
+struct XBridgeLayoutOrderBookRequest
+{
+    typedef XBridgeField<0, XBridgeFieldSize::address>              HubAddress;
+    typedef XBridgeNextField<HubAddress, XBridgeFieldSize::address> ClientAddress;
+    typedef XBridgeNextField<ClientAddress, XBridgeFieldSize::sequence> Sequence;
+
+    enum { size = Sequence::end, items = 0 };
+    static const XBridgeTail tail = xbtNone;
+};
+
+struct XBridgeLayoutOrderBookSnapshotHeader
+{
+    typedef XBridgeField<0, XBridgeFieldSize::address>              HubAddress;
+    typedef XBridgeNextField<HubAddress, XBridgeFieldSize::sequence> Sequence;
+    typedef XBridgeNextField<Sequence, XBridgeFieldSize::count>     Count;
+
+    enum { size = Count::end, items = 0 };
+    static const XBridgeTail tail = xbtNone;
+};
+
+//******************************************************************************
+// not owning view of bytes inside packet
+//******************************************************************************
+struct XBridgeSpan
+{
+    const unsigned char * data;
+    std::size_t           size;
+
+    XBridgeSpan(const unsigned char * d, const std::size_t s) : data(d), size(s) {}
+
+    const unsigned char * begin() const { return data; }
+    const unsigned char * end()   const { return data + size; }
+
+    std::vector<unsigned char> vector() const { return std::vector<unsigned char>(begin(), end()); }
+
+    bool operator == (const std::vector<unsigned char> & other) const
+    {
+        return other.size() == size && (size == 0 || memcmp(&other[0], data, size) == 0);
+    }
+    bool operator != (const std::vector<unsigned char> & other) const
+    {
+        return !(*this == other);
+    }
+};
+
+//******************************************************************************
+// read only view over packet payload, does not copy data
+//******************************************************************************
+template <typename LAYOUT>
+class XBridgePacketView
+{
+public:
+    explicit XBridgePacketView(const XBridgePacketPtr & packet)
+        : m_data(static_cast<const XBridgePacket &>(*packet).data())
+        , m_size(packet->payloadSize())
+    {
+        assert(m_size >= static_cast<std::size_t>(LAYOUT::size) && "packet layout not checked");
+    }
+
+    // view of one record inside packet
+    XBridgePacketView(const unsigned char * data, const std::size_t size)
+        : m_data(data)
+        , m_size(size)
+    {
+        assert(m_size >= static_cast<std::size_t>(LAYOUT::size) && "packet layout not checked");
+    }
+
+    template <typename FIELD>
+    const unsigned char * ptr() const
+    {
+        BOOST_STATIC_ASSERT(FIELD::end <= LAYOUT::size);
+        return m_data + FIELD::offset;
+    }
+
+    template <typename FIELD>
+    XBridgeSpan span() const
+    {
+        return XBridgeSpan(ptr<FIELD>(), FIELD::size);
+    }
+
+    template <typename FIELD>
+    boost::array<unsigned char, FIELD::size> array() const
+    {
+        boost::array<unsigned char, FIELD::size> result;
+        memcpy(result.data(), ptr<FIELD>(), FIELD::size);
+        return result;
+    }
+
+    template <typename FIELD>
+    uint256 hash() const
+    {
+        BOOST_STATIC_ASSERT(FIELD::size == XBridgeFieldSize::hash);
+        return uint256(ptr<FIELD>());
+    }
+
+    template <typename FIELD>
+    boost::uint32_t uint32() const
+    {
+        BOOST_STATIC_ASSERT(FIELD::size == sizeof(boost::uint32_t));
+        boost::uint32_t result;
+        memcpy(&result, ptr<FIELD>(), sizeof(result));
+        return result;
+    }
+
+    template <typename FIELD>
+    boost::uint64_t uint64() const
+    {
+        BOOST_STATIC_ASSERT(FIELD::size == sizeof(boost::uint64_t));
+        boost::uint64_t result;
+        memcpy(&result, ptr<FIELD>(), sizeof(result));
+        return result;
+    }
+
+    // zero padded string, not longer than field
+    template <typename FIELD>
+    std::string string() const
+    {
+        const char * str = reinterpret_cast<const char *>(ptr<FIELD>());
+        const char * end = static_cast<const char *>(memchr(str, 0, FIELD::size));
+        return std::string(str, end ? end : str + FIELD::size);
+    }
+
+    // variable part after fixed fields
+    XBridgeSpan tail() const
+    {
+        return XBridgeSpan(m_data + LAYOUT::size, m_size - LAYOUT::size);
+    }
+
+    // index string of xbtStrings tail, terminating zero checked by layout check
+    const char * tailString(const std::size_t index) const
+    {
+        BOOST_STATIC_ASSERT(LAYOUT::tail == xbtStrings);
+        assert(index < static_cast<std::size_t>(LAYOUT::items));
+
+        const char * str = reinterpret_cast<const char *>(m_data + LAYOUT::size);
+        for (std::size_t i = 0; i < index; ++i)
+        {
+            str += strlen(str) + 1;
+        }
+        return str;
+    }
+
+    // index blob of xbtBlobs tail, lengths checked by layout check
+    XBridgeSpan tailBlob(const std::size_t index) const
+    {
+        BOOST_STATIC_ASSERT(LAYOUT::tail == xbtBlobs);
+        assert(index < static_cast<std::size_t>(LAYOUT::items));
+
+        const unsigned char * ptr = m_data + LAYOUT::size;
+        for (std::size_t i = 0; ; ++i)
+        {
+            boost::uint32_t length;
+            memcpy(&length, ptr, sizeof(length));
+            ptr += sizeof(length);
+
+            if (i == index)
+            {
+                return XBridgeSpan(ptr, length);
+            }
+            ptr += length;
+        }
+    }
+
+private:
+    const unsigned char * m_data;
+    const std::size_t     m_size;
+};
+
+//******************************************************************************
+// field setters shared by packet and record writers,
+// WRITER provides base() - pointer to start of layout
+//******************************************************************************
+template <typename LAYOUT, typename WRITER>
+class XBridgeFieldWriter
+{
+public:
+    template <typename FIELD>
+    WRITER & set(const unsigned char * data)
+    {
+        memcpy(ptr<FIELD>(), data, FIELD::size);
+        return self();
+    }
+
+    template <typename FIELD>
+    WRITER & set(const std::vector<unsigned char> & data)
+    {
+        assert(data.size() == static_cast<std::size_t>(FIELD::size) && "incorrect field size");
+        return set<FIELD>(&data[0]);
+    }
+
+    template <typename FIELD>
+    WRITER & set(const XBridgeSpan & data)
+    {
+        assert(data.size == static_cast<std::size_t>(FIELD::size) && "incorrect field size");
+        return set<FIELD>(data.data);
+    }
+
+    template <typename FIELD>
+    WRITER & set(const uint256 & data)
+    {
+        BOOST_STATIC_ASSERT(FIELD::size == XBridgeFieldSize::hash);
+        return set<FIELD>(data.begin());
+    }
+
+    template <typename FIELD>
+    WRITER & set(const boost::uint32_t data)
+    {
+        BOOST_STATIC_ASSERT(FIELD::size == sizeof(data));
+        memcpy(ptr<FIELD>(), &data, sizeof(data));
+        return self();
+    }
+
+    template <typename FIELD>
+    WRITER & set(const boost::uint64_t data)
+    {
+        BOOST_STATIC_ASSERT(FIELD::size == sizeof(data));
+        memcpy(ptr<FIELD>(), &data, sizeof(data));
+        return self();
+    }
+
+    // zero padded string, truncated to field size
+    template <typename FIELD>
+    WRITER & setString(const std::string & data)
+    {
+        unsigned char * p = ptr<FIELD>();
+        memset(p, 0, FIELD::size);
+        data.copy(reinterpret_cast<char *>(p), FIELD::size);
+        return self();
+    }
+
+private:
+    template <typename FIELD>
+    unsigned char * ptr()
+    {
+        BOOST_STATIC_ASSERT(FIELD::end <= LAYOUT::size);
+        return self().base() + FIELD::offset;
+    }
+
+    WRITER & self() { return static_cast<WRITER &>(*this); }
+};
+
+//******************************************************************************
+// writes fields directly into packet buffer,
+// buffer allocated once for fixed part and tailSize bytes of tail
+//******************************************************************************
+template <typename LAYOUT>
+class XBridgePacketWriter : public XBridgeFieldWriter<LAYOUT, XBridgePacketWriter<LAYOUT> >
+{
+    friend class XBridgeFieldWriter<LAYOUT, XBridgePacketWriter<LAYOUT> >;
+
+public:
+    XBridgePacketWriter(const XBridgeCommand command, const std::size_t tailSize = 0)
+        : m_packet(new XBridgePacket(command, LAYOUT::size + tailSize))
+    {
+        m_packet->resize(LAYOUT::size);
+    }
+
+    XBridgePacketWriter & appendString(const std::string & data)
+    {
+        BOOST_STATIC_ASSERT(LAYOUT::tail == xbtStrings);
+        m_packet->append(data);
+        return *this;
+    }
+
+    XBridgePacketWriter & appendBlob(const std::vector<unsigned char> & data)
+    {
+        BOOST_STATIC_ASSERT(LAYOUT::tail == xbtBlobs);
+        m_packet->append(static_cast<boost::uint32_t>(data.size()));
+        m_packet->append(data);
+        return *this;
+    }
+
+    XBridgePacketWriter & appendTail(const unsigned char * data, const std::size_t size)
+    {
+        BOOST_STATIC_ASSERT(LAYOUT::tail == xbtBytes);
+        m_packet->append(data, static_cast<int>(size));
+        return *this;
+    }
+
+    const XBridgePacketPtr & packet() const { return m_packet; }
+
+private:
+    unsigned char * base() { return m_packet->data(); }
+
+private:
+    XBridgePacketPtr m_packet;
+};
+
+//******************************************************************************
+// writes fields of one record, valid until next record added
+//******************************************************************************
+template <typename RECORD>
+class XBridgeRecordWriter : public XBridgeFieldWriter<RECORD, XBridgeRecordWriter<RECORD> >
+{
+    friend class XBridgeFieldWriter<RECORD, XBridgeRecordWriter<RECORD> >;
+
+public:
+    explicit XBridgeRecordWriter(unsigned char * data) : m_data(data) {}
+
+private:
+    unsigned char * base() { return m_data; }
+
+private:
+    unsigned char * m_data;
+};
+
+//******************************************************************************
+// packet with HEADER and array of RECORD, not more than maxCount records,
+// buffer allocated once for header and all records
+//******************************************************************************
+template <typename RECORD, typename HEADER = XBridgeLayoutEmpty>
+class XBridgeRecordsWriter
+{
+    BOOST_STATIC_ASSERT(RECORD::tail == xbtNone && HEADER::tail == xbtNone);
+    BOOST_STATIC_ASSERT(RECORD::size > 0 &&
+                        static_cast<int>(HEADER::size) + static_cast<int>(RECORD::size) <=
+                        static_cast<int>(XBridgePacket::maxRecordsSize));
+
+public:
+    enum { maxCount = (static_cast<int>(XBridgePacket::maxRecordsSize) - static_cast<int>(HEADER::size)) /
+                      static_cast<int>(RECORD::size) };
+
+    explicit XBridgeRecordsWriter(const XBridgeCommand command)
+        : m_packet(new XBridgePacket(command, static_cast<std::size_t>(HEADER::size) +
+                                                static_cast<std::size_t>(maxCount) * RECORD::size))
+        , m_count(0)
+    {
+        m_packet->resize(HEADER::size);
+    }
+
+    XBridgeRecordWriter<HEADER> header()
+    {
+        return XBridgeRecordWriter<HEADER>(m_packet->data());
+    }
+
+    XBridgeRecordWriter<RECORD> addRecord()
+    {
+        assert(!full() && "records packet overflow");
+
+        // capacity reserved, resize does not move buffer
+        const std::size_t offset = m_packet->size();
+        m_packet->resize(offset + RECORD::size);
+        ++m_count;
+        return XBridgeRecordWriter<RECORD>(m_packet->data() + offset);
+    }
+
+    std::size_t count() const { return m_count; }
+    bool        empty() const { return m_count == 0; }
+    bool        full()  const { return m_count == static_cast<std::size_t>(maxCount); }
+
+    const XBridgePacketPtr & packet() const { return m_packet; }
+
+private:
+    XBridgePacketPtr m_packet;
+    std::size_t      m_count;
+};
+
+//******************************************************************************
+// read only view over packet with HEADER and array of RECORD
+//******************************************************************************
+template <typename RECORD, typename HEADER = XBridgeLayoutEmpty>
+class XBridgeRecordsView
+{
+public:
+    explicit XBridgeRecordsView(const XBridgePacketPtr & packet)
+        : m_data(static_cast<const XBridgePacket &>(*packet).data())
+        , m_count((packet->payloadSize() - HEADER::size) / RECORD::size)
+    {
+        assert(packet->payloadSize() >= static_cast<std::size_t>(HEADER::size) &&
+               (packet->payloadSize() - HEADER::size) % RECORD::size == 0 && "packet layout not checked");
+    }
+
+    XBridgePacketView<HEADER> header() const
+    {
+        return XBridgePacketView<HEADER>(m_data, HEADER::size);
+    }
+
+    std::size_t count() const { return m_count; }
+
+    XBridgePacketView<RECORD> operator[] (const std::size_t index) const
+    {
+        assert(index < m_count);
+        return XBridgePacketView<RECORD>(m_data + HEADER::size + index * RECORD::size, RECORD::size);
+    }
+
+private:
+    const unsigned char * m_data;
+    const std::size_t     m_count;
+};
+
+//******************************************************************************
+//******************************************************************************
+template <typename LAYOUT>
+bool checkXBridgeLayout(const XBridgePacket & packet)
+{
+    // buffer length, size field of header must agree
+    const std::size_t size = packet.payloadSize();
+    if (packet.size() != size)
+    {
+        return false;
+    }
+    if (LAYOUT::tail == xbtNone)
+    {
+        return size == static_cast<std::size_t>(LAYOUT::size);
+    }
+    if (size < static_cast<std::size_t>(LAYOUT::size))
+    {
+        return false;
+    }
+    if (LAYOUT::tail == xbtStrings)
+    {
+        // tail must contain all zero terminated strings
+        const unsigned char * ptr = packet.data() + LAYOUT::size;
+        const unsigned char * end = packet.data() + size;
+        for (int i = 0; i < LAYOUT::items; ++i)
+        {
+            ptr = static_cast<const unsigned char *>(memchr(ptr, 0, end - ptr));
+            if (!ptr)
+            {
+                return false;
+            }
+            ++ptr;
+        }
+    }
+    else if (LAYOUT::tail == xbtBlobs)
+    {
+        // blobs must fill tail exactly
+        std::size_t rest = size - LAYOUT::size;
+        const unsigned char * ptr = packet.data() + LAYOUT::size;
+        for (int i = 0; i < LAYOUT::items; ++i)
+        {
+            boost::uint32_t length;
+            if (rest < sizeof(length))
+            {
+                return false;
+            }
+            memcpy(&length, ptr, sizeof(length));
+            ptr  += sizeof(length);
+            rest -= sizeof(length);
+
+            if (rest < length)
+            {
+                return false;
+            }
+            ptr  += length;
+            rest -= length;
+        }
+        return rest == 0;
+    }
+    return true;
+}
+
+//******************************************************************************
+// header and whole records, not more than packet budget,
+// packet without header must contain at least one record
+//******************************************************************************
+template <typename RECORD, typename HEADER>
+bool checkXBridgeRecords(const XBridgePacket & packet)
+{
+    const std::size_t size = packet.payloadSize();
+    return packet.size() == size &&
+           size >= static_cast<std::size_t>(HEADER::size) &&
+           size > 0 &&
+           size <= static_cast<std::size_t>(XBridgePacket::maxRecordsSize) &&
+           (size - HEADER::size) % RECORD::size == 0;
+}
+
+template <typename RECORD>
+bool checkXBridgeRecords(const XBridgePacket & packet)
+{
+    return checkXBridgeRecords<RECORD, XBridgeLayoutEmpty>(packet);
+}
+
+//******************************************************************************
+// check payload of received packet against layout of command,
+// unknown commands are not checked here
+//******************************************************************************
+inline bool checkXBridgePacketLayout(const XBridgePacket & packet)
+{
+    switch (packet.command())
+    {
+        case xbcAnnounceAddresses:      return checkXBridgeLayout<XBridgeLayoutAnnounceAddresses>(packet);
+        case xbcXChatMessage:           return checkXBridgeLayout<XBridgeLayoutXChatMessage>(packet);
+        case xbcTransaction:            return checkXBridgeRecords<XBridgeLayoutTransaction>(packet);
+        case xbcTransactionHold:        return checkXBridgeLayout<XBridgeLayoutTransactionHold>(packet);
+        case xbcTransactionHoldApply:   return checkXBridgeLayout<XBridgeLayoutClientReply>(packet);
+        case xbcTransactionInit:        return checkXBridgeLayout<XBridgeLayoutTransactionInit>(packet);
+        case xbcTransactionInitialized: return checkXBridgeLayout<XBridgeLayoutClientReply>(packet);
+        case xbcTransactionCreate:      return checkXBridgeLayout<XBridgeLayoutTransactionCreate>(packet);
+        case xbcTransactionCreated:     return checkXBridgeLayout<XBridgeLayoutTransactionCreated>(packet);
+        case xbcTransactionSign:        return checkXBridgeLayout<XBridgeLayoutTransactionSign>(packet);
+        case xbcTransactionSigned:      return checkXBridgeLayout<XBridgeLayoutTransactionSigned>(packet);
+        case xbcTransactionCommit:      return checkXBridgeLayout<XBridgeLayoutTransactionCommit>(packet);
+        case xbcTransactionCommited:    return checkXBridgeLayout<XBridgeLayoutTransactionCommited>(packet);
+        case xbcTransactionConfirm:     return checkXBridgeLayout<XBridgeLayoutTransactionConfirm>(packet);
+        case xbcTransactionConfirmed:   return checkXBridgeLayout<XBridgeLayoutClientReply>(packet);
+        case xbcTransactionCancel:      return checkXBridgeLayout<XBridgeLayoutTxId>(packet);
+        case xbcTransactionRollback:    return checkXBridgeLayout<XBridgeLayoutTransactionRollback>(packet);
+        case xbcTransactionFinished:    return checkXBridgeLayout<XBridgeLayoutTxId>(packet);
+        case xbcTransactionDropped:     return checkXBridgeLayout<XBridgeLayoutTxId>(packet);
+        case xbcExchangeWallets:        return checkXBridgeLayout<XBridgeLayoutExchangeWallets>(packet);
+        case xbcReceivedTransaction:    return checkXBridgeLayout<XBridgeLayoutTxId>(packet);
+        case xbcAddressBookEntry:       return checkXBridgeLayout<XBridgeLayoutAddressBookEntry>(packet);
+        case xbcOrderBookDelta:         return checkXBridgeRecords<XBridgeLayoutOrderBookDelta,
+                                                                   XBridgeLayoutOrderBookDeltaHeader>(packet);
+        case xbcOrderBookDigest:        return checkXBridgeLayout<XBridgeLayoutOrderBookDigest>(packet);
+        case xbcOrderBookRequest:       return checkXBridgeLayout<XBridgeLayoutOrderBookRequest>(packet);
+        case xbcOrderBookSnapshot:      return checkXBridgeRecords<XBridgeLayoutPendingTransaction,
+                                                                   XBridgeLayoutOrderBookSnapshotHeader>(packet);
+        default:                        return true;
+    }
+}
+
 #endif // XBRIDGEPACKET_H
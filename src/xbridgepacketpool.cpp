@@ -0,0 +1,120 @@
+//*****************************************************************************
+//*****************************************************************************
+
+#include "xbridgepacketpool.h"
+#include "xbridgepacket.h"
+
+#include <boost/pool/singleton_pool.hpp>
+
+//*****************************************************************************
+//*****************************************************************************
+template <std::size_t SIZE>
+struct XBridgeBufferPool
+{
+    struct Tag {};
+    typedef boost::singleton_pool<Tag, SIZE> Pool;
+
+    static void * malloc()
+    {
+        void * ptr = Pool::malloc();
+        if (!ptr)
+        {
+            throw std::bad_alloc();
+        }
+        return ptr;
+    }
+
+    static void free(void * ptr)
+    {
+        Pool::free(ptr);
+    }
+};
+
+//*****************************************************************************
+//*****************************************************************************
+// static
+std::size_t XBridgePacketPool::sizeClass(const std::size_t size)
+{
+    std::size_t cls = 0;
+    for (std::size_t classSize = minClassSize; classSize < size; classSize <<= 1)
+    {
+        if (++cls == classCount)
+        {
+            break;
+        }
+    }
+    return cls;
+}
+
+//*****************************************************************************
+//*****************************************************************************
+// static
+void * XBridgePacketPool::allocate(const std::size_t size)
+{
+    switch (sizeClass(size))
+    {
+        case 0:  return XBridgeBufferPool<64>::malloc();
+        case 1:  return XBridgeBufferPool<128>::malloc();
+        case 2:  return XBridgeBufferPool<256>::malloc();
+        case 3:  return XBridgeBufferPool<512>::malloc();
+        case 4:  return XBridgeBufferPool<1024>::malloc();
+        case 5:  return XBridgeBufferPool<2048>::malloc();
+        case 6:  return XBridgeBufferPool<4096>::malloc();
+        case 7:  return XBridgeBufferPool<8192>::malloc();
+        default: return ::operator new(size);
+    }
+}
+
+//*****************************************************************************
+//*****************************************************************************
+// static
+void XBridgePacketPool::deallocate(void * ptr, const std::size_t size)
+{
+    if (!ptr)
+    {
+        return;
+    }
+
+    switch (sizeClass(size))
+    {
+        case 0:  XBridgeBufferPool<64>::free(ptr);   break;
+        case 1:  XBridgeBufferPool<128>::free(ptr);  break;
+        case 2:  XBridgeBufferPool<256>::free(ptr);  break;
+        case 3:  XBridgeBufferPool<512>::free(ptr);  break;
+        case 4:  XBridgeBufferPool<1024>::free(ptr); break;
+        case 5:  XBridgeBufferPool<2048>::free(ptr); break;
+        case 6:  XBridgeBufferPool<4096>::free(ptr); break;
+        case 7:  XBridgeBufferPool<8192>::free(ptr); break;
+        default: ::operator delete(ptr);             break;
+    }
+}
+
+//*****************************************************************************
+//*****************************************************************************
+// static
+void * XBridgePacketPool::allocatePacket(const std::size_t size)
+{
+    if (size != sizeof(XBridgePacket))
+    {
+        return ::operator new(size);
+    }
+    return XBridgeBufferPool<sizeof(XBridgePacket)>::malloc();
+}
+
+//*****************************************************************************
+//*****************************************************************************
+// static
+void XBridgePacketPool::deallocatePacket(void * ptr, const std::size_t size)
+{
+    if (!ptr)
+    {
+        return;
+    }
+
+    if (size != sizeof(XBridgePacket))
+    {
+        ::operator delete(ptr);
+        return;
+    }
+    XBridgeBufferPool<sizeof(XBridgePacket)>::free(ptr);
+}
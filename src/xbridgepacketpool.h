@@ -0,0 +1,107 @@
+//*****************************************************************************
+//*****************************************************************************
+
+#ifndef XBRIDGEPACKETPOOL_H
+#define XBRIDGEPACKETPOOL_H
+
+#include <cstddef>
+#include <limits>
+#include <new>
+
+//*****************************************************************************
+// pool of packet buffers, bucketed by size class
+//
+// size classes are powers of two from minClassSize to maxClassSize,
+// each class is served by own boost::singleton_pool (thread safe),
+// bigger buffers allocated from heap
+//*****************************************************************************
+class XBridgePacketPool
+{
+public:
+    enum
+    {
+        minClassSize = 64,
+        maxClassSize = 8192,
+        classCount   = 8
+    };
+
+    // index of size class for buffer of size bytes,
+    // classCount if size is bigger than maxClassSize
+    static std::size_t sizeClass(const std::size_t size);
+
+    static void * allocate(const std::size_t size);
+    static void   deallocate(void * ptr, const std::size_t size);
+
+    // pool for packet objects
+    static void * allocatePacket(const std::size_t size);
+    static void   deallocatePacket(void * ptr, const std::size_t size);
+};
+
+//*****************************************************************************
+// std allocator over XBridgePacketPool, used for packet body
+//*****************************************************************************
+template <typename T>
+class XBridgePacketAllocator
+{
+public:
+    typedef T                 value_type;
+    typedef T *               pointer;
+    typedef const T *         const_pointer;
+    typedef T &               reference;
+    typedef const T &         const_reference;
+    typedef std::size_t       size_type;
+    typedef std::ptrdiff_t    difference_type;
+
+    template <typename U>
+    struct rebind
+    {
+        typedef XBridgePacketAllocator<U> other;
+    };
+
+    XBridgePacketAllocator() {}
+    XBridgePacketAllocator(const XBridgePacketAllocator &) {}
+    template <typename U>
+    XBridgePacketAllocator(const XBridgePacketAllocator<U> &) {}
+
+    pointer       address(reference x) const       { return &x; }
+    const_pointer address(const_reference x) const { return &x; }
+
+    pointer allocate(const size_type n, const void * = 0)
+    {
+        return static_cast<pointer>(XBridgePacketPool::allocate(n * sizeof(T)));
+    }
+
+    void deallocate(pointer p, const size_type n)
+    {
+        XBridgePacketPool::deallocate(p, n * sizeof(T));
+    }
+
+    size_type max_size() const
+    {
+        return std::numeric_limits<size_type>::max() / sizeof(T);
+    }
+
+    void construct(pointer p, const T & v) { new (static_cast<void *>(p)) T(v); }
+    void destroy(pointer p)                { p->~T(); }
+
+    template <typename U, typename V>
+    void construct(U * p, const V & v)     { new (static_cast<void *>(p)) U(v); }
+    template <typename U>
+    void construct(U * p)                  { new (static_cast<void *>(p)) U(); }
+    template <typename U>
+    void destroy(U * p)                    { p->~U(); }
+};
+
+template <typename T, typename U>
+inline bool operator == (const XBridgePacketAllocator<T> &, const XBridgePacketAllocator<U> &)
+{
+    return true;
+}
+
+template <typename T, typename U>
+inline bool operator != (const XBridgePacketAllocator<T> &, const XBridgePacketAllocator<U> &)
+{
+    return false;
+}
+
+#endif // XBRIDGEPACKETPOOL_H
@@ -3,6 +3,10 @@
 
 // #include <boost/asio.hpp>
 // #include <boost/asio/buffer.hpp>
+#include <algorithm>
+#include <fstream>
+#include <cstdio>
+
 #include <boost/algorithm/string.hpp>
 
 #include "xbridgesession.h"
@@ -10,6 +14,7 @@
 #include "xbridgeexchange.h"
 #include "uiconnector.h"
 #include "util/util.h"
+#include "util/settings.h"
 #include "util/logger.h"
 #include "dht/dht.h"
 #include "bitcoinrpc.h"
@@ -42,6 +47,35 @@ struct PrintErrorCode
 // std::string txToString(const CTransaction & tx);
 // CTransaction txFromString(const std::string & str);
 
+//*****************************************************************************
+// pending order from xbcTransaction record
+//*****************************************************************************
+template <typename LAYOUT>
+XBridgeTransactionDescr pendingTransactionDescr(const XBridgePacketView<LAYOUT> & view)
+{
+    XBridgeTransactionDescr d;
+    d.id           = view.template hash<typename LAYOUT::Id>();
+    d.fromCurrency = view.template string<typename LAYOUT::SourceCurrency>();
+    d.fromAmount   = view.template uint64<typename LAYOUT::SourceAmount>();
+    d.toCurrency   = view.template string<typename LAYOUT::DestCurrency>();
+    d.toAmount     = view.template uint64<typename LAYOUT::DestAmount>();
+    d.state        = XBridgeTransactionDescr::trPending;
+    return d;
+}
+
+//*****************************************************************************
+// signed part of hub capability record, fixed fields before
+// signature and wallet list
+//*****************************************************************************
+uint256 capabilityHash(const XBridgePacketView<XBridgeLayoutExchangeWallets> & view)
+{
+    typedef XBridgeLayoutExchangeWallets L;
+
+    XBridgeSpan tail = view.tail();
+    return util::hash(view.ptr<L::HubAddress>(), view.ptr<L::Signature>(),
+                      tail.begin(), tail.end());
+}
+
 //*****************************************************************************
 //*****************************************************************************
 XBridgeSession::XBridgeSession()
@@ -65,8 +99,15 @@ XBridgeSession::XBridgeSession(const std::string & currency,
     , m_passwd(passwd)
     , m_prefix(prefix)
     , m_COIN(COIN)
+    , m_addressPool(new XBridgeAddressPool(user, passwd, address, port))
 {
     init();
+
+    // stored by last confirmation check
+    loadCursor();
+
+    // filled before first swap
+    m_addressPool->refill();
 }
 
 //*****************************************************************************
@@ -80,9 +121,17 @@ void XBridgeSession::init()
 
     m_processors[xbcAnnounceAddresses]     .bind(this, &XBridgeSession::processAnnounceAddresses);
 
+    // hubs and owners of currency pairs
+    m_processors[xbcExchangeWallets]       .bind(this, &XBridgeSession::processExchangeWallets);
+
     // process transaction from client wallet
     m_processors[xbcTransaction]           .bind(this, &XBridgeSession::processTransaction);
-    m_processors[xbcPendingTransaction]    .bind(this, &XBridgeSession::processPendingTransaction);
+
+    // order book sync
+    m_processors[xbcOrderBookDelta]        .bind(this, &XBridgeSession::processOrderBookDelta);
+    m_processors[xbcOrderBookDigest]       .bind(this, &XBridgeSession::processOrderBookDigest);
+    m_processors[xbcOrderBookRequest]      .bind(this, &XBridgeSession::processOrderBookRequest);
+    m_processors[xbcOrderBookSnapshot]     .bind(this, &XBridgeSession::processOrderBookSnapshot);
 
     // transaction processing
     {
@@ -250,7 +299,12 @@ void XBridgeSession::onReadBody(XBridgePacketPtr packet,
         return;
     }
 
-    if (!processPacket(packet))
+    if (!checkXBridgePacketCrc(packet))
+    {
+        ERR() << "incorrect packet crc, command " << packet->command()
+              << ", packet skipped " << __FUNCTION__;
+    }
+    else if (!processPacket(packet))
     {
         ERR() << "packet processing error " << __FUNCTION__;
     }
@@ -290,7 +344,7 @@ void XBridgeSession::sendPacket(const std::vector<unsigned char> & to,
                                 XBridgePacketPtr packet)
 {
     XBridgeApp & app = XBridgeApp::instance();
-    app.onSend(to, packet->body());
+    app.onSend(to, packet);
 }
 
 //*****************************************************************************
@@ -337,6 +391,14 @@ bool XBridgeSession::processPacket(XBridgePacketPtr packet)
         return false;
     }
 
+    // payload checked here once, processors read fields without checks
+    if (!checkXBridgePacketLayout(*packet))
+    {
+        ERR() << "incorrect packet size <" << packet->size()
+              << "> for command <" << c << "> " << __FUNCTION__;
+        return false;
+    }
+
     if (!m_processors[c](packet))
     {
         ERR() << "packet processing error <" << c << "> " << __FUNCTION__;
@@ -368,15 +430,10 @@ bool XBridgeSession::processAnnounceAddresses(XBridgePacketPtr packet)
 {
     // DEBUG_TRACE();
 
-    // size must be 20 bytes (160bit)
-    if (packet->size() != 20)
-    {
-        ERR() << "invalid packet size for xbcAnnounceAddresses " << __FUNCTION__;
-        return false;
-    }
+    XBridgePacketView<XBridgeLayoutAnnounceAddresses> view(packet);
 
     XBridgeApp & app = XBridgeApp::instance();
-    app.storageStore(shared_from_this(), packet->data());
+    app.storageStore(shared_from_this(), view.ptr<XBridgeLayoutAnnounceAddresses::Address>());
     return true;
 }
 
@@ -393,10 +450,20 @@ bool XBridgeSession::checkXBridgePacketVersion(XBridgePacketPtr packet)
     return true;
 }
 
+//*****************************************************************************
+//*****************************************************************************
+// static
+bool XBridgeSession::checkXBridgePacketCrc(XBridgePacketPtr packet)
+{
+    return packet->isCrcValid();
+}
+
 //*****************************************************************************
 //*****************************************************************************
 bool XBridgeSession::sendXBridgeMessage(XBridgePacketPtr packet)
 {
+    packet->finalize();
+
     boost::system::error_code error;
     m_socket->send(boost::asio::buffer(packet->header(), packet->allSize()), 0, error);
     if (error)
@@ -416,7 +483,11 @@ bool XBridgeSession::sendXBridgeMessage(const std::vector<unsigned char> & messa
 
     XBridgePacketPtr packet(new XBridgePacket());
     // packet->setData(message);
-    packet->copyFrom(message);
+    if (!packet->copyFrom(message))
+    {
+        ERR() << "incorrect packet size " << message.size() << " " << __FUNCTION__;
+        return false;
+    }
 
     // return sendXBridgeMessage(packet);
     return processPacket(packet);
@@ -429,15 +500,9 @@ bool XBridgeSession::processXChatMessage(XBridgePacketPtr packet)
 {
     DEBUG_TRACE();
 
-    // size must be > 20 bytes (160bit)
-    if (packet->size() <= 20)
-    {
-        ERR() << "invalid packet size for xbcXChatMessage " << __FUNCTION__;
-        return false;
-    }
-
     // read dest address
-    std::vector<unsigned char> daddr(packet->data(), packet->data() + 20);
+    XBridgePacketView<XBridgeLayoutXChatMessage> view(packet);
+    std::vector<unsigned char> daddr = view.span<XBridgeLayoutXChatMessage::DestAddress>().vector();
 
     XBridgeApp & app = XBridgeApp::instance();
     app.onSend(daddr, std::vector<unsigned char>(packet->header(), packet->header()+packet->allSize()));
@@ -465,101 +530,166 @@ bool XBridgeSession::processTransaction(XBridgePacketPtr packet)
     // DEBUG_TRACE();
     DEBUG_TRACE_LOG(currencyToLog());
 
-    // size must be 104 bytes
-    if (packet->size() != 104)
-    {
-        ERR() << "invalid packet size for xbcTransaction " << __FUNCTION__;
-        return false;
-    }
-
-    // source
-    std::vector<unsigned char> saddr(packet->data()+32, packet->data()+52);
-    std::string scurrency((const char *)packet->data()+52);
-    boost::uint64_t samount = *static_cast<boost::uint64_t *>(static_cast<void *>(packet->data()+60));
-
-    // destination
-    std::vector<unsigned char> daddr(packet->data()+68, packet->data()+88);
-    std::string dcurrency((const char *)packet->data()+88);
-    boost::uint64_t damount = *static_cast<boost::uint64_t *>(static_cast<void *>(packet->data()+96));
+    typedef XBridgeLayoutTransaction L;
+    XBridgeRecordsView<L> records(packet);
 
     {
-        XBridgeTransactionDescr d;
-        d.id           = uint256(packet->data());
-        d.fromCurrency = scurrency;
-        d.fromAmount   = samount;
-        d.toCurrency   = dcurrency;
-        d.toAmount     = damount;
-        d.state        = XBridgeTransactionDescr::trPending;
+        std::vector<XBridgeTransactionDescr> list;
+        list.reserve(records.count());
+        for (std::size_t i = 0; i < records.count(); ++i)
+        {
+            list.push_back(pendingTransactionDescr(records[i]));
+        }
 
-        uiConnector.NotifyXBridgePendingTransactionReceived(d);
+        uiConnector.NotifyXBridgePendingTransactionsReceived(list);
     }
 
     // check and process packet if bridge is exchange
+    bool retranslate = true;
     XBridgeExchange & e = XBridgeExchange::instance();
     if (e.isEnabled())
     {
-        // read packet data
-        uint256 id(packet->data());
-
-        LOG() << "received transaction " << util::base64_encode(std::string((char *)id.begin(), 32)) << std::endl
-              << "    from " << util::base64_encode(std::string((char *)&saddr[0], 20)) << std::endl
-              << "             " << scurrency << " : " << samount << std::endl
-              << "    to   " << util::base64_encode(std::string((char *)&daddr[0], 20)) << std::endl
-              << "             " << dcurrency << " : " << damount << std::endl;
-
-        if (!e.haveConnectedWallet(scurrency) || !e.haveConnectedWallet(dcurrency))
+        retranslate = false;
+        for (std::size_t i = 0; i < records.count(); ++i)
         {
-            LOG() << "no active wallet for transaction "
-                  << util::base64_encode(std::string((char *)id.begin(), 32));
+            if (!processTransactionRecord(records[i]))
+            {
+                retranslate = true;
+            }
         }
-        else
+    }
+
+    // ..and retranslate if not all orders are for this hub,
+    // orders of own book published by order book deltas
+    if (retranslate)
+    {
+        sendPacketBroadcast(packet);
+    }
+    return true;
+}
+
+//******************************************************************************
+// one order of xbcTransaction, exchange only,
+// false if order not for this hub
+//******************************************************************************
+bool XBridgeSession::processTransactionRecord(const XBridgePacketView<XBridgeLayoutTransaction> & view)
+{
+    typedef XBridgeLayoutTransaction L;
+
+    XBridgeExchange & e = XBridgeExchange::instance();
+
+    // source
+    std::string scurrency   = view.string<L::SourceCurrency>();
+    boost::uint64_t samount = view.uint64<L::SourceAmount>();
+
+    // destination
+    std::string dcurrency   = view.string<L::DestCurrency>();
+    boost::uint64_t damount = view.uint64<L::DestAmount>();
+
+    // read packet data
+    uint256 id = view.hash<L::Id>();
+    std::vector<unsigned char> saddr = view.span<L::SourceAddress>().vector();
+    std::vector<unsigned char> daddr = view.span<L::DestAddress>().vector();
+
+    LOG() << "received transaction " << util::base64_encode(std::string((char *)id.begin(), 32)) << std::endl
+          << "    from " << util::base64_encode(std::string((char *)&saddr[0], 20)) << std::endl
+          << "             " << scurrency << " : " << samount << std::endl
+          << "    to   " << util::base64_encode(std::string((char *)&daddr[0], 20)) << std::endl
+          << "             " << dcurrency << " : " << damount << std::endl;
+
+    if (!e.haveConnectedWallet(scurrency) || !e.haveConnectedWallet(dcurrency))
+    {
+        LOG() << "no active wallet for transaction "
+              << util::base64_encode(std::string((char *)id.begin(), 32));
+        return false;
+    }
+    else if (e.isHubRingEnabled() &&
+             !XBridgeApp::instance().hubRing().isOwner(std::vector<unsigned char>(myaddr(), myaddr()+20),
+                                                       scurrency, dcurrency))
+    {
+        // matched by other hub
+        LOG() << "pair " << scurrency << "/" << dcurrency << " owned by other hub, transaction "
+              << util::base64_encode(std::string((char *)id.begin(), 32));
+        return false;
+    }
+    else
+    {
+        // float rate = (float) destAmount / sourceAmount;
+        std::vector<XBridgeFill> fills;
+        bool dropped = false;
+        if (e.createTransaction(id, saddr, scurrency, samount, daddr, dcurrency, damount, fills, dropped))
         {
-            // float rate = (float) destAmount / sourceAmount;
-            uint256 transactionId;
-            if (e.createTransaction(id, saddr, scurrency, samount, daddr, dcurrency, damount, transactionId))
+            // each fill is joined transaction, send hold to clients
+            for (std::vector<XBridgeFill>::const_iterator i = fills.begin(); i != fills.end(); ++i)
             {
-                // check transaction state, if trNew - do nothing,
-                // if trJoined = send hold to client
-                XBridgeTransactionPtr tr = e.transaction(transactionId);
-
-                boost::mutex::scoped_lock l(tr->m_lock);
+                if (i->transactionId == uint256())
+                {
+                    // not joined
+                    continue;
+                }
 
-                if (tr && tr->state() == XBridgeTransaction::trJoined)
+                XBridgeTransactionPtr tr = e.transaction(i->transactionId);
+                if (!tr)
                 {
-                    // send hold to clients
+                    continue;
+                }
 
-                    // first
-                    // TODO remove this log
-                    LOG() << "send xbcTransactionHold to "
-                          << util::base64_encode(std::string((char *)&tr->firstAddress()[0], 20));
+                boost::mutex::scoped_lock l(tr->m_lock);
 
-                    XBridgePacketPtr reply1(new XBridgePacket(xbcTransactionHold));
-                    reply1->append(tr->firstAddress());
-                    reply1->append(myaddr(), 20);
-                    reply1->append(tr->firstId().begin(), 32);
-                    reply1->append(transactionId.begin(), 32);
+                if (tr->state() != XBridgeTransaction::trJoined)
+                {
+                    continue;
+                }
 
-                    sendPacket(tr->firstAddress(), reply1);
+                // first - resting order
+                // TODO remove this log
+                LOG() << "send xbcTransactionHold to "
+                      << util::base64_encode(std::string((char *)&tr->firstAddress()[0], 20));
+
+                XBridgePacketWriter<XBridgeLayoutTransactionHold> reply1(xbcTransactionHold);
+                reply1.set<XBridgeLayoutTransactionHold::ClientAddress>(tr->firstAddress())
+                      .set<XBridgeLayoutTransactionHold::HubAddress>(myaddr())
+                      .set<XBridgeLayoutTransactionHold::ClientTxId>(tr->firstId())
+                      .set<XBridgeLayoutTransactionHold::HubTxId>(i->transactionId)
+                      .set<XBridgeLayoutTransactionHold::RestSourceAmount>(i->restingRest.fromAmount)
+                      .set<XBridgeLayoutTransactionHold::RestDestAmount>(i->restingRest.toAmount)
+                      .set<XBridgeLayoutTransactionHold::FillSourceAmount>(i->sourceAmount)
+                      .set<XBridgeLayoutTransactionHold::FillDestAmount>(i->destAmount);
+
+                sendPacket(tr->firstAddress(), reply1.packet());
+
+                // second - incoming order
+                // TODO remove this log
+                LOG() << "send xbcTransactionHold to "
+                      << util::base64_encode(std::string((char *)&tr->secondAddress()[0], 20));
+
+                XBridgePacketWriter<XBridgeLayoutTransactionHold> reply2(xbcTransactionHold);
+                reply2.set<XBridgeLayoutTransactionHold::ClientAddress>(tr->secondAddress())
+                      .set<XBridgeLayoutTransactionHold::HubAddress>(myaddr())
+                      .set<XBridgeLayoutTransactionHold::ClientTxId>(tr->secondId())
+                      .set<XBridgeLayoutTransactionHold::HubTxId>(i->transactionId)
+                      .set<XBridgeLayoutTransactionHold::RestSourceAmount>(i->incomingRest.fromAmount)
+                      .set<XBridgeLayoutTransactionHold::RestDestAmount>(i->incomingRest.toAmount)
+                      .set<XBridgeLayoutTransactionHold::FillSourceAmount>(i->destAmount)
+                      .set<XBridgeLayoutTransactionHold::FillDestAmount>(i->sourceAmount);
+
+                sendPacket(tr->secondAddress(), reply2.packet());
+            }
 
-                    // second
-                    // TODO remove this log
-                    LOG() << "send xbcTransactionHold to "
-                          << util::base64_encode(std::string((char *)&tr->secondAddress()[0], 20));
+            if (dropped)
+            {
+                // rest of order not in book, client stops resending it
+                LOG() << "dust rest of transaction "
+                      << util::base64_encode(std::string((char *)id.begin(), 32)) << " cancelled";
 
-                    XBridgePacketPtr reply2(new XBridgePacket(xbcTransactionHold));
-                    reply2->append(tr->secondAddress());
-                    reply2->append(myaddr(), 20);
-                    reply2->append(tr->secondId().begin(), 32);
-                    reply2->append(transactionId.begin(), 32);
+                XBridgePacketWriter<XBridgeLayoutTxId> cancel(xbcTransactionCancel);
+                cancel.set<XBridgeLayoutTxId::Id>(id);
 
-                    sendPacket(tr->secondAddress(), reply2);
-                }
+                sendPacket(saddr, cancel.packet());
             }
         }
     }
 
-    // ..and retranslate
-    sendPacketBroadcast(packet);
     return true;
 }
 
@@ -569,22 +699,23 @@ bool XBridgeSession::processTransactionHold(XBridgePacketPtr packet)
 {
     DEBUG_TRACE_LOG(currencyToLog());
 
-    if (packet->size() != 104)
-    {
-        ERR() << "incorrect packet size for xbcTransactionHold " << __FUNCTION__;
-        return false;
-    }
+    typedef XBridgeLayoutTransactionHold L;
+    XBridgePacketView<L> view(packet);
 
-    // this addr
-    std::vector<unsigned char> thisAddress(packet->data(), packet->data()+20);
+    // read packet data
+    uint256 id    = view.hash<L::ClientTxId>();
+    uint256 newid = view.hash<L::HubTxId>();
 
-    // smart hub addr
-    std::vector<unsigned char> hubAddress(packet->data()+20, packet->data()+40);
+    // rest of order after partial fill
+    boost::uint64_t restSource = view.uint64<L::RestSourceAmount>();
+    boost::uint64_t restDest   = view.uint64<L::RestDestAmount>();
 
-    // read packet data
-    uint256 id   (packet->data()+40);
-    uint256 newid(packet->data()+72);
+    // amounts of this swap, may differ from order with price improvement
+    boost::uint64_t fillSource = view.uint64<L::FillSourceAmount>();
+    boost::uint64_t fillDest   = view.uint64<L::FillDestAmount>();
 
+    // filled part and rest of order for gui, partial fill only
+    std::vector<XBridgeTransactionDescr> changed;
     {
         boost::mutex::scoped_lock l(XBridgeApp::m_txLocker);
 
@@ -595,26 +726,60 @@ bool XBridgeSession::processTransactionHold(XBridgePacketPtr packet)
             return false;
         }
 
-        // remove from pending
         XBridgeTransactionDescrPtr xtx = XBridgeApp::m_pendingTransactions[id];
-        XBridgeApp::m_pendingTransactions.erase(id);
 
-        // move to processing
-        XBridgeApp::m_transactions[newid] = xtx;
+        if (restSource && restDest)
+        {
+            // partial fill, filled part moved to processing,
+            // rest of order stays pending
+            XBridgeTransactionDescrPtr part(new XBridgeTransactionDescr(*xtx));
+            part->id         = newid;
+            part->fromAmount = fillSource;
+            part->toAmount   = fillDest;
+            part->state      = XBridgeTransactionDescr::trHold;
+
+            XBridgeApp::m_transactions[newid] = part;
+
+            xtx->fromAmount = restSource;
+            xtx->toAmount   = restDest;
+
+            changed.push_back(*part);
+            changed.push_back(*xtx);
+        }
+        else
+        {
+            // remove from pending
+            XBridgeApp::m_pendingTransactions.erase(id);
+
+            // move to processing
+            XBridgeApp::m_transactions[newid] = xtx;
 
-        xtx->state = XBridgeTransactionDescr::trHold;
+            xtx->fromAmount = fillSource;
+            xtx->toAmount   = fillDest;
+            xtx->state      = XBridgeTransactionDescr::trHold;
+
+            restSource = 0;
+        }
     }
 
-    uiConnector.NotifyXBridgeTransactionIdChanged(id, newid);
-    uiConnector.NotifyXBridgeTransactionStateChanged(id, XBridgeTransactionDescr::trHold);
+    if (!restSource)
+    {
+        uiConnector.NotifyXBridgeTransactionIdChanged(id, newid);
+        uiConnector.NotifyXBridgeTransactionStateChanged(id, XBridgeTransactionDescr::trHold);
+    }
+    else
+    {
+        // new row of filled part, amounts of pending order reduced
+        uiConnector.NotifyXBridgePendingTransactionsReceived(changed);
+    }
 
     // send hold apply
-    XBridgePacketPtr reply(new XBridgePacket(xbcTransactionHoldApply));
-    reply->append(hubAddress);
-    reply->append(thisAddress);
-    reply->append(newid.begin(), 32);
+    XBridgePacketWriter<XBridgeLayoutClientReply> reply(xbcTransactionHoldApply);
+    reply.set<XBridgeLayoutClientReply::HubAddress>(view.span<L::HubAddress>())
+         .set<XBridgeLayoutClientReply::ClientAddress>(view.span<L::ClientAddress>())
+         .set<XBridgeLayoutClientReply::HubTxId>(newid);
 
-    if (!sendPacketBroadcast(reply))
+    if (!sendPacketBroadcast(reply.packet()))
     {
         LOG() << "error sending transaction hold reply packet " << __FUNCTION__;
         return false;
@@ -629,13 +794,6 @@ bool XBridgeSession::processTransactionHoldApply(XBridgePacketPtr packet)
     // DEBUG_TRACE();
     DEBUG_TRACE_LOG(currencyToLog());
 
-    // size must be eq 72 bytes
-    if (packet->size() != 72)
-    {
-        ERR() << "invalid packet size for xbcTransactionHoldApply " << __FUNCTION__;
-        return false;
-    }
-
     // check is for me
     if (relayPacket(packet))
     {
@@ -648,15 +806,22 @@ bool XBridgeSession::processTransactionHoldApply(XBridgePacketPtr packet)
         return true;
     }
 
-    std::vector<unsigned char> from(packet->data()+20, packet->data()+40);
+    XBridgePacketView<XBridgeLayoutClientReply> view(packet);
+
+    std::vector<unsigned char> from = view.span<XBridgeLayoutClientReply::ClientAddress>().vector();
 
     // transaction id
-    uint256 id(packet->data()+40);
+    uint256 id = view.hash<XBridgeLayoutClientReply::HubTxId>();
 
     XBridgeTransactionPtr tr = e.transaction(id);
+    if (!tr)
+    {
+        return true;
+    }
+
     boost::mutex::scoped_lock l(tr->m_lock);
 
-    tr->updateTimestamp();
+    e.updateTimestamp(tr);
 
     if (e.updateTransactionWhenHoldApplyReceived(tr, from))
     {
@@ -664,49 +829,41 @@ bool XBridgeSession::processTransactionHoldApply(XBridgePacketPtr packet)
         {
             // send initialize transaction command to clients
 
-            // field length must be 8 bytes
-            std::string firstCurrency = tr->firstCurrency();
-            std::vector<unsigned char> fc(8, 0);
-            std::copy(firstCurrency.begin(), firstCurrency.end(), fc.begin());
-            std::string secondCurrency = tr->secondCurrency();
-            std::vector<unsigned char> sc(8, 0);
-            std::copy(secondCurrency.begin(), secondCurrency.end(), sc.begin());
-
             // first
             // TODO remove this log
             LOG() << "send xbcTransactionInit to "
                   << util::base64_encode(std::string((char *)&tr->firstDestination()[0], 20));
 
-            XBridgePacketPtr reply1(new XBridgePacket(xbcTransactionInit));
-            reply1->append(tr->firstDestination());
-            reply1->append(myaddr(), 20);
-            reply1->append(id.begin(), 32);
-            reply1->append(tr->firstAddress());
-            reply1->append(fc);
-            reply1->append(tr->firstAmount());
-            reply1->append(tr->firstDestination());
-            reply1->append(sc);
-            reply1->append(tr->secondAmount());
+            XBridgePacketWriter<XBridgeLayoutTransactionInit> reply1(xbcTransactionInit);
+            reply1.set<XBridgeLayoutTransactionInit::ClientAddress>(tr->firstDestination())
+                  .set<XBridgeLayoutTransactionInit::HubAddress>(myaddr())
+                  .set<XBridgeLayoutTransactionInit::HubTxId>(id)
+                  .set<XBridgeLayoutTransactionInit::SourceAddress>(tr->firstAddress())
+                  .setString<XBridgeLayoutTransactionInit::SourceCurrency>(tr->firstCurrency())
+                  .set<XBridgeLayoutTransactionInit::SourceAmount>(tr->firstAmount())
+                  .set<XBridgeLayoutTransactionInit::DestAddress>(tr->firstDestination())
+                  .setString<XBridgeLayoutTransactionInit::DestCurrency>(tr->secondCurrency())
+                  .set<XBridgeLayoutTransactionInit::DestAmount>(tr->secondAmount());
 
-            sendPacket(tr->firstDestination(), reply1);
+            sendPacket(tr->firstDestination(), reply1.packet());
 
             // second
             // TODO remove this log
             LOG() << "send xbcTransactionInit to "
                   << util::base64_encode(std::string((char *)&tr->secondDestination()[0], 20));
 
-            XBridgePacketPtr reply2(new XBridgePacket(xbcTransactionInit));
-            reply2->append(tr->secondDestination());
-            reply2->append(myaddr(), 20);
-            reply2->append(id.begin(), 32);
-            reply2->append(tr->secondAddress());
-            reply2->append(sc);
-            reply2->append(tr->secondAmount());
-            reply2->append(tr->secondDestination());
-            reply2->append(fc);
-            reply2->append(tr->firstAmount());
-
-            sendPacket(tr->secondDestination(), reply2);
+            XBridgePacketWriter<XBridgeLayoutTransactionInit> reply2(xbcTransactionInit);
+            reply2.set<XBridgeLayoutTransactionInit::ClientAddress>(tr->secondDestination())
+                  .set<XBridgeLayoutTransactionInit::HubAddress>(myaddr())
+                  .set<XBridgeLayoutTransactionInit::HubTxId>(id)
+                  .set<XBridgeLayoutTransactionInit::SourceAddress>(tr->secondAddress())
+                  .setString<XBridgeLayoutTransactionInit::SourceCurrency>(tr->secondCurrency())
+                  .set<XBridgeLayoutTransactionInit::SourceAmount>(tr->secondAmount())
+                  .set<XBridgeLayoutTransactionInit::DestAddress>(tr->secondDestination())
+                  .setString<XBridgeLayoutTransactionInit::DestCurrency>(tr->firstCurrency())
+                  .set<XBridgeLayoutTransactionInit::DestAmount>(tr->firstAmount());
+
+            sendPacket(tr->secondDestination(), reply2.packet());
         }
     }
 
@@ -719,35 +876,21 @@ bool XBridgeSession::processTransactionInit(XBridgePacketPtr packet)
 {
     DEBUG_TRACE_LOG(currencyToLog());
 
-    if (packet->size() != 144)
-    {
-        ERR() << "incorrect packet size for xbcTransactionInit" << __FUNCTION__;
-        return false;
-    }
-
-    std::vector<unsigned char> thisAddress(packet->data(), packet->data()+20);
-    std::vector<unsigned char> hubAddress(packet->data()+20, packet->data()+40);
+    typedef XBridgeLayoutTransactionInit L;
+    XBridgePacketView<L> view(packet);
 
-    uint256 txid(packet->data()+40);
-
-    std::vector<unsigned char> from(packet->data()+72, packet->data()+92);
-    std::string                fromCurrency(reinterpret_cast<const char *>(packet->data()+92));
-    boost::uint64_t            fromAmount(*reinterpret_cast<boost::uint64_t *>(packet->data()+100));
-
-    std::vector<unsigned char> to(packet->data()+108, packet->data()+128);
-    std::string                toCurrency(reinterpret_cast<const char *>(packet->data()+128));
-    boost::uint64_t            toAmount(*reinterpret_cast<boost::uint64_t *>(packet->data()+136));
+    uint256 txid = view.hash<L::HubTxId>();
 
     // create transaction
     // without id (non this client transaction)
     XBridgeTransactionDescrPtr ptr(new XBridgeTransactionDescr);
     // ptr->id           = txid;
-    ptr->from         = from;
-    ptr->fromCurrency = fromCurrency;
-    ptr->fromAmount   = fromAmount;
-    ptr->to           = to;
-    ptr->toCurrency   = toCurrency;
-    ptr->toAmount     = toAmount;
+    ptr->from         = view.span<L::SourceAddress>().vector();
+    ptr->fromCurrency = view.string<L::SourceCurrency>();
+    ptr->fromAmount   = view.uint64<L::SourceAmount>();
+    ptr->to           = view.span<L::DestAddress>().vector();
+    ptr->toCurrency   = view.string<L::DestCurrency>();
+    ptr->toAmount     = view.uint64<L::DestAmount>();
 
     {
         boost::mutex::scoped_lock l(XBridgeApp::m_txLocker);
@@ -755,12 +898,12 @@ bool XBridgeSession::processTransactionInit(XBridgePacketPtr packet)
     }
 
     // send initialized
-    XBridgePacketPtr reply(new XBridgePacket(xbcTransactionInitialized));
-    reply->append(hubAddress);
-    reply->append(thisAddress);
-    reply->append(txid.begin(), 32);
+    XBridgePacketWriter<XBridgeLayoutClientReply> reply(xbcTransactionInitialized);
+    reply.set<XBridgeLayoutClientReply::HubAddress>(view.span<L::HubAddress>())
+         .set<XBridgeLayoutClientReply::ClientAddress>(view.span<L::ClientAddress>())
+         .set<XBridgeLayoutClientReply::HubTxId>(txid);
 
-    if (!sendPacketBroadcast(reply))
+    if (!sendPacketBroadcast(reply.packet()))
     {
         LOG() << "error sending transaction hold reply packet " << __FUNCTION__;
         return false;
@@ -776,13 +919,6 @@ bool XBridgeSession::processTransactionInitialized(XBridgePacketPtr packet)
     // DEBUG_TRACE();
     DEBUG_TRACE_LOG(currencyToLog());
 
-    // size must be eq 72 bytes
-    if (packet->size() != 72)
-    {
-        ERR() << "invalid packet size for xbcTransactionHoldApply " << __FUNCTION__;
-        return false;
-    }
-
     // check is for me
     if (relayPacket(packet))
     {
@@ -795,15 +931,22 @@ bool XBridgeSession::processTransactionInitialized(XBridgePacketPtr packet)
         return true;
     }
 
-    std::vector<unsigned char> from(packet->data()+20, packet->data()+40);
+    XBridgePacketView<XBridgeLayoutClientReply> view(packet);
+
+    std::vector<unsigned char> from = view.span<XBridgeLayoutClientReply::ClientAddress>().vector();
 
     // transaction id
-    uint256 id(packet->data()+40);
+    uint256 id = view.hash<XBridgeLayoutClientReply::HubTxId>();
 
     XBridgeTransactionPtr tr = e.transaction(id);
+    if (!tr)
+    {
+        return true;
+    }
+
     boost::mutex::scoped_lock l(tr->m_lock);
 
-    tr->updateTimestamp();
+    e.updateTimestamp(tr);
 
     if (e.updateTransactionWhenInitializedReceived(tr, from))
     {
@@ -819,30 +962,30 @@ bool XBridgeSession::processTransactionInitialized(XBridgePacketPtr packet)
             // send xbcTransactionCreate
             // with nLockTime == TTL*2 for first client,
             // with nLockTime == TTL*4 for second
-            XBridgePacketPtr reply1(new XBridgePacket(xbcTransactionCreate));
-            reply1->append(tr->firstAddress());
-            reply1->append(myaddr(), 20);
-            reply1->append(id.begin(), 32);
-            reply1->append(tr->secondDestination());
-            reply1->append((boost::uint32_t)(XBridgeTransaction::TTL * 2));
-            reply1->append((boost::uint32_t)24*60*60);
+            XBridgePacketWriter<XBridgeLayoutTransactionCreate> reply1(xbcTransactionCreate);
+            reply1.set<XBridgeLayoutTransactionCreate::ClientAddress>(tr->firstAddress())
+                  .set<XBridgeLayoutTransactionCreate::HubAddress>(myaddr())
+                  .set<XBridgeLayoutTransactionCreate::HubTxId>(id)
+                  .set<XBridgeLayoutTransactionCreate::DestAddress>(tr->secondDestination())
+                  .set<XBridgeLayoutTransactionCreate::LockTimeTx1>(static_cast<boost::uint32_t>(XBridgeTransaction::TTL * 2))
+                  .set<XBridgeLayoutTransactionCreate::LockTimeTx2>(static_cast<boost::uint32_t>(24*60*60));
 
-            sendPacket(tr->firstAddress(), reply1);
+            sendPacket(tr->firstAddress(), reply1.packet());
 
             // second
             // TODO remove this log
             LOG() << "send xbcTransactionCreate to "
                   << util::base64_encode(std::string((char *)&tr->secondAddress()[0], 20));
 
-            XBridgePacketPtr reply2(new XBridgePacket(xbcTransactionCreate));
-            reply2->append(tr->secondAddress());
-            reply2->append(myaddr(), 20);
-            reply2->append(id.begin(), 32);
-            reply2->append(tr->firstDestination());
-            reply2->append((boost::uint32_t)(XBridgeTransaction::TTL * 4));
-            reply2->append((boost::uint32_t)48*60*60);
+            XBridgePacketWriter<XBridgeLayoutTransactionCreate> reply2(xbcTransactionCreate);
+            reply2.set<XBridgeLayoutTransactionCreate::ClientAddress>(tr->secondAddress())
+                  .set<XBridgeLayoutTransactionCreate::HubAddress>(myaddr())
+                  .set<XBridgeLayoutTransactionCreate::HubTxId>(id)
+                  .set<XBridgeLayoutTransactionCreate::DestAddress>(tr->firstDestination())
+                  .set<XBridgeLayoutTransactionCreate::LockTimeTx1>(static_cast<boost::uint32_t>(XBridgeTransaction::TTL * 4))
+                  .set<XBridgeLayoutTransactionCreate::LockTimeTx2>(static_cast<boost::uint32_t>(48*60*60));
 
-            sendPacket(tr->secondAddress(), reply2);
+            sendPacket(tr->secondAddress(), reply2.packet());
         }
     }
 
@@ -876,21 +1019,79 @@ CScript destination(const std::string & address)
 }
 
 //******************************************************************************
+// transactions in xbridge packets are serialized binary,
+// hex strings used only for wallet rpc
 //******************************************************************************
-std::string txToStringBTC(const CBTCTransaction & tx)
+std::vector<unsigned char> txToBytesBTC(const CBTCTransaction & tx)
 {
     CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
     ss << tx;
-    return HexStr(ss.begin(), ss.end());
+    return std::vector<unsigned char>(ss.begin(), ss.end());
 }
 
 //******************************************************************************
 //******************************************************************************
-std::string txToString(const CTransaction & tx)
+std::vector<unsigned char> txToBytes(const CTransaction & tx)
 {
     CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
     ss << tx;
-    return HexStr(ss.begin(), ss.end());
+    return std::vector<unsigned char>(ss.begin(), ss.end());
+}
+
+//******************************************************************************
+//******************************************************************************
+CBTCTransaction txFromBytesBTC(const XBridgeSpan & data)
+{
+    CBTCTransaction tx;
+
+    try
+    {
+        CDataStream stream(reinterpret_cast<const char *>(data.begin()),
+                           reinterpret_cast<const char *>(data.end()),
+                           SER_NETWORK, PROTOCOL_VERSION);
+        stream >> tx;
+    }
+    catch (std::exception & e)
+    {
+        LOG() << "exception " << e.what() << " in " << __FUNCTION__;
+    }
+    catch (...)
+    {
+        LOG() << "unknown exception in " << __FUNCTION__;
+    }
+
+    return tx;
+}
+
+//******************************************************************************
+//******************************************************************************
+CTransaction txFromBytes(const XBridgeSpan & data)
+{
+    CTransaction tx;
+    try
+    {
+        CDataStream stream(reinterpret_cast<const char *>(data.begin()),
+                           reinterpret_cast<const char *>(data.end()),
+                           SER_NETWORK, PROTOCOL_VERSION);
+        stream >> tx;
+    }
+    catch (std::exception & e)
+    {
+        LOG() << "exception " << e.what() << " in " << __FUNCTION__;
+    }
+    catch (...)
+    {
+        LOG() << "unknown exception in " << __FUNCTION__;
+    }
+    return tx;
+}
+
+//******************************************************************************
+//******************************************************************************
+std::vector<unsigned char> txBytesFromHex(const std::string & str)
+{
+    std::vector<char> data = ParseHex(str);
+    return std::vector<unsigned char>(data.begin(), data.end());
 }
 
 //******************************************************************************
@@ -942,29 +1143,68 @@ CTransaction txFromString(const std::string & str)
 }
 
 //******************************************************************************
+// false if wallet has not enough unreserved outputs
 //******************************************************************************
-bool XBridgeSession::processTransactionCreate(XBridgePacketPtr packet)
+bool XBridgeSession::reserveUnspent(const uint256 & id,
+                                    const boost::uint64_t amount,
+                                    const boost::uint64_t changeCost,
+                                    std::vector<rpc::Unspent> & outputs,
+                                    boost::uint64_t & reserved)
 {
-    DEBUG_TRACE_LOG(currencyToLog());
+    XBridgeUtxoCache & cache = XBridgeApp::instance().utxoCache();
+
+    if (!cache.isReady(m_currency))
+    {
+        // first swap before first refresh
+        std::vector<rpc::Unspent> entries;
+        if (!rpc::listUnspent(m_user, m_passwd, m_address, m_port, entries))
+        {
+            LOG() << "rpc::listUnspent failed" << __FUNCTION__;
+            return false;
+        }
+
+        cache.update(m_currency, entries);
+    }
+
+    return cache.reserve(m_currency, id, amount, changeCost, m_COIN, outputs, reserved);
+}
+
+//******************************************************************************
+// address from pool, wallet asked only if pool empty
+//******************************************************************************
+bool XBridgeSession::newAddress(std::string & addr)
+{
+    if (m_addressPool && m_addressPool->take(addr))
+    {
+        return true;
+    }
 
-    if (packet->size() != 100)
+    if (!rpc::getNewAddress(m_user, m_passwd, m_address, m_port, addr))
     {
-        ERR() << "incorrect packet size for xbcTransactionCreate" << __FUNCTION__;
+        LOG() << "rpc::getNewAddress failed" << __FUNCTION__;
         return false;
     }
+    return true;
+}
+
+//******************************************************************************
+//******************************************************************************
+bool XBridgeSession::processTransactionCreate(XBridgePacketPtr packet)
+{
+    DEBUG_TRACE_LOG(currencyToLog());
 
-    std::vector<unsigned char> thisAddress(packet->data(), packet->data()+20);
-    std::vector<unsigned char> hubAddress(packet->data()+20, packet->data()+40);
+    typedef XBridgeLayoutTransactionCreate L;
+    XBridgePacketView<L> view(packet);
 
     // transaction id
-    uint256 id   (packet->data()+40);
+    uint256 id = view.hash<L::HubTxId>();
 
     // destination address
-    std::vector<unsigned char> destAddress(packet->data()+72, packet->data()+92);
+    std::vector<unsigned char> destAddress = view.span<L::DestAddress>().vector();
 
     // lock time
-    boost::uint32_t lockTimeTx1 = *reinterpret_cast<boost::uint32_t *>(packet->data()+92);
-    boost::uint32_t lockTimeTx2 = *reinterpret_cast<boost::uint32_t *>(packet->data()+96);
+    boost::uint32_t lockTimeTx1 = view.uint32<L::LockTimeTx1>();
+    boost::uint32_t lockTimeTx2 = view.uint32<L::LockTimeTx2>();
 
     XBridgeTransactionDescrPtr xtx;
     {
@@ -981,38 +1221,23 @@ bool XBridgeSession::processTransactionCreate(XBridgePacketPtr packet)
     }
 
 
-    std::vector<rpc::Unspent> entries;
-    if (!rpc::listUnspent(m_user, m_passwd, m_address, m_port, entries))
-    {
-        LOG() << "rpc::listUnspent failed" << __FUNCTION__;
-        return false;
-    }
-
     boost::uint64_t fee = m_COIN*XBridgeTransactionDescr::MIN_TX_FEE/XBridgeTransactionDescr::COIN;
     boost::uint64_t outAmount = m_COIN*(static_cast<double>(xtx->fromAmount)/XBridgeTransactionDescr::COIN)+fee;
     boost::uint64_t inAmount  = 0;
 
+    // inputs reserved for this swap, released on cancel.
+    // change output costs about a fee, smaller excess left to fee
     std::vector<rpc::Unspent> usedInTx;
-    for (const rpc::Unspent & entry : entries)
-    {
-        usedInTx.push_back(entry);
-        inAmount += entry.amount*m_COIN;
-
-        // check amount
-        if (inAmount >= outAmount)
-        {
-            break;
-        }
-    }
-
-    // check amount
-    if (inAmount < outAmount)
+    if (!reserveUnspent(id, outAmount, fee, usedInTx, inAmount))
     {
         // no money, cancel transaction
         sendCancelTransaction(id);
         return false;
     }
 
+    // change output only if excess above fee
+    bool withChange = inAmount - outAmount > fee;
+
     // create tx1, locked
     CTransaction tx1;
 
@@ -1032,10 +1257,10 @@ bool XBridgeSession::processTransactionCreate(XBridgePacketPtr packet)
     // outputs
     tx1.vout.push_back(CTxOut(outAmount-fee, destination(destAddress, m_prefix[0])));
 
-    if (inAmount > outAmount)
+    if (withChange)
     {
         std::string addr;
-        if (!rpc::getNewAddress(m_user, m_passwd, m_address, m_port, addr))
+        if (!newAddress(addr))
         {
             // cancel transaction
             sendCancelTransaction(id);
@@ -1048,8 +1273,8 @@ bool XBridgeSession::processTransactionCreate(XBridgePacketPtr packet)
     }
 
     // serialize
-    std::string unsignedTx1 = txToString(tx1);
-    std::string signedTx1 = unsignedTx1;
+    std::vector<unsigned char> unsignedTx1 = txToBytes(tx1);
+    std::string signedTx1 = HexStr(unsignedTx1);
 
     if (!rpc::signRawTransaction(m_user, m_passwd, m_address, m_port, signedTx1))
     {
@@ -1064,7 +1289,7 @@ bool XBridgeSession::processTransactionCreate(XBridgePacketPtr packet)
     LOG() << signedTx1;
 
     xtx->payTxId = tx1.GetHash();
-    xtx->payTx   = signedTx1;
+    xtx->payTx   = txBytesFromHex(signedTx1);
 
     // create tx2, inputs
     CTransaction tx2;
@@ -1074,7 +1299,7 @@ bool XBridgeSession::processTransactionCreate(XBridgePacketPtr packet)
     // outputs
     {
         std::string addr;
-        if (!rpc::getNewAddress(m_user, m_passwd, m_address, m_port, addr))
+        if (!newAddress(addr))
         {
             // cancel transaction
             sendCancelTransaction(id);
@@ -1093,9 +1318,9 @@ bool XBridgeSession::processTransactionCreate(XBridgePacketPtr packet)
     }
 
     // serialize
-    std::string unsignedTx2 = txToString(tx2);
+    std::vector<unsigned char> unsignedTx2 = txToBytes(tx2);
     LOG() << "revert tx (unsigned) " << tx2.GetHash().GetHex();
-    LOG() << unsignedTx2;
+    LOG() << HexStr(unsignedTx2);
 
     // store
     xtx->revTx = unsignedTx2;
@@ -1104,14 +1329,16 @@ bool XBridgeSession::processTransactionCreate(XBridgePacketPtr packet)
     uiConnector.NotifyXBridgeTransactionStateChanged(id, xtx->state);
 
     // send reply
-    XBridgePacketPtr reply(new XBridgePacket(xbcTransactionCreated));
-    reply->append(hubAddress);
-    reply->append(thisAddress);
-    reply->append(id.begin(), 32);
-    reply->append(unsignedTx1);
-    reply->append(unsignedTx2);
+    XBridgePacketWriter<XBridgeLayoutTransactionCreated> reply(xbcTransactionCreated,
+                                                               XBridgePacket::blobSize(unsignedTx1) +
+                                                               XBridgePacket::blobSize(unsignedTx2));
+    reply.set<XBridgeLayoutTransactionCreated::HubAddress>(view.span<L::HubAddress>())
+         .set<XBridgeLayoutTransactionCreated::ClientAddress>(view.span<L::ClientAddress>())
+         .set<XBridgeLayoutTransactionCreated::HubTxId>(id)
+         .appendBlob(unsignedTx1)
+         .appendBlob(unsignedTx2);
 
-    if (!sendPacketBroadcast(reply))
+    if (!sendPacketBroadcast(reply.packet()))
     {
         ERR() << "error sending created transactions packet " << __FUNCTION__;
         return false;
@@ -1126,24 +1353,18 @@ bool XBridgeSession::processTransactionCreateBTC(XBridgePacketPtr packet)
 {
     DEBUG_TRACE_LOG(currencyToLog());
 
-    if (packet->size() != 100)
-    {
-        ERR() << "incorrect packet size for xbcTransactionCreate" << __FUNCTION__;
-        return false;
-    }
-
-    std::vector<unsigned char> thisAddress(packet->data(), packet->data()+20);
-    std::vector<unsigned char> hubAddress(packet->data()+20, packet->data()+40);
+    typedef XBridgeLayoutTransactionCreate L;
+    XBridgePacketView<L> view(packet);
 
     // transaction id
-    uint256 id   (packet->data()+40);
+    uint256 id = view.hash<L::HubTxId>();
 
     // destination address
-    std::vector<unsigned char> destAddress(packet->data()+72, packet->data()+92);
+    std::vector<unsigned char> destAddress = view.span<L::DestAddress>().vector();
 
     // lock time
-    boost::uint32_t lockTimeTx1 = *reinterpret_cast<boost::uint32_t *>(packet->data()+92);
-    boost::uint32_t lockTimeTx2 = *reinterpret_cast<boost::uint32_t *>(packet->data()+96);
+    boost::uint32_t lockTimeTx1 = view.uint32<L::LockTimeTx1>();
+    boost::uint32_t lockTimeTx2 = view.uint32<L::LockTimeTx2>();
 
     XBridgeTransactionDescrPtr xtx;
     {
@@ -1160,38 +1381,23 @@ bool XBridgeSession::processTransactionCreateBTC(XBridgePacketPtr packet)
     }
 
 
-    std::vector<rpc::Unspent> entries;
-    if (!rpc::listUnspent(m_user, m_passwd, m_address, m_port, entries))
-    {
-        LOG() << "rpc::listUnspent failed" << __FUNCTION__;
-        return false;
-    }
-
     boost::uint64_t fee = m_COIN*XBridgeTransactionDescr::MIN_TX_FEE/XBridgeTransactionDescr::COIN;
     boost::uint64_t outAmount = m_COIN*(static_cast<double>(xtx->fromAmount)/XBridgeTransactionDescr::COIN)+fee;
     boost::uint64_t inAmount  = 0;
 
+    // inputs reserved for this swap, released on cancel.
+    // change output costs about a fee, smaller excess left to fee
     std::vector<rpc::Unspent> usedInTx;
-    for (const rpc::Unspent & entry : entries)
-    {
-        usedInTx.push_back(entry);
-        inAmount += entry.amount*m_COIN;
-
-        // check amount
-        if (inAmount >= outAmount)
-        {
-            break;
-        }
-    }
-
-    // check amount
-    if (inAmount < outAmount)
+    if (!reserveUnspent(id, outAmount, fee, usedInTx, inAmount))
     {
         // no money, cancel transaction
         sendCancelTransaction(id);
         return false;
     }
 
+    // change output only if excess above fee
+    bool withChange = inAmount - outAmount > fee;
+
     // create tx1, locked
     CBTCTransaction tx1;
 
@@ -1211,10 +1417,10 @@ bool XBridgeSession::processTransactionCreateBTC(XBridgePacketPtr packet)
     // outputs
     tx1.vout.push_back(CTxOut(outAmount-fee, destination(destAddress, m_prefix[0])));
 
-    if (inAmount > outAmount)
+    if (withChange)
     {
         std::string addr;
-        if (!rpc::getNewAddress(m_user, m_passwd, m_address, m_port, addr))
+        if (!newAddress(addr))
         {
             // cancel transaction
             sendCancelTransaction(id);
@@ -1227,8 +1433,8 @@ bool XBridgeSession::processTransactionCreateBTC(XBridgePacketPtr packet)
     }
 
     // serialize
-    std::string unsignedTx1 = txToStringBTC(tx1);
-    std::string signedTx1 = unsignedTx1;
+    std::vector<unsigned char> unsignedTx1 = txToBytesBTC(tx1);
+    std::string signedTx1 = HexStr(unsignedTx1);
 
     if (!rpc::signRawTransaction(m_user, m_passwd, m_address, m_port, signedTx1))
     {
@@ -1243,7 +1449,7 @@ bool XBridgeSession::processTransactionCreateBTC(XBridgePacketPtr packet)
     LOG() << signedTx1;
 
     xtx->payTxId = tx1.GetHash();
-    xtx->payTx   = signedTx1;
+    xtx->payTx   = txBytesFromHex(signedTx1);
 
     // create tx2, inputs
     CTransaction tx2;
@@ -1253,7 +1459,7 @@ bool XBridgeSession::processTransactionCreateBTC(XBridgePacketPtr packet)
     // outputs
     {
         std::string addr;
-        if (!rpc::getNewAddress(m_user, m_passwd, m_address, m_port, addr))
+        if (!newAddress(addr))
         {
             // cancel transaction
             sendCancelTransaction(id);
@@ -1272,9 +1478,9 @@ bool XBridgeSession::processTransactionCreateBTC(XBridgePacketPtr packet)
     }
 
     // serialize
-    std::string unsignedTx2 = txToStringBTC(tx2);
+    std::vector<unsigned char> unsignedTx2 = txToBytesBTC(tx2);
     LOG() << "revert tx (unsigned) " << tx2.GetHash().GetHex();
-    LOG() << unsignedTx2;
+    LOG() << HexStr(unsignedTx2);
 
     // store
     xtx->revTx = unsignedTx2;
@@ -1283,14 +1489,16 @@ bool XBridgeSession::processTransactionCreateBTC(XBridgePacketPtr packet)
     uiConnector.NotifyXBridgeTransactionStateChanged(id, xtx->state);
 
     // send reply
-    XBridgePacketPtr reply(new XBridgePacket(xbcTransactionCreated));
-    reply->append(hubAddress);
-    reply->append(thisAddress);
-    reply->append(id.begin(), 32);
-    reply->append(unsignedTx1);
-    reply->append(unsignedTx2);
+    XBridgePacketWriter<XBridgeLayoutTransactionCreated> reply(xbcTransactionCreated,
+                                                               XBridgePacket::blobSize(unsignedTx1) +
+                                                               XBridgePacket::blobSize(unsignedTx2));
+    reply.set<XBridgeLayoutTransactionCreated::HubAddress>(view.span<L::HubAddress>())
+         .set<XBridgeLayoutTransactionCreated::ClientAddress>(view.span<L::ClientAddress>())
+         .set<XBridgeLayoutTransactionCreated::HubTxId>(id)
+         .appendBlob(unsignedTx1)
+         .appendBlob(unsignedTx2);
 
-    if (!sendPacketBroadcast(reply))
+    if (!sendPacketBroadcast(reply.packet()))
     {
         ERR() << "error sending created transactions packet " << __FUNCTION__;
         return false;
@@ -1306,13 +1514,6 @@ bool XBridgeSession::processTransactionCreated(XBridgePacketPtr packet)
     // DEBUG_TRACE();
     DEBUG_TRACE_LOG(currencyToLog());
 
-    // size must be > 72 bytes
-    if (packet->size() < 72)
-    {
-        ERR() << "invalid packet size for xbcTransactionCreated " << __FUNCTION__;
-        return false;
-    }
-
     // check is for me
     if (relayPacket(packet))
     {
@@ -1325,23 +1526,24 @@ bool XBridgeSession::processTransactionCreated(XBridgePacketPtr packet)
         return true;
     }
 
-    size_t offset = 20;
+    typedef XBridgeLayoutTransactionCreated L;
+    XBridgePacketView<L> view(packet);
 
-    std::vector<unsigned char> from(packet->data()+offset, packet->data()+offset+20);
-    offset += 20;
+    std::vector<unsigned char> from = view.span<L::ClientAddress>().vector();
+    uint256 txid = view.hash<L::HubTxId>();
 
-    uint256 txid(packet->data()+offset);
-    offset += 32;
-
-    std::string rawpaytx(reinterpret_cast<const char *>(packet->data()+offset));
-    offset += rawpaytx.size()+1;
-
-    std::string rawrevtx(reinterpret_cast<const char *>(packet->data()+offset));
+    std::vector<unsigned char> rawpaytx = view.tailBlob(0).vector();
+    std::vector<unsigned char> rawrevtx = view.tailBlob(1).vector();
 
     XBridgeTransactionPtr tr = e.transaction(txid);
+    if (!tr)
+    {
+        return true;
+    }
+
     boost::mutex::scoped_lock l(tr->m_lock);
 
-    tr->updateTimestamp();
+    e.updateTimestamp(tr);
 
     if (e.updateTransactionWhenCreatedReceived(tr, from, rawpaytx, rawrevtx))
     {
@@ -1353,27 +1555,31 @@ bool XBridgeSession::processTransactionCreated(XBridgePacketPtr packet)
             LOG() << "send xbcTransactionSign to "
                   << util::base64_encode(std::string((char *)&tr->firstDestination()[0], 20));
 
-            XBridgePacketPtr reply(new XBridgePacket(xbcTransactionSign));
-            reply->append(tr->firstDestination());
-            reply->append(myaddr(), 20);
-            reply->append(txid.begin(), 32);
-            reply->append(tr->secondRawPayTx());
-            reply->append(tr->secondRawRevTx());
+            XBridgePacketWriter<XBridgeLayoutTransactionSign> reply(xbcTransactionSign,
+                                                               XBridgePacket::blobSize(tr->secondRawPayTx()) +
+                                                               XBridgePacket::blobSize(tr->secondRawRevTx()));
+            reply.set<XBridgeLayoutTransactionSign::ClientAddress>(tr->firstDestination())
+                 .set<XBridgeLayoutTransactionSign::HubAddress>(myaddr())
+                 .set<XBridgeLayoutTransactionSign::HubTxId>(txid)
+                 .appendBlob(tr->secondRawPayTx())
+                 .appendBlob(tr->secondRawRevTx());
 
-            sendPacket(tr->firstDestination(), reply);
+            sendPacket(tr->firstDestination(), reply.packet());
 
             // TODO remove this log
             LOG() << "send xbcTransactionSign to "
                   << util::base64_encode(std::string((char *)&tr->secondDestination()[0], 20));
 
-            XBridgePacketPtr reply2(new XBridgePacket(xbcTransactionSign));
-            reply2->append(tr->secondDestination());
-            reply2->append(myaddr(), 20);
-            reply2->append(txid.begin(), 32);
-            reply2->append(tr->firstRawPayTx());
-            reply2->append(tr->firstRawRevTx());
+            XBridgePacketWriter<XBridgeLayoutTransactionSign> reply2(xbcTransactionSign,
+                                                               XBridgePacket::blobSize(tr->firstRawPayTx()) +
+                                                               XBridgePacket::blobSize(tr->firstRawRevTx()));
+            reply2.set<XBridgeLayoutTransactionSign::ClientAddress>(tr->secondDestination())
+                  .set<XBridgeLayoutTransactionSign::HubAddress>(myaddr())
+                  .set<XBridgeLayoutTransactionSign::HubTxId>(txid)
+                  .appendBlob(tr->firstRawPayTx())
+                  .appendBlob(tr->firstRawRevTx());
 
-            sendPacket(tr->secondDestination(), reply2);
+            sendPacket(tr->secondDestination(), reply2.packet());
         }
     }
 
@@ -1386,25 +1592,13 @@ bool XBridgeSession::processTransactionSign(XBridgePacketPtr packet)
 {
     DEBUG_TRACE_LOG(currencyToLog());
 
-    if (packet->size() < 72)
-    {
-        ERR() << "incorrect packet size for xbcTransactionSign" << __FUNCTION__;
-        return false;
-    }
-
-    std::vector<unsigned char> thisAddress(packet->data(), packet->data()+20);
-
-    size_t offset = 20;
-    std::vector<unsigned char> hubAddress(packet->data()+offset, packet->data()+offset+20);
-    offset += 20;
-
-    uint256 txid(packet->data()+offset);
-    offset += 32;
+    typedef XBridgeLayoutTransactionSign L;
+    XBridgePacketView<L> view(packet);
 
-    std::string rawtxpay(reinterpret_cast<const char *>(packet->data()+offset));
-    offset += rawtxpay.size()+1;
+    uint256 txid = view.hash<L::HubTxId>();
 
-    std::string rawtxrev(reinterpret_cast<const char *>(packet->data()+offset));
+    XBridgeSpan rawtxpay = view.tailBlob(0);
+    XBridgeSpan rawtxrev = view.tailBlob(1);
 
     // check txid
     XBridgeTransactionDescrPtr xtx;
@@ -1423,8 +1617,8 @@ bool XBridgeSession::processTransactionSign(XBridgePacketPtr packet)
 
     // unserialize
     {
-        CBTCTransaction txpay = (m_currency == "BTC") ? txFromStringBTC(rawtxpay) : txFromString(rawtxpay);
-        CBTCTransaction txrev = (m_currency == "BTC") ? txFromStringBTC(rawtxrev) : txFromString(rawtxrev);
+        CBTCTransaction txpay = (m_currency == "BTC") ? txFromBytesBTC(rawtxpay) : txFromBytes(rawtxpay);
+        CBTCTransaction txrev = (m_currency == "BTC") ? txFromBytesBTC(rawtxrev) : txFromBytes(rawtxrev);
 
         if (txpay.nLockTime < LOCKTIME_THRESHOLD || txrev.nLockTime < LOCKTIME_THRESHOLD)
         {
@@ -1437,24 +1631,28 @@ bool XBridgeSession::processTransactionSign(XBridgePacketPtr packet)
     // TODO check txpay, inputs-outputs
 
     // sign txrevert
-    if (!rpc::signRawTransaction(m_user, m_passwd, m_address, m_port, rawtxrev))
+    std::string signedTxRev = HexStr(rawtxrev.begin(), rawtxrev.end());
+    if (!rpc::signRawTransaction(m_user, m_passwd, m_address, m_port, signedTxRev))
     {
         // do not sign, cancel
         sendCancelTransaction(txid);
         return false;
     }
 
+    std::vector<unsigned char> signedTx = txBytesFromHex(signedTxRev);
+
     xtx->state = XBridgeTransactionDescr::trSigned;
     uiConnector.NotifyXBridgeTransactionStateChanged(txid, xtx->state);
 
     // send reply
-    XBridgePacketPtr reply(new XBridgePacket(xbcTransactionSigned));
-    reply->append(hubAddress);
-    reply->append(thisAddress);
-    reply->append(txid.begin(), 32);
-    reply->append(rawtxrev);
+    XBridgePacketWriter<XBridgeLayoutTransactionSigned> reply(xbcTransactionSigned,
+                                                              XBridgePacket::blobSize(signedTx));
+    reply.set<XBridgeLayoutTransactionSigned::HubAddress>(view.span<L::HubAddress>())
+         .set<XBridgeLayoutTransactionSigned::ClientAddress>(view.span<L::ClientAddress>())
+         .set<XBridgeLayoutTransactionSigned::HubTxId>(txid)
+         .appendBlob(signedTx);
 
-    if (!sendPacketBroadcast(reply))
+    if (!sendPacketBroadcast(reply.packet()))
     {
         ERR() << "error sending created transactions packet " << __FUNCTION__;
         return false;
@@ -1470,13 +1668,6 @@ bool XBridgeSession::processTransactionSigned(XBridgePacketPtr packet)
     // DEBUG_TRACE();
     DEBUG_TRACE_LOG(currencyToLog());
 
-    // size must be > 72 bytes
-    if (packet->size() < 72)
-    {
-        ERR() << "invalid packet size for xbcTransactionSigned " << __FUNCTION__;
-        return false;
-    }
-
     // check is for me
     if (relayPacket(packet))
     {
@@ -1489,15 +1680,23 @@ bool XBridgeSession::processTransactionSigned(XBridgePacketPtr packet)
         return true;
     }
 
-    std::vector<unsigned char> from(packet->data()+20, packet->data()+40);
-    uint256 txid(packet->data()+40);
+    typedef XBridgeLayoutTransactionSigned L;
+    XBridgePacketView<L> view(packet);
+
+    std::vector<unsigned char> from = view.span<L::ClientAddress>().vector();
+    uint256 txid = view.hash<L::HubTxId>();
 
-    std::string rawtx(reinterpret_cast<const char *>(packet->data()+72));
+    std::vector<unsigned char> rawtx = view.tailBlob(0).vector();
 
     XBridgeTransactionPtr tr = e.transaction(txid);
+    if (!tr)
+    {
+        return true;
+    }
+
     boost::mutex::scoped_lock l(tr->m_lock);
 
-    tr->updateTimestamp();
+    e.updateTimestamp(tr);
 
     if (e.updateTransactionWhenSignedReceived(tr, from, rawtx))
     {
@@ -1509,25 +1708,27 @@ bool XBridgeSession::processTransactionSigned(XBridgePacketPtr packet)
             LOG() << "send xbcTransactionCommit to "
                   << util::base64_encode(std::string((char *)&tr->firstAddress()[0], 20));
 
-            XBridgePacketPtr reply(new XBridgePacket(xbcTransactionCommit));
-            reply->append(tr->firstAddress());
-            reply->append(myaddr(), 20);
-            reply->append(txid.begin(), 32);
-            reply->append(tr->firstRawRevTx());
+            XBridgePacketWriter<XBridgeLayoutTransactionCommit> reply(xbcTransactionCommit,
+                                                                 XBridgePacket::blobSize(tr->firstRawRevTx()));
+            reply.set<XBridgeLayoutTransactionCommit::ClientAddress>(tr->firstAddress())
+                 .set<XBridgeLayoutTransactionCommit::HubAddress>(myaddr())
+                 .set<XBridgeLayoutTransactionCommit::HubTxId>(txid)
+                 .appendBlob(tr->firstRawRevTx());
 
-            sendPacket(tr->firstAddress(), reply);
+            sendPacket(tr->firstAddress(), reply.packet());
 
             // TODO remove this log
             LOG() << "send xbcTransactionCommit to "
                   << util::base64_encode(std::string((char *)&tr->secondAddress()[0], 20));
 
-            XBridgePacketPtr reply2(new XBridgePacket(xbcTransactionCommit));
-            reply2->append(tr->secondAddress());
-            reply2->append(myaddr(), 20);
-            reply2->append(txid.begin(), 32);
-            reply2->append(tr->secondRawRevTx());
+            XBridgePacketWriter<XBridgeLayoutTransactionCommit> reply2(xbcTransactionCommit,
+                                                                 XBridgePacket::blobSize(tr->secondRawRevTx()));
+            reply2.set<XBridgeLayoutTransactionCommit::ClientAddress>(tr->secondAddress())
+                  .set<XBridgeLayoutTransactionCommit::HubAddress>(myaddr())
+                  .set<XBridgeLayoutTransactionCommit::HubTxId>(txid)
+                  .appendBlob(tr->secondRawRevTx());
 
-            sendPacket(tr->secondAddress(), reply2);
+            sendPacket(tr->secondAddress(), reply2.packet());
         }
     }
 
@@ -1540,18 +1741,12 @@ bool XBridgeSession::processTransactionCommit(XBridgePacketPtr packet)
 {
     DEBUG_TRACE_LOG(currencyToLog());
 
-    if (packet->size() < 72)
-    {
-        ERR() << "incorrect packet size for xbcTransactionCommit" << __FUNCTION__;
-        return false;
-    }
+    typedef XBridgeLayoutTransactionCommit L;
+    XBridgePacketView<L> view(packet);
 
-    std::vector<unsigned char> thisAddress(packet->data(), packet->data()+20);
-    std::vector<unsigned char> hubAddress(packet->data()+20, packet->data()+40);
+    uint256 txid = view.hash<L::HubTxId>();
 
-    uint256 txid(packet->data()+40);
-
-    std::string rawtx(reinterpret_cast<const char *>(packet->data()+72));
+    XBridgeSpan rawtx = view.tailBlob(0);
 
     // send pay transaction to network
     XBridgeTransactionDescrPtr xtx;
@@ -1569,10 +1764,10 @@ bool XBridgeSession::processTransactionCommit(XBridgePacketPtr packet)
     }
 
     // unserialize signed transaction
-    // CTransaction txrev = txFromString(rawtx);
-    xtx->revTx = rawtx;
+    // CTransaction txrev = txFromBytes(rawtx);
+    xtx->revTx = rawtx.vector();
 
-    if (!rpc::sendRawTransaction(m_user, m_passwd, m_address, m_port, xtx->payTx))
+    if (!rpc::sendRawTransaction(m_user, m_passwd, m_address, m_port, HexStr(xtx->payTx)))
     {
         // not commited....send cancel???
         // sendCancelTransaction(id);
@@ -1582,16 +1777,19 @@ bool XBridgeSession::processTransactionCommit(XBridgePacketPtr packet)
 //    uint256 walletTxId = (static_cast<CTransaction *>(&xtx->payTx))->GetHash();
 //    m_mapWalletTxToXBridgeTx[walletTxId] = txid;
 
+    // inputs left wallet
+    XBridgeApp::instance().utxoCache().spend(txid);
+
     xtx->state = XBridgeTransactionDescr::trCommited;
     uiConnector.NotifyXBridgeTransactionStateChanged(txid, xtx->state);
 
     // send commit apply to hub
-    XBridgePacketPtr reply(new XBridgePacket(xbcTransactionCommited));
-    reply->append(hubAddress);
-    reply->append(thisAddress);
-    reply->append(txid.begin(), 32);
-    reply->append(xtx->payTxId.begin(), 32);
-    if (!sendPacketBroadcast(reply))
+    XBridgePacketWriter<XBridgeLayoutTransactionCommited> reply(xbcTransactionCommited);
+    reply.set<XBridgeLayoutTransactionCommited::HubAddress>(view.span<L::HubAddress>())
+         .set<XBridgeLayoutTransactionCommited::ClientAddress>(view.span<L::ClientAddress>())
+         .set<XBridgeLayoutTransactionCommited::HubTxId>(txid)
+         .set<XBridgeLayoutTransactionCommited::TxHash>(xtx->payTxId);
+    if (!sendPacketBroadcast(reply.packet()))
     {
         ERR() << "error sending transaction commited packet "
                  << __FUNCTION__;
@@ -1608,13 +1806,6 @@ bool XBridgeSession::processTransactionCommited(XBridgePacketPtr packet)
     // DEBUG_TRACE();
     DEBUG_TRACE_LOG(currencyToLog());
 
-    // size must be == 104 bytes
-    if (packet->size() != 104)
-    {
-        ERR() << "invalid packet size for xbcTransactionCommited " << __FUNCTION__;
-        return false;
-    }
-
     // check is for me
     if (relayPacket(packet))
     {
@@ -1627,14 +1818,22 @@ bool XBridgeSession::processTransactionCommited(XBridgePacketPtr packet)
         return true;
     }
 
-    std::vector<unsigned char> from(packet->data()+20, packet->data()+40);
-    uint256 txid(packet->data()+40);
-    uint256 txhash(packet->data()+72);
+    typedef XBridgeLayoutTransactionCommited L;
+    XBridgePacketView<L> view(packet);
+
+    std::vector<unsigned char> from = view.span<L::ClientAddress>().vector();
+    uint256 txid   = view.hash<L::HubTxId>();
+    uint256 txhash = view.hash<L::TxHash>();
 
     XBridgeTransactionPtr tr = e.transaction(txid);
+    if (!tr)
+    {
+        return true;
+    }
+
     boost::mutex::scoped_lock l(tr->m_lock);
 
-    tr->updateTimestamp();
+    e.updateTimestamp(tr);
 
     if (e.updateTransactionWhenCommitedReceived(tr, from, txhash))
     {
@@ -1652,25 +1851,25 @@ bool XBridgeSession::processTransactionCommited(XBridgePacketPtr packet)
 //            LOG() << "send xbcTransactionCommit to "
 //                  << util::base64_encode(std::string((char *)&tr->firstDestination()[0], 20));
 
-            XBridgePacketPtr reply(new XBridgePacket(xbcTransactionConfirm));
-            reply->append(tr->firstDestination());
-            reply->append(myaddr(), 20);
-            reply->append(txid.begin(), 32);
-            reply->append(tr->secondTxHash().begin(), 32);
+            XBridgePacketWriter<XBridgeLayoutTransactionConfirm> reply(xbcTransactionConfirm);
+            reply.set<XBridgeLayoutTransactionConfirm::ClientAddress>(tr->firstDestination())
+                 .set<XBridgeLayoutTransactionConfirm::HubAddress>(myaddr())
+                 .set<XBridgeLayoutTransactionConfirm::HubTxId>(txid)
+                 .set<XBridgeLayoutTransactionConfirm::TxHash>(tr->secondTxHash());
 
-            sendPacket(tr->firstDestination(), reply);
+            sendPacket(tr->firstDestination(), reply.packet());
 
 //            // TODO remove this log
 //            LOG() << "send xbcTransactionCommit to "
 //                  << util::base64_encode(std::string((char *)&tr->secondDestination()[0], 20));
 
-            XBridgePacketPtr reply2(new XBridgePacket(xbcTransactionConfirm));
-            reply2->append(tr->secondDestination());
-            reply2->append(myaddr(), 20);
-            reply2->append(txid.begin(), 32);
-            reply2->append(tr->firstTxHash().begin(), 32);
+            XBridgePacketWriter<XBridgeLayoutTransactionConfirm> reply2(xbcTransactionConfirm);
+            reply2.set<XBridgeLayoutTransactionConfirm::ClientAddress>(tr->secondDestination())
+                  .set<XBridgeLayoutTransactionConfirm::HubAddress>(myaddr())
+                  .set<XBridgeLayoutTransactionConfirm::HubTxId>(txid)
+                  .set<XBridgeLayoutTransactionConfirm::TxHash>(tr->firstTxHash());
 
-            sendPacket(tr->secondDestination(), reply2);
+            sendPacket(tr->secondDestination(), reply2.packet());
         }
     }
 
@@ -1683,17 +1882,11 @@ bool XBridgeSession::processTransactionConfirm(XBridgePacketPtr packet)
 {
     DEBUG_TRACE_LOG(currencyToLog());
 
-    if (packet->size() < 72)
-    {
-        LOG() << "incorrect packet size for xbcTransactionConfirm";
-        return false;
-    }
-
-    std::vector<unsigned char> thisAddress(packet->data(), packet->data()+20);
-    std::vector<unsigned char> hubAddress(packet->data()+20, packet->data()+40);
+    typedef XBridgeLayoutTransactionConfirm L;
+    XBridgePacketView<L> view(packet);
 
-    uint256 txid(packet->data()+40);
-    uint256 txhash(packet->data()+72);
+    uint256 txid   = view.hash<L::HubTxId>();
+    uint256 txhash = view.hash<L::TxHash>();
 
     XBridgeTransactionDescrPtr xtx;
     {
@@ -1710,10 +1903,16 @@ bool XBridgeSession::processTransactionConfirm(XBridgePacketPtr packet)
     }
 
     xtx->payTxId    = txhash;
-    xtx->hubAddress = hubAddress;
-    xtx->myAddress  = thisAddress;
+    xtx->hubAddress = view.span<L::HubAddress>().vector();
+    xtx->myAddress  = view.span<L::ClientAddress>().vector();
 
-    // add to unconfirmed list
+    // check at once, already in wallet if confirm is late
+    if (checkTransactionConfirmed(txid, xtx))
+    {
+        return true;
+    }
+
+    // add to unconfirmed list, checked by timer
     {
         boost::mutex::scoped_lock l(XBridgeApp::m_txUnconfirmedLocker);
         XBridgeApp::m_unconfirmed[txid] = xtx;
@@ -1723,18 +1922,39 @@ bool XBridgeSession::processTransactionConfirm(XBridgePacketPtr packet)
 }
 
 //*****************************************************************************
+// send confirmed to hub if pay tx found in wallet
 //*****************************************************************************
-bool XBridgeSession::processTransactionConfirmed(XBridgePacketPtr packet)
+bool XBridgeSession::checkTransactionConfirmed(const uint256 & txid, XBridgeTransactionDescrPtr tx)
 {
-    DEBUG_TRACE_LOG(currencyToLog());
-
-    // size must be == 72 bytes
-    if (packet->size() != 72)
+    LOG() << "check transaction " << tx->payTxId.GetHex();
+    if (!rpc::getTransaction(m_user, m_passwd, m_address, m_port,
+                             tx->payTxId.GetHex()))
     {
-        ERR() << "invalid packet size for xbcTransactionCommited " << __FUNCTION__;
         return false;
     }
 
+    sendTransactionConfirmed(txid, tx);
+    return true;
+}
+
+//*****************************************************************************
+//*****************************************************************************
+void XBridgeSession::sendTransactionConfirmed(const uint256 & txid, XBridgeTransactionDescrPtr tx)
+{
+    XBridgePacketWriter<XBridgeLayoutClientReply> reply(xbcTransactionConfirmed);
+    reply.set<XBridgeLayoutClientReply::HubAddress>(tx->hubAddress)
+         .set<XBridgeLayoutClientReply::ClientAddress>(tx->myAddress)
+         .set<XBridgeLayoutClientReply::HubTxId>(txid);
+
+    sendPacket(tx->hubAddress, reply.packet());
+}
+
+//*****************************************************************************
+//*****************************************************************************
+bool XBridgeSession::processTransactionConfirmed(XBridgePacketPtr packet)
+{
+    DEBUG_TRACE_LOG(currencyToLog());
+
     // check is for me
     if (relayPacket(packet))
     {
@@ -1743,13 +1963,20 @@ bool XBridgeSession::processTransactionConfirmed(XBridgePacketPtr packet)
 
     XBridgeExchange & e = XBridgeExchange::instance();
 
-    std::vector<unsigned char> from(packet->data()+20, packet->data()+40);
-    uint256 txid(packet->data()+40);
+    XBridgePacketView<XBridgeLayoutClientReply> view(packet);
+
+    std::vector<unsigned char> from = view.span<XBridgeLayoutClientReply::ClientAddress>().vector();
+    uint256 txid = view.hash<XBridgeLayoutClientReply::HubTxId>();
 
     XBridgeTransactionPtr tr = e.transaction(txid);
+    if (!tr)
+    {
+        return true;
+    }
+
     boost::mutex::scoped_lock l(tr->m_lock);
 
-    tr->updateTimestamp();
+    e.updateTimestamp(tr);
 
     if (e.updateTransactionWhenConfirmedReceived(tr, from))
     {
@@ -1757,9 +1984,9 @@ bool XBridgeSession::processTransactionConfirmed(XBridgePacketPtr packet)
         {
             LOG() << "broadcast send xbcTransactionFinished";
 
-            XBridgePacketPtr reply(new XBridgePacket(xbcTransactionFinished));
-            reply->append(txid.begin(), 32);
-            sendPacketBroadcast(reply);
+            XBridgePacketWriter<XBridgeLayoutTxId> reply(xbcTransactionFinished);
+            reply.set<XBridgeLayoutTxId::Id>(txid);
+            sendPacketBroadcast(reply.packet());
 
             // send transaction state to clients
 //            std::vector<std::vector<unsigned char> > rcpts;
@@ -1792,14 +2019,7 @@ bool XBridgeSession::processTransactionCancel(XBridgePacketPtr packet)
 {
     // DEBUG_TRACE();
 
-    // size must be == 32 bytes
-    if (packet->size() != 32)
-    {
-        ERR() << "invalid packet size for xbcReceivedTransaction " << __FUNCTION__;
-        return false;
-    }
-
-    uint256 txid(packet->data());
+    uint256 txid = XBridgePacketView<XBridgeLayoutTxId>(packet).hash<XBridgeLayoutTxId::Id>();
 
     // check and process packet if bridge is exchange
     XBridgeExchange & e = XBridgeExchange::instance();
@@ -1821,6 +2041,17 @@ bool XBridgeSession::processTransactionCancel(XBridgePacketPtr packet)
     {
         boost::mutex::scoped_lock l(XBridgeApp::m_txLocker);
 
+        // pending order (or rest of it) dropped by hub
+        std::map<uint256, XBridgeTransactionDescrPtr>::iterator i = XBridgeApp::m_pendingTransactions.find(txid);
+        if (i != XBridgeApp::m_pendingTransactions.end())
+        {
+            i->second->state = XBridgeTransactionDescr::trCancelled;
+            XBridgeApp::m_pendingTransactions.erase(i);
+
+            uiConnector.NotifyXBridgeTransactionStateChanged(txid, XBridgeTransactionDescr::trCancelled);
+            return true;
+        }
+
         if (!XBridgeApp::m_transactions.count(txid))
         {
             // signal for gui
@@ -1831,6 +2062,9 @@ bool XBridgeSession::processTransactionCancel(XBridgePacketPtr packet)
         xtx = XBridgeApp::m_transactions[txid];
     }
 
+    // reserved inputs free again, no-op if already spent
+    XBridgeApp::instance().utxoCache().release(txid);
+
     // update transaction state for gui
     xtx->state = XBridgeTransactionDescr::trCancelled;
     uiConnector.NotifyXBridgeTransactionStateChanged(txid, xtx->state);
@@ -1864,12 +2098,11 @@ bool XBridgeSession::finishTransaction(XBridgeTransactionPtr tr)
 //        LOG() << "send xbcTransactionFinished to "
 //              << util::base64_encode(std::string((char *)&to[0], 20));
 
-        XBridgePacketPtr reply(new XBridgePacket(xbcTransactionFinished));
-        // reply->append(to);
-        reply->append(tr->id().begin(), 32);
+        XBridgePacketWriter<XBridgeLayoutTxId> reply(xbcTransactionFinished);
+        reply.set<XBridgeLayoutTxId::Id>(tr->id());
 
         // sendPacket(to, reply);
-        sendPacketBroadcast(reply);
+        sendPacketBroadcast(reply.packet());
     }
 
     tr->finish();
@@ -1883,6 +2116,9 @@ bool XBridgeSession::sendCancelTransaction(const uint256 & txid)
 {
     LOG() << "cancel transaction <" << txid.GetHex() << ">";
 
+    // inputs of local swap not needed any more
+    XBridgeApp::instance().utxoCache().release(txid);
+
     // if (tr->state() != XBridgeTransaction::trNew)
     {
         // std::vector<std::vector<unsigned char> > rcpts;
@@ -1897,12 +2133,11 @@ bool XBridgeSession::sendCancelTransaction(const uint256 & txid)
             // LOG() << "send xbcTransactionCancel to "
             //       << util::base64_encode(std::string((char *)&to[0], 20));
 
-            XBridgePacketPtr reply(new XBridgePacket(xbcTransactionCancel));
-            // reply->append(to);
-            reply->append(txid.begin(), 32);
+            XBridgePacketWriter<XBridgeLayoutTxId> reply(xbcTransactionCancel);
+            reply.set<XBridgeLayoutTxId::Id>(txid);
 
             // sendPacket(to, reply);
-            sendPacketBroadcast(reply);
+            sendPacketBroadcast(reply.packet());
         }
     }
 
@@ -1934,11 +2169,11 @@ bool XBridgeSession::rollbackTransaction(XBridgeTransactionPtr tr)
         LOG() << "send xbcTransactionRollback to "
               << util::base64_encode(std::string((char *)&to[0], 20));
 
-        XBridgePacketPtr reply(new XBridgePacket(xbcTransactionRollback));
-        reply->append(to);
-        reply->append(tr->id().begin(), 32);
+        XBridgePacketWriter<XBridgeLayoutTransactionRollback> reply(xbcTransactionRollback);
+        reply.set<XBridgeLayoutTransactionRollback::ClientAddress>(to)
+             .set<XBridgeLayoutTransactionRollback::HubTxId>(tr->id());
 
-        sendPacket(to, reply);
+        sendPacket(to, reply.packet());
     }
 
     sendCancelTransaction(tr->id());
@@ -1953,36 +2188,56 @@ bool XBridgeSession::processBitcoinTransactionHash(XBridgePacketPtr packet)
 {
     // DEBUG_TRACE();
 
-    // size must be == 32 bytes (256bit)
-    if (packet->size() != 32)
-    {
-        ERR() << "invalid packet size for xbcReceivedTransaction " << __FUNCTION__;
-        return false;
-    }
-
     static XBridgeExchange & e = XBridgeExchange::instance();
     if (!e.isEnabled())
     {
         return true;
     }
 
-    uint256 id(packet->data());
+    uint256 id = XBridgePacketView<XBridgeLayoutTxId>(packet).hash<XBridgeLayoutTxId::Id>();
 //    // LOG() << "received transaction <" << id.GetHex() << ">";
 
-    e.updateTransaction(id);
+    updateBitcoinTransaction(id);
 
     return true;
 }
 
+//*****************************************************************************
+// exchange enabled, transaction seen by wallet
+//*****************************************************************************
+void XBridgeSession::updateBitcoinTransaction(const uint256 & id)
+{
+    XBridgeExchange & e = XBridgeExchange::instance();
+
+    std::list<XBridgeTransactionPtr> confirmed;
+    e.updateTransaction(id, confirmed);
+
+    // finish confirmed swaps at once
+    for (std::list<XBridgeTransactionPtr>::iterator i = confirmed.begin(); i != confirmed.end(); ++i)
+    {
+        XBridgeTransactionPtr & tr = *i;
+
+        boost::mutex::scoped_lock l(tr->m_lock);
+
+        if (tr->state() == XBridgeTransaction::trConfirmed)
+        {
+            finishTransaction(tr);
+            e.scheduleTransaction(tr->id(), 0);
+        }
+    }
+}
+
 //*****************************************************************************
 //*****************************************************************************
 bool XBridgeSession::processAddressBookEntry(XBridgePacketPtr packet)
 {
     // DEBUG_TRACE();
 
-    std::string currency(reinterpret_cast<const char *>(packet->data()));
-    std::string name(reinterpret_cast<const char *>(packet->data()+currency.length()+1));
-    std::string address(reinterpret_cast<const char *>(packet->data()+currency.length()+name.length()+2));
+    XBridgePacketView<XBridgeLayoutAddressBookEntry> view(packet);
+
+    std::string currency(view.tailString(0));
+    std::string name(view.tailString(1));
+    std::string address(view.tailString(2));
 
     XBridgeApp::instance().storeAddressBookEntry(currency, name, address);
 
@@ -2001,15 +2256,92 @@ void XBridgeSession::sendListOfWallets()
 
     std::vector<StringPair> wallets = e.listOfWallets();
     std::vector<std::string> list;
+    std::vector<std::string> currencies;
     for (std::vector<StringPair>::iterator i = wallets.begin(); i != wallets.end(); ++i)
     {
         list.push_back(i->first + '|' + i->second);
+        currencies.push_back(i->first);
     }
 
-    XBridgePacketPtr packet(new XBridgePacket(xbcExchangeWallets));
-    packet->setData(boost::algorithm::join(list, "|"));
+    boost::uint32_t timestamp = static_cast<boost::uint32_t>(time(0));
+
+    // own place on ring
+    std::vector<unsigned char> hub(myaddr(), myaddr()+20);
+    XBridgeApp::instance().hubRing().update(hub, currencies, e.fee(), e.load(), timestamp);
+
+    std::string data = boost::algorithm::join(list, "|");
 
-    sendPacket(std::vector<unsigned char>(), packet);
+    typedef XBridgeLayoutExchangeWallets L;
+    XBridgePacketWriter<L> packet(xbcExchangeWallets, data.size());
+    packet.set<L::HubAddress>(hub)
+          .set<L::Fee>(e.fee())
+          .set<L::Load>(e.load())
+          .set<L::Timestamp>(timestamp)
+          .appendTail(reinterpret_cast<const unsigned char *>(data.c_str()), data.size());
+
+    std::vector<unsigned char> signature;
+    uint256 hash = capabilityHash(XBridgePacketView<L>(packet.packet()));
+    if (!XBridgeApp::instance().signRecord(hash, signature))
+    {
+        ERR() << "capability record not signed " << __FUNCTION__;
+        return;
+    }
+    packet.set<L::Signature>(signature);
+
+    sendPacket(std::vector<unsigned char>(), packet.packet());
+}
+
+//*****************************************************************************
+// signed capability record of other hub, wallet ids are currencies
+//*****************************************************************************
+bool XBridgeSession::processExchangeWallets(XBridgePacketPtr packet)
+{
+    typedef XBridgeLayoutExchangeWallets L;
+    XBridgePacketView<L> view(packet);
+
+    std::vector<unsigned char> hub = view.span<L::HubAddress>().vector();
+    if (hub == std::vector<unsigned char>(myaddr(), myaddr()+20))
+    {
+        return true;
+    }
+
+    // hub address is id of signing key
+    CKey key;
+    if (!key.SetCompactSignature(capabilityHash(view), view.span<L::Signature>().vector()) ||
+            key.GetPubKey().GetID() != CKeyID(uint160(hub)))
+    {
+        ERR() << "bad signature of capability record " << __FUNCTION__;
+        return false;
+    }
+
+    // stale records are not accepted after hub expired
+    boost::uint32_t timestamp = view.uint32<L::Timestamp>();
+    boost::uint32_t now       = static_cast<boost::uint32_t>(time(0));
+    if (timestamp + XBridgeHubRing::hubTTL < now || timestamp > now + XBridgeHubRing::hubTTL)
+    {
+        LOG() << "capability record expired " << __FUNCTION__;
+        return true;
+    }
+
+    XBridgeSpan tail = view.tail();
+    std::string data(reinterpret_cast<const char *>(tail.begin()), tail.size);
+
+    std::vector<std::string> items;
+    boost::algorithm::split(items, data, boost::is_any_of("|"));
+
+    // id|title pairs
+    std::vector<std::string> currencies;
+    for (std::size_t i = 0; i + 1 < items.size(); i += 2)
+    {
+        currencies.push_back(items[i]);
+    }
+
+    XBridgeApp::instance().hubRing().update(hub, currencies,
+                                            view.uint32<L::Fee>(),
+                                            view.uint32<L::Load>(),
+                                            timestamp);
+
+    return true;
 }
 
 //*****************************************************************************
@@ -2024,16 +2356,23 @@ void XBridgeSession::sendListOfTransactions()
         if (XBridgeApp::m_txLocker.try_lock())
         {
             // send pending transactions
-            for (std::map<uint256, XBridgeTransactionDescrPtr>::iterator i = XBridgeApp::m_pendingTransactions.begin();
-                 i != XBridgeApp::m_pendingTransactions.end(); ++i)
-            {
-                app.sendPendingTransaction(i->second);
-            }
+            app.sendPendingTransactions();
 
             XBridgeApp::m_txLocker.unlock();
         }
     }
 
+    // orders of hubs gone from ring
+    {
+        std::set<std::vector<unsigned char> > hubs;
+        app.hubRing().hubs(hubs);
+
+        XBridgeOrderBooks::Changes changes;
+        app.orderBooks().expire(hubs, changes);
+
+        notifyOrderBookChanges(changes);
+    }
+
     // send exchange trx
     XBridgeExchange & e = XBridgeExchange::instance();
     if (!e.isEnabled())
@@ -2041,36 +2380,145 @@ void XBridgeSession::sendListOfTransactions()
         return;
     }
 
-    std::list<XBridgeTransactionPtr> list = e.pendingTransactions();
-    std::list<XBridgeTransactionPtr>::iterator i = list.begin();
-    for (; i != list.end(); ++i)
+    // publish changes of order book since last tick,
+    // full book is sent only by request
+    XBridgeOrderBookJournal & book = e.orderBook();
+
+    std::vector<XBridgeOrderDelta> deltas;
+    book.takeUnpublished(deltas);
+    sendOrderBookDeltas(std::vector<unsigned char>(), deltas);
+
+    // and digest, clients check own copy
+    typedef XBridgeLayoutOrderBookDigest L;
+
+    XBridgeOrderBookDigest digest = book.digest();
+
+    XBridgePacketWriter<L> packet(xbcOrderBookDigest);
+    packet.set<L::HubAddress>(myaddr())
+          .set<L::Sequence>(digest.seq)
+          .set<L::Count>(digest.count)
+          .set<L::Digest>(digest.digest);
+
+    sendPacket(std::vector<unsigned char>(), packet.packet());
+}
+
+//*****************************************************************************
+// as many changes per packet as fits into datagram
+//*****************************************************************************
+void XBridgeSession::sendOrderBookDeltas(const std::vector<unsigned char> & to,
+                                         const std::vector<XBridgeOrderDelta> & deltas)
+{
+    typedef XBridgeLayoutOrderBookDelta L;
+    typedef XBridgeLayoutOrderBookDeltaHeader H;
+
+    std::vector<XBridgeOrderDelta>::const_iterator i = deltas.begin();
+    while (i != deltas.end())
     {
-        XBridgeTransactionPtr & ptr = *i;
+        XBridgeRecordsWriter<L, H> packet(xbcOrderBookDelta);
+        packet.header()
+              .set<H::HubAddress>(myaddr())
+              .set<H::Sequence>(i->seq);
 
-        boost::mutex::scoped_lock l(ptr->m_lock);
+        for (; i != deltas.end() && !packet.full(); ++i)
+        {
+            packet.addRecord()
+                  .set<L::Op>(static_cast<boost::uint32_t>(i->op))
+                  .set<L::Id>(i->order.id)
+                  .setString<L::SourceCurrency>(i->order.fromCurrency)
+                  .set<L::SourceAmount>(i->order.fromAmount)
+                  .setString<L::DestCurrency>(i->order.toCurrency)
+                  .set<L::DestAmount>(i->order.toAmount);
+        }
 
-        XBridgePacketPtr packet(new XBridgePacket(xbcPendingTransaction));
+        sendPacket(to, packet.packet());
+    }
+}
 
-        // field length must be 8 bytes
-        std::vector<unsigned char> fc(8, 0);
-        std::string tmp = ptr->firstCurrency();
-        std::copy(tmp.begin(), tmp.end(), fc.begin());
+//*****************************************************************************
+// empty book sent as header without records
+//*****************************************************************************
+void XBridgeSession::sendOrderBookSnapshot(const std::vector<unsigned char> & to,
+                                           const XBridgeOrderBookDigest & digest,
+                                           const std::vector<XBridgeOrder> & orders)
+{
+    typedef XBridgeLayoutPendingTransaction L;
+    typedef XBridgeLayoutOrderBookSnapshotHeader H;
 
-        // field length must be 8 bytes
-        std::vector<unsigned char> tc(8, 0);
-        tmp = ptr->secondCurrency();
-        std::copy(tmp.begin(), tmp.end(), tc.begin());
+    std::vector<XBridgeOrder>::const_iterator i = orders.begin();
+    do
+    {
+        XBridgeRecordsWriter<L, H> packet(xbcOrderBookSnapshot);
+        packet.header()
+              .set<H::HubAddress>(myaddr())
+              .set<H::Sequence>(digest.seq)
+              .set<H::Count>(static_cast<boost::uint32_t>(orders.size()));
 
-        packet->append(ptr->id().begin(), 32);
-        // packet->append(ptr->firstAddress());
-        packet->append(fc);
-        packet->append(ptr->firstAmount());
-        // packet->append(ptr->firstDestination());
-        packet->append(tc);
-        packet->append(ptr->secondAmount());
-        // packet->append(static_cast<boost::uint32_t>(ptr->state()));
+        for (; i != orders.end() && !packet.full(); ++i)
+        {
+            packet.addRecord()
+                  .set<L::Id>(i->id)
+                  .setString<L::SourceCurrency>(i->fromCurrency)
+                  .set<L::SourceAmount>(i->fromAmount)
+                  .setString<L::DestCurrency>(i->toCurrency)
+                  .set<L::DestAmount>(i->toAmount);
+        }
 
-        sendPacket(std::vector<unsigned char>(), packet);
+        sendPacket(to, packet.packet());
+    }
+    while (i != orders.end());
+}
+
+//*****************************************************************************
+//*****************************************************************************
+void XBridgeSession::requestOrderBook(const std::vector<unsigned char> & hub)
+{
+    XBridgeApp & app = XBridgeApp::instance();
+
+    boost::uint32_t seq = 0;
+    if (!app.orderBooks().needRequest(hub, seq))
+    {
+        return;
+    }
+
+    LOG() << "request order book of " << util::base64_encode(std::string((char *)&hub[0], 20))
+          << " after " << seq;
+
+    typedef XBridgeLayoutOrderBookRequest L;
+    XBridgePacketWriter<L> packet(xbcOrderBookRequest);
+    packet.set<L::HubAddress>(hub)
+          .set<L::ClientAddress>(myaddr())
+          .set<L::Sequence>(seq);
+
+    sendPacket(hub, packet.packet());
+}
+
+//*****************************************************************************
+//*****************************************************************************
+void XBridgeSession::notifyOrderBookChanges(const XBridgeOrderBooks::Changes & changes)
+{
+    if (changes.updated.size())
+    {
+        std::vector<XBridgeTransactionDescr> list;
+        list.reserve(changes.updated.size());
+        for (std::vector<XBridgeOrder>::const_iterator i = changes.updated.begin();
+             i != changes.updated.end(); ++i)
+        {
+            XBridgeTransactionDescr d;
+            d.id           = i->id;
+            d.fromCurrency = i->fromCurrency;
+            d.fromAmount   = i->fromAmount;
+            d.toCurrency   = i->toCurrency;
+            d.toAmount     = i->toAmount;
+            d.state        = XBridgeTransactionDescr::trPending;
+            list.push_back(d);
+        }
+
+        uiConnector.NotifyXBridgePendingTransactionsReceived(list);
+    }
+
+    if (changes.removed.size())
+    {
+        uiConnector.NotifyXBridgePendingTransactionsRemoved(changes.removed);
     }
 }
 
@@ -2084,7 +2532,8 @@ void XBridgeSession::eraseExpiredPendingTransactions()
         return;
     }
 
-    std::list<XBridgeTransactionPtr> list = e.pendingTransactions();
+    // only orders with elapsed deadline
+    std::list<XBridgeTransactionPtr> list = e.duePendingTransactions();
     std::list<XBridgeTransactionPtr>::iterator i = list.begin();
     for (; i != list.end(); ++i)
     {
@@ -2095,51 +2544,306 @@ void XBridgeSession::eraseExpiredPendingTransactions()
         if (ptr->isExpired())
         {
             LOG() << "transaction expired <" << ptr->id().GetHex() << ">";
-            e.deletePendingTransactions(ptr->hash1());
+            e.deletePendingTransactions(ptr->id());
+        }
+        else
+        {
+            // timestamp updated, check again later
+            e.schedulePendingTransaction(ptr->id(), XBridgeTransaction::stateTimeout(ptr->state()));
         }
     }
 }
 
 //*****************************************************************************
+// periodic calls of wallet, on executor of wallet
 //*****************************************************************************
-void XBridgeSession::checkUnconfirmedTx()
+bool XBridgeSession::pollWallet(const bool lists)
 {
-    XBridgeApp::instance().checkUnconfirmedTx();
+    // asynchronous, no wait for wallet
+    refillAddressPool();
+
+    if (!requestUnspent())
+    {
+        return false;
+    }
+
+    if (lists)
+    {
+        if (!requestUnconfirmedTx() || !requestAddressBook())
+        {
+            return false;
+        }
+    }
+
+    return true;
 }
 
 //*****************************************************************************
 //*****************************************************************************
-void XBridgeSession::requestUnconfirmedTx()
+bool XBridgeSession::requestUnconfirmedTx()
 {
     DEBUG_TRACE_LOG(currencyToLog());
 
+    // pay transactions into this wallet only (counterparty pays
+    // to destination address of swap), others never found here
     std::map<uint256, XBridgeTransactionDescrPtr> utx;
     {
         boost::mutex::scoped_lock l(XBridgeApp::m_txUnconfirmedLocker);
-        utx = XBridgeApp::m_unconfirmed;
+
+        for (std::map<uint256, XBridgeTransactionDescrPtr>::iterator i = XBridgeApp::m_unconfirmed.begin();
+             i != XBridgeApp::m_unconfirmed.end(); ++i)
+        {
+            if (i->second->toCurrency == m_currency)
+            {
+                utx.insert(*i);
+            }
+        }
+    }
+
+    if (utx.empty())
+    {
+        return true;
     }
 
+    // awaited pay transactions by hash
+    std::vector<std::string> txids;
+    std::map<std::string, uint256> ids;
     for (std::map<uint256, XBridgeTransactionDescrPtr>::iterator i = utx.begin(); i != utx.end(); ++i)
     {
-        LOG() << "check transaction " << i->second->payTxId.GetHex();
-        if (rpc::getTransaction(m_user, m_passwd, m_address, m_port,
-                                i->second->payTxId.GetHex()))
+        std::string payTxId = i->second->payTxId.GetHex();
+        txids.push_back(payTxId);
+        ids[payTxId] = i->first;
+    }
+
+    // one call whatever number of swaps, wallet transactions since cursor
+    std::vector<std::string> found;
+    std::vector<std::string> missing;
+    std::vector<std::string> seen;
+    if (listSinceCursor(seen))
+    {
+        std::set<std::string> listed(seen.begin(), seen.end());
+        for (std::vector<std::string>::iterator i = txids.begin(); i != txids.end(); ++i)
         {
+            if (listed.count(*i))
             {
-                boost::mutex::scoped_lock l(XBridgeApp::m_txUnconfirmedLocker);
-                XBridgeApp::m_unconfirmed.erase(i->first);
+                found.push_back(*i);
             }
+            else
+            {
+                // older than cursor or not wallet transaction
+                missing.push_back(*i);
+            }
+        }
+    }
+    else
+    {
+        missing = txids;
+    }
+
+    // rest of pay transactions in one batch request,
+    // listed ones confirmed anyway
+    bool result = true;
+    if (!missing.empty() &&
+            !rpc::getTransactions(m_user, m_passwd, m_address, m_port, missing, found))
+    {
+        LOG() << "rpc::getTransactions failed" << __FUNCTION__;
+        result = false;
+    }
+
+    // listsinceblock lists transaction once per output
+    std::sort(found.begin(), found.end());
+    found.erase(std::unique(found.begin(), found.end()), found.end());
+
+    for (std::vector<std::string>::iterator i = found.begin(); i != found.end(); ++i)
+    {
+        const uint256 & txid = ids[*i];
+        sendTransactionConfirmed(txid, utx[txid]);
+
+        boost::mutex::scoped_lock l(XBridgeApp::m_txUnconfirmedLocker);
+        XBridgeApp::m_unconfirmed.erase(txid);
+    }
+
+    return result;
+}
+
+//*****************************************************************************
+// wallet transactions since block cursor, cursor moved and stored
+//*****************************************************************************
+bool XBridgeSession::listSinceCursor(std::vector<std::string> & txids)
+{
+    std::string cursor;
+    {
+        boost::mutex::scoped_lock l(m_cursorLock);
+        cursor = m_blockCursor;
+    }
+
+    std::string lastBlock;
+    bool blockNotFound = false;
+    if (!rpc::listSinceBlock(m_user, m_passwd, m_address, m_port,
+                             cursor, cursorDepth, txids, lastBlock, blockNotFound))
+    {
+        LOG() << "rpc::listSinceBlock failed" << __FUNCTION__;
+
+        if (blockNotFound)
+        {
+            // next call lists from beginning
+            LOG() << "block cursor " << cursor << " not found, cleared " << __FUNCTION__;
+
+            boost::mutex::scoped_lock l(m_cursorLock);
+            if (m_blockCursor == cursor)
+            {
+                m_blockCursor.clear();
+                storeCursor();
+            }
+        }
+        return false;
+    }
+
+    boost::mutex::scoped_lock l(m_cursorLock);
+    if (m_blockCursor != lastBlock)
+    {
+        // restart resumes from here
+        m_blockCursor = lastBlock;
+        storeCursor();
+    }
+
+    return true;
+}
+
+//*****************************************************************************
+//*****************************************************************************
+std::string XBridgeSession::cursorFileName() const
+{
+    return settings().appPath() + "/xbridgep2p_" + m_currency + ".cursor";
+}
+
+//*****************************************************************************
+//*****************************************************************************
+void XBridgeSession::loadCursor()
+{
+    boost::mutex::scoped_lock l(m_cursorLock);
+
+    std::ifstream file(cursorFileName().c_str());
+    if (!file || !std::getline(file, m_blockCursor))
+    {
+        m_blockCursor.clear();
+    }
+}
+
+//*****************************************************************************
+// under m_cursorLock, written to temp file and renamed,
+// cursor of old file left if write failed
+//*****************************************************************************
+void XBridgeSession::storeCursor()
+{
+    const std::string fileName = cursorFileName();
+    const std::string tmpName  = fileName + ".tmp";
+
+    {
+        std::ofstream file(tmpName.c_str(), std::ios_base::trunc);
+        file << m_blockCursor << std::endl;
+        if (!file)
+        {
+            LOG() << "couldn't write " << tmpName << " " << __FUNCTION__;
+            return;
+        }
+    }
+
+    // rename doesn't replace existing file on windows
+    std::remove(fileName.c_str());
+    if (std::rename(tmpName.c_str(), fileName.c_str()) != 0)
+    {
+        LOG() << "couldn't rename " << tmpName << " " << __FUNCTION__;
+    }
+}
+
+//*****************************************************************************
+//*****************************************************************************
+bool XBridgeSession::requestUnspent()
+{
+    XBridgeUtxoCache & cache = XBridgeApp::instance().utxoCache();
+    if (!cache.beginRefresh(m_currency))
+    {
+        // not due
+        return true;
+    }
+
+    DEBUG_TRACE_LOG(currencyToLog());
+
+    std::vector<rpc::Unspent> entries;
+    if (!rpc::listUnspent(m_user, m_passwd, m_address, m_port, entries))
+    {
+        LOG() << "rpc::listUnspent failed" << __FUNCTION__;
+        cache.refreshFailed(m_currency);
+        return false;
+    }
+
+    cache.update(m_currency, entries);
+    return true;
+}
+
+//*****************************************************************************
+//*****************************************************************************
+void XBridgeSession::refillAddressPool()
+{
+    if (m_addressPool)
+    {
+        m_addressPool->refill();
+    }
+}
+
+//*****************************************************************************
+//*****************************************************************************
+bool XBridgeSession::walletNotify(const bool isBlock, const uint256 & hash)
+{
+    if (isBlock)
+    {
+        // confirmations changed, check now instead of next poll
+        return requestUnconfirmedTx();
+    }
+
+    transactionNotify(hash);
+    return true;
+}
+
+//*****************************************************************************
+//*****************************************************************************
+void XBridgeSession::transactionNotify(const uint256 & hash)
+{
+    DEBUG_TRACE_LOG(currencyToLog());
 
-            XBridgeTransactionDescrPtr & tx = i->second;
+    // hub, same as received transaction packet
+    XBridgeExchange & e = XBridgeExchange::instance();
+    if (e.isEnabled())
+    {
+        updateBitcoinTransaction(hash);
+    }
 
-            XBridgePacketPtr ptr(new XBridgePacket(xbcTransactionConfirmed));
-            ptr->append(tx->hubAddress);
-            ptr->append(tx->myAddress);
-            ptr->append(i->first.begin(), 32);
+    // client, pay transaction of swap seen by wallet
+    std::vector<std::pair<uint256, XBridgeTransactionDescrPtr> > seen;
+    {
+        boost::mutex::scoped_lock l(XBridgeApp::m_txUnconfirmedLocker);
 
-            sendPacket(tx->hubAddress, ptr);
+        for (std::map<uint256, XBridgeTransactionDescrPtr>::iterator i = XBridgeApp::m_unconfirmed.begin();
+             i != XBridgeApp::m_unconfirmed.end(); )
+        {
+            if (i->second->toCurrency == m_currency && i->second->payTxId == hash)
+            {
+                seen.push_back(*i);
+                XBridgeApp::m_unconfirmed.erase(i++);
+            }
+            else
+            {
+                ++i;
+            }
         }
     }
+
+    for (std::vector<std::pair<uint256, XBridgeTransactionDescrPtr> >::iterator i = seen.begin();
+         i != seen.end(); ++i)
+    {
+        sendTransactionConfirmed(i->first, i->second);
+    }
 }
 
 //*****************************************************************************
@@ -2152,7 +2856,8 @@ void XBridgeSession::checkFinishedTransactions()
         return;
     }
 
-    std::list<XBridgeTransactionPtr> list = e.finishedTransactions();
+    // only transactions with elapsed deadline or changed state
+    std::list<XBridgeTransactionPtr> list = e.dueTransactions();
     std::list<XBridgeTransactionPtr>::iterator i = list.begin();
     for (; i != list.end(); ++i)
     {
@@ -2167,12 +2872,14 @@ void XBridgeSession::checkFinishedTransactions()
             // send finished
             LOG() << "confirmed transaction <" << txid.GetHex() << ">";
             finishTransaction(ptr);
+            e.scheduleTransaction(txid, 0);
         }
         else if (ptr->state() == XBridgeTransaction::trCancelled)
         {
             // drop cancelled tx
             LOG() << "drop cancelled transaction <" << txid.GetHex() << ">";
             ptr->drop();
+            e.scheduleTransaction(txid, 0);
         }
         else if (ptr->state() == XBridgeTransaction::trFinished)
         {
@@ -2192,13 +2899,19 @@ void XBridgeSession::checkFinishedTransactions()
             LOG() << "delete invalid transaction <" << txid.GetHex() << ">";
             e.deleteTransaction(txid);
         }
-        else
+        else if (ptr->isExpired())
         {
             LOG() << "timeout transaction <" << txid.GetHex() << ">"
                   << " state " << ptr->strState();
 
             // send rollback
             rollbackTransaction(ptr);
+            e.scheduleTransaction(txid, 0);
+        }
+        else
+        {
+            // timestamp updated, check again later
+            e.scheduleTransaction(txid, XBridgeTransaction::stateTimeout(ptr->state()));
         }
     }
 }
@@ -2212,19 +2925,12 @@ void XBridgeSession::resendAddressBook()
 
 //*****************************************************************************
 //*****************************************************************************
-void XBridgeSession::getAddressBook()
-{
-    XBridgeApp::instance().getAddressBook();
-}
-
-//*****************************************************************************
-//*****************************************************************************
-void XBridgeSession::requestAddressBook()
+bool XBridgeSession::requestAddressBook()
 {
     std::vector<rpc::AddressBookEntry> entries;
     if (!rpc::requestAddressBook(m_user, m_passwd, m_address, m_port, entries))
     {
-        return;
+        return false;
     }
 
     XBridgeApp & app = XBridgeApp::instance();
@@ -2244,6 +2950,8 @@ void XBridgeSession::requestAddressBook()
             }
         }
     }
+
+    return true;
 }
 
 //*****************************************************************************
@@ -2254,52 +2962,163 @@ void XBridgeSession::sendAddressbookEntry(const std::string & currency,
 {
     if (m_socket->is_open())
     {
-        XBridgePacketPtr p(new XBridgePacket(xbcAddressBookEntry));
-        p->append(currency);
-        p->append(name);
-        p->append(address);
+        XBridgePacketWriter<XBridgeLayoutAddressBookEntry> p(xbcAddressBookEntry,
+                                                             XBridgePacket::stringSize(currency) +
+                                                             XBridgePacket::stringSize(name) +
+                                                             XBridgePacket::stringSize(address));
+        p.appendString(currency)
+         .appendString(name)
+         .appendString(address);
 
-        sendXBridgeMessage(p);
+        sendXBridgeMessage(p.packet());
     }
 }
 
 //******************************************************************************
 //******************************************************************************
-bool XBridgeSession::processPendingTransaction(XBridgePacketPtr packet)
+bool XBridgeSession::processOrderBookDelta(XBridgePacketPtr packet)
 {
-    if (packet->size() != 64)
+    typedef XBridgeLayoutOrderBookDelta L;
+    typedef XBridgeLayoutOrderBookDeltaHeader H;
+
+    XBridgeRecordsView<L, H> records(packet);
+    XBridgePacketView<H> header = records.header();
+
+    std::vector<unsigned char> hub = header.span<H::HubAddress>().vector();
+    if (hub == std::vector<unsigned char>(myaddr(), myaddr()+20))
     {
-        ERR() << "incorrect packet size " << __FUNCTION__;
-        return false;
+        // own book
+        return true;
     }
 
-    XBridgeTransactionDescr d;
-    d.id           = uint256(packet->data());
-    d.fromCurrency = std::string(reinterpret_cast<const char *>(packet->data()+32));
-    d.fromAmount   = *reinterpret_cast<boost::uint64_t *>(packet->data()+40);
-    d.toCurrency   = std::string(reinterpret_cast<const char *>(packet->data()+48));
-    d.toAmount     = *reinterpret_cast<boost::uint64_t *>(packet->data()+56);
-    d.state        = XBridgeTransactionDescr::trPending;
+    boost::uint32_t seq = header.uint32<H::Sequence>();
+
+    std::vector<XBridgeOrderDelta> deltas(records.count());
+    for (std::size_t i = 0; i < records.count(); ++i)
+    {
+        XBridgePacketView<L> r = records[i];
+
+        XBridgeOrderDelta & d = deltas[i];
+        d.seq   = seq + static_cast<boost::uint32_t>(i);
+        d.op    = static_cast<XBridgeOrderDelta::Op>(r.uint32<L::Op>());
+        d.order = XBridgeOrder(r.hash<L::Id>(),
+                               r.string<L::SourceCurrency>(), r.uint64<L::SourceAmount>(),
+                               r.string<L::DestCurrency>(), r.uint64<L::DestAmount>());
+    }
+
+    XBridgeOrderBooks::Changes changes;
+    if (!XBridgeApp::instance().orderBooks().applyDeltas(hub, deltas, changes))
+    {
+        requestOrderBook(hub);
+    }
 
-    uiConnector.NotifyXBridgePendingTransactionReceived(d);
+    notifyOrderBookChanges(changes);
 
     return true;
 }
 
 //******************************************************************************
 //******************************************************************************
-bool XBridgeSession::processTransactionFinished(XBridgePacketPtr packet)
+bool XBridgeSession::processOrderBookDigest(XBridgePacketPtr packet)
 {
-    DEBUG_TRACE_LOG(currencyToLog());
+    typedef XBridgeLayoutOrderBookDigest L;
+    XBridgePacketView<L> view(packet);
 
-    if (packet->size() != 32)
+    std::vector<unsigned char> hub = view.span<L::HubAddress>().vector();
+    if (hub == std::vector<unsigned char>(myaddr(), myaddr()+20))
     {
-        ERR() << "incorrect packet size for xbcTransactionFinished" << __FUNCTION__;
-        return false;
+        // own book
+        return true;
     }
 
+    XBridgeOrderBookDigest digest;
+    digest.seq    = view.uint32<L::Sequence>();
+    digest.count  = view.uint32<L::Count>();
+    digest.digest = view.hash<L::Digest>();
+
+    if (!XBridgeApp::instance().orderBooks().checkDigest(hub, digest))
+    {
+        requestOrderBook(hub);
+    }
+
+    return true;
+}
+
+//******************************************************************************
+// changes from journal if possible, full book otherwise
+//******************************************************************************
+bool XBridgeSession::processOrderBookRequest(XBridgePacketPtr packet)
+{
+    XBridgeExchange & e = XBridgeExchange::instance();
+    if (!e.isEnabled())
+    {
+        return true;
+    }
+
+    typedef XBridgeLayoutOrderBookRequest L;
+    XBridgePacketView<L> view(packet);
+
+    std::vector<unsigned char> client = view.span<L::ClientAddress>().vector();
+    boost::uint32_t seq = view.uint32<L::Sequence>();
+
+    XBridgeOrderBookJournal & book = e.orderBook();
+
+    std::vector<XBridgeOrderDelta> deltas;
+    if (seq != 0 && book.changesSince(seq, deltas))
+    {
+        sendOrderBookDeltas(client, deltas);
+        return true;
+    }
+
+    std::vector<XBridgeOrder> orders;
+    XBridgeOrderBookDigest digest = book.snapshot(orders);
+    sendOrderBookSnapshot(client, digest, orders);
+
+    return true;
+}
+
+//******************************************************************************
+//******************************************************************************
+bool XBridgeSession::processOrderBookSnapshot(XBridgePacketPtr packet)
+{
+    typedef XBridgeLayoutPendingTransaction L;
+    typedef XBridgeLayoutOrderBookSnapshotHeader H;
+
+    XBridgeRecordsView<L, H> records(packet);
+    XBridgePacketView<H> header = records.header();
+
+    std::vector<unsigned char> hub = header.span<H::HubAddress>().vector();
+
+    XBridgeOrderBookDigest digest;
+    digest.seq   = header.uint32<H::Sequence>();
+    digest.count = header.uint32<H::Count>();
+
+    std::vector<XBridgeOrder> orders;
+    orders.reserve(records.count());
+    for (std::size_t i = 0; i < records.count(); ++i)
+    {
+        XBridgePacketView<L> r = records[i];
+        orders.push_back(XBridgeOrder(r.hash<L::Id>(),
+                                      r.string<L::SourceCurrency>(), r.uint64<L::SourceAmount>(),
+                                      r.string<L::DestCurrency>(), r.uint64<L::DestAmount>()));
+    }
+
+    XBridgeOrderBooks::Changes changes;
+    XBridgeApp::instance().orderBooks().applySnapshot(hub, digest, orders, changes);
+
+    notifyOrderBookChanges(changes);
+
+    return true;
+}
+
+//******************************************************************************
+//******************************************************************************
+bool XBridgeSession::processTransactionFinished(XBridgePacketPtr packet)
+{
+    DEBUG_TRACE_LOG(currencyToLog());
+
     // transaction id
-    uint256 txid(packet->data());
+    uint256 txid = XBridgePacketView<XBridgeLayoutTxId>(packet).hash<XBridgeLayoutTxId::Id>();
 
     XBridgeTransactionDescrPtr xtx;
     {
@@ -2351,7 +3170,7 @@ bool XBridgeSession::revertXBridgeTransaction(const uint256 & id)
     }
 
     // rollback, commit revert transaction
-    if (!rpc::sendRawTransaction(m_user, m_passwd, m_address, m_port, xtx->revTx))
+    if (!rpc::sendRawTransaction(m_user, m_passwd, m_address, m_port, HexStr(xtx->revTx)))
     {
         // not commited....send cancel???
         // sendCancelTransaction(id);
@@ -2367,14 +3186,9 @@ bool XBridgeSession::processTransactionRollback(XBridgePacketPtr packet)
 {
     DEBUG_TRACE_LOG(currencyToLog());
 
-    if (packet->size() != 52)
-    {
-        ERR() << "incorrect packet size for xbcTransactionRollback" << __FUNCTION__;
-        return false;
-    }
-
     // transaction id
-    uint256 txid(packet->data()+20);
+    XBridgePacketView<XBridgeLayoutTransactionRollback> view(packet);
+    uint256 txid = view.hash<XBridgeLayoutTransactionRollback::HubTxId>();
 
     // for rollback need local transaction id
     // TODO maybe hub id?
@@ -2394,6 +3208,9 @@ bool XBridgeSession::processTransactionRollback(XBridgePacketPtr packet)
 
     revertXBridgeTransaction(xtx->id);
 
+    // reserved inputs free again, no-op if already spent
+    XBridgeApp::instance().utxoCache().release(txid);
+
     // update transaction state for gui
     xtx->state = XBridgeTransactionDescr::trRollback;
     uiConnector.NotifyXBridgeTransactionStateChanged(txid, xtx->state);
@@ -2405,14 +3222,8 @@ bool XBridgeSession::processTransactionRollback(XBridgePacketPtr packet)
 //******************************************************************************
 bool XBridgeSession::processTransactionDropped(XBridgePacketPtr packet)
 {
-    if (packet->size() != 32)
-    {
-        ERR() << "incorrect packet size for xbcTransactionDropped" << __FUNCTION__;
-        return false;
-    }
-
     // transaction id
-    uint256 id(packet->data());
+    uint256 id = XBridgePacketView<XBridgeLayoutTxId>(packet).hash<XBridgeLayoutTxId::Id>();
 
     XBridgeTransactionDescrPtr xtx;
     {
@@ -2428,6 +3239,9 @@ bool XBridgeSession::processTransactionDropped(XBridgePacketPtr packet)
         xtx = XBridgeApp::m_transactions[id];
     }
 
+    // reserved inputs free again, no-op if already spent
+    XBridgeApp::instance().utxoCache().release(id);
+
     // update transaction state for gui
     xtx->state = XBridgeTransactionDescr::trDropped;
     uiConnector.NotifyXBridgeTransactionStateChanged(id, xtx->state);
@@ -7,6 +7,10 @@
 #include "xbridge.h"
 #include "xbridgepacket.h"
 #include "xbridgetransaction.h"
+#include "xbridgetransactiondescr.h"
+#include "xbridgeorderbook.h"
+#include "xbridgeaddresspool.h"
+#include "bitcoinrpc.h"
 #include "FastDelegate.h"
 #include "util/uint256.h"
 
@@ -36,6 +40,7 @@ public:
     void start(XBridge::SocketPtr socket);
 
     static bool checkXBridgePacketVersion(XBridgePacketPtr packet);
+    static bool checkXBridgePacketCrc(XBridgePacketPtr packet);
 
     bool sendXBridgeMessage(XBridgePacketPtr packet);
     bool sendXBridgeMessage(const std::vector<unsigned char> & message);
@@ -52,11 +57,27 @@ public:
                               const std::string & name,
                               const std::string & address);
 
-    void getAddressBook();
-    void requestAddressBook();
+    // periodic wallet calls, lists and address book every LIST_INTERVAL
+    // ticks. false if wallet not responded
+    bool pollWallet(const bool lists);
 
-    void checkUnconfirmedTx();
-    void requestUnconfirmedTx();
+    bool requestAddressBook();
+    bool requestUnconfirmedTx();
+    bool requestUnspent();
+    void refillAddressPool();
+
+    // wallet hook, on wallet executor, false if wallet not responded
+    bool walletNotify(const bool isBlock, const uint256 & hash);
+    // transaction seen by wallet of session
+    void transactionNotify(const uint256 & hash);
+
+private:
+    enum
+    {
+        // confirmations of block cursor, pay transactions mined up to
+        // this deep before swap awaits them are still seen
+        cursorDepth = 6
+    };
 
 private:
     void init();
@@ -97,12 +118,19 @@ private:
     bool processXChatMessage(XBridgePacketPtr packet);
 
     bool processTransaction(XBridgePacketPtr packet);
+    bool processTransactionRecord(const XBridgePacketView<XBridgeLayoutTransaction> & view);
     bool processTransactionHoldApply(XBridgePacketPtr packet);
     bool processTransactionInitialized(XBridgePacketPtr packet);
     bool processTransactionCreated(XBridgePacketPtr packet);
     bool processTransactionSigned(XBridgePacketPtr packet);
     bool processTransactionCommited(XBridgePacketPtr packet);
     bool processTransactionConfirm(XBridgePacketPtr packet);
+    bool checkTransactionConfirmed(const uint256 & txid, XBridgeTransactionDescrPtr tx);
+    void sendTransactionConfirmed(const uint256 & txid, XBridgeTransactionDescrPtr tx);
+    bool listSinceCursor(std::vector<std::string> & txids);
+    std::string cursorFileName() const;
+    void loadCursor();
+    void storeCursor();
     bool processTransactionConfirmed(XBridgePacketPtr packet);
     bool processTransactionCancel(XBridgePacketPtr packet);
 
@@ -112,12 +140,33 @@ private:
     bool revertXBridgeTransaction(const uint256 & id);
 
     bool processBitcoinTransactionHash(XBridgePacketPtr packet);
+    void updateBitcoinTransaction(const uint256 & hash);
 
     bool processAddressBookEntry(XBridgePacketPtr packet);
 
-    bool processPendingTransaction(XBridgePacketPtr packet);
+    bool processExchangeWallets(XBridgePacketPtr packet);
+
+
+    bool processOrderBookDelta(XBridgePacketPtr packet);
+    bool processOrderBookDigest(XBridgePacketPtr packet);
+    bool processOrderBookRequest(XBridgePacketPtr packet);
+    bool processOrderBookSnapshot(XBridgePacketPtr packet);
+
+    void sendOrderBookDeltas(const std::vector<unsigned char> & to,
+                             const std::vector<XBridgeOrderDelta> & deltas);
+    void sendOrderBookSnapshot(const std::vector<unsigned char> & to,
+                               const XBridgeOrderBookDigest & digest,
+                               const std::vector<XBridgeOrder> & orders);
+    void requestOrderBook(const std::vector<unsigned char> & hub);
+    void notifyOrderBookChanges(const XBridgeOrderBooks::Changes & changes);
     bool processTransactionHold(XBridgePacketPtr packet);
     bool processTransactionInit(XBridgePacketPtr packet);
+    bool reserveUnspent(const uint256 & id,
+                        const boost::uint64_t amount,
+                        const boost::uint64_t changeCost,
+                        std::vector<rpc::Unspent> & outputs,
+                        boost::uint64_t & reserved);
+    bool newAddress(std::string & addr);
     bool processTransactionCreate(XBridgePacketPtr packet);
     bool processTransactionCreateBTC(XBridgePacketPtr packet);
     bool processTransactionSign(XBridgePacketPtr packet);
@@ -139,6 +188,13 @@ private:
     std::string       m_passwd;
     std::string       m_prefix;
     boost::uint64_t   m_COIN;
+
+    // fresh addresses for change and revert outputs
+    XBridgeAddressPoolPtr m_addressPool;
+
+    // listsinceblock cursor, stored in own file, not in config
+    boost::mutex      m_cursorLock;
+    std::string       m_blockCursor;
 };
 
 typedef std::shared_ptr<XBridgeSession> XBridgeSessionPtr;
@@ -0,0 +1,191 @@
+//*****************************************************************************
+//*****************************************************************************
+
+#ifndef XBRIDGESHARDEDMAP_H
+#define XBRIDGESHARDEDMAP_H
+
+#include "util/uint256.h"
+
+#include <vector>
+#include <cstring>
+
+#include <boost/unordered_map.hpp>
+#include <boost/thread/mutex.hpp>
+
+//*****************************************************************************
+// hash of transaction id, ids are hashes already, low bytes used
+//*****************************************************************************
+struct XBridgeIdHash
+{
+    std::size_t operator()(const uint256 & id) const
+    {
+        std::size_t h = 0;
+        memcpy(&h, id.begin(), sizeof(h));
+        return h;
+    }
+};
+
+//*****************************************************************************
+// hash map split into shards by key, each shard with own lock
+//
+// shard selected by high bits of hash, buckets inside shard by low bits.
+// shard locks are leaf locks, no other lock taken while shard is locked,
+// callbacks of forEach and takeIf must not call back into map
+//*****************************************************************************
+template <typename KEY, typename VALUE, typename HASH = XBridgeIdHash>
+class XBridgeShardedMap
+{
+public:
+    enum
+    {
+        shardBits  = 4,
+        shardCount = 1 << shardBits
+    };
+
+    typedef std::pair<KEY, VALUE> Item;
+
+public:
+    // false if not found, value not changed
+    bool get(const KEY & key, VALUE & value) const
+    {
+        const Shard & s = shard(key);
+        boost::mutex::scoped_lock l(s.lock);
+
+        typename Map::const_iterator i = s.map.find(key);
+        if (i == s.map.end())
+        {
+            return false;
+        }
+
+        value = i->second;
+        return true;
+    }
+
+    bool contains(const KEY & key) const
+    {
+        const Shard & s = shard(key);
+        boost::mutex::scoped_lock l(s.lock);
+        return s.map.find(key) != s.map.end();
+    }
+
+    // insert or replace
+    void set(const KEY & key, const VALUE & value)
+    {
+        Shard & s = shard(key);
+        boost::mutex::scoped_lock l(s.lock);
+        s.map[key] = value;
+    }
+
+    // false if key exists, value not replaced
+    bool insert(const KEY & key, const VALUE & value)
+    {
+        Shard & s = shard(key);
+        boost::mutex::scoped_lock l(s.lock);
+        return s.map.insert(std::make_pair(key, value)).second;
+    }
+
+    bool erase(const KEY & key)
+    {
+        Shard & s = shard(key);
+        boost::mutex::scoped_lock l(s.lock);
+        return s.map.erase(key) != 0;
+    }
+
+    // erase and return value
+    bool take(const KEY & key, VALUE & value)
+    {
+        Shard & s = shard(key);
+        boost::mutex::scoped_lock l(s.lock);
+
+        typename Map::iterator i = s.map.find(key);
+        if (i == s.map.end())
+        {
+            return false;
+        }
+
+        value = i->second;
+        s.map.erase(i);
+        return true;
+    }
+
+    // call f(key, value) for each item, one shard locked at a time
+    template <typename FUNC>
+    void forEach(FUNC f) const
+    {
+        for (std::size_t n = 0; n < shardCount; ++n)
+        {
+            const Shard & s = m_shards[n];
+            boost::mutex::scoped_lock l(s.lock);
+
+            for (typename Map::const_iterator i = s.map.begin(); i != s.map.end(); ++i)
+            {
+                f(i->first, i->second);
+            }
+        }
+    }
+
+    // erase items for which pred(key, value) is true,
+    // one shard locked at a time
+    template <typename PRED>
+    void takeIf(PRED pred, std::vector<Item> & taken)
+    {
+        for (std::size_t n = 0; n < shardCount; ++n)
+        {
+            Shard & s = m_shards[n];
+            boost::mutex::scoped_lock l(s.lock);
+
+            for (typename Map::iterator i = s.map.begin(); i != s.map.end(); )
+            {
+                if (pred(i->first, i->second))
+                {
+                    taken.push_back(*i);
+                    i = s.map.erase(i);
+                }
+                else
+                {
+                    ++i;
+                }
+            }
+        }
+    }
+
+    std::size_t size() const
+    {
+        std::size_t result = 0;
+        for (std::size_t n = 0; n < shardCount; ++n)
+        {
+            boost::mutex::scoped_lock l(m_shards[n].lock);
+            result += m_shards[n].map.size();
+        }
+        return result;
+    }
+
+private:
+    typedef boost::unordered_map<KEY, VALUE, HASH> Map;
+
+    struct Shard
+    {
+        mutable boost::mutex lock;
+        Map                  map;
+    };
+
+    std::size_t index(const KEY & key) const
+    {
+        return (HASH()(key) >> (sizeof(std::size_t) * 8 - shardBits)) & (shardCount - 1);
+    }
+
+    Shard & shard(const KEY & key)
+    {
+        return m_shards[index(key)];
+    }
+
+    const Shard & shard(const KEY & key) const
+    {
+        return m_shards[index(key)];
+    }
+
+private:
+    Shard m_shards[shardCount];
+};
+
+#endif // XBRIDGESHARDEDMAP_H
@@ -0,0 +1,111 @@
+//*****************************************************************************
+//*****************************************************************************
+
+#include "xbridgetimingwheel.h"
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+//*****************************************************************************
+//*****************************************************************************
+XBridgeTimingWheel::XBridgeTimingWheel()
+    : m_start(boost::posix_time::second_clock::universal_time())
+    , m_tick(0)
+    , m_slots(slotCount)
+{
+}
+
+//*****************************************************************************
+//*****************************************************************************
+boost::uint32_t XBridgeTimingWheel::now() const
+{
+    boost::posix_time::time_duration td = boost::posix_time::second_clock::universal_time() - m_start;
+    return td.is_negative() ? 0 : static_cast<boost::uint32_t>(td.total_seconds());
+}
+
+//*****************************************************************************
+//*****************************************************************************
+void XBridgeTimingWheel::schedule(const uint256 & id, const boost::uint32_t seconds)
+{
+    boost::mutex::scoped_lock l(m_lock);
+
+    boost::uint32_t deadline = now() + seconds;
+    if (deadline <= m_tick)
+    {
+        deadline = m_tick + 1;
+    }
+
+    std::map<uint256, boost::uint32_t>::iterator i = m_deadlines.find(id);
+    if (i != m_deadlines.end())
+    {
+        if (i->second == deadline)
+        {
+            return;
+        }
+
+        // old entry stays in slot and is dropped as stale
+        i->second = deadline;
+    }
+    else
+    {
+        m_deadlines[id] = deadline;
+    }
+
+    Entry e;
+    e.id       = id;
+    e.deadline = deadline;
+
+    m_slots[deadline % slotCount].push_back(e);
+}
+
+//*****************************************************************************
+//*****************************************************************************
+void XBridgeTimingWheel::cancel(const uint256 & id)
+{
+    boost::mutex::scoped_lock l(m_lock);
+    m_deadlines.erase(id);
+}
+
+//*****************************************************************************
+//*****************************************************************************
+void XBridgeTimingWheel::advance(std::vector<uint256> & due)
+{
+    boost::mutex::scoped_lock l(m_lock);
+
+    const boost::uint32_t current = now();
+
+    // after long pause one turn visits all slots
+    if (current - m_tick > slotCount)
+    {
+        m_tick = current - slotCount;
+    }
+
+    while (m_tick < current)
+    {
+        ++m_tick;
+
+        std::vector<Entry> & slot = m_slots[m_tick % slotCount];
+        std::vector<Entry>::iterator keep = slot.begin();
+
+        for (std::vector<Entry>::iterator i = slot.begin(); i != slot.end(); ++i)
+        {
+            std::map<uint256, boost::uint32_t>::iterator d = m_deadlines.find(i->id);
+            if (d == m_deadlines.end() || d->second != i->deadline)
+            {
+                // cancelled or rescheduled
+                continue;
+            }
+
+            if (i->deadline <= m_tick)
+            {
+                due.push_back(i->id);
+                m_deadlines.erase(d);
+                continue;
+            }
+
+            // later turn
+            *keep++ = *i;
+        }
+
+        slot.erase(keep, slot.end());
+    }
+}
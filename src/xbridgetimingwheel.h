@@ -0,0 +1,67 @@
+//*****************************************************************************
+//*****************************************************************************
+
+#ifndef XBRIDGETIMINGWHEEL_H
+#define XBRIDGETIMINGWHEEL_H
+
+#include "util/uint256.h"
+
+#include <vector>
+#include <map>
+
+#include <boost/cstdint.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/date_time/posix_time/ptime.hpp>
+
+//*****************************************************************************
+// hashed timing wheel, 1 second resolution
+//
+// deadline placed into slot (deadline % slotCount), entries for later
+// turns stay in slot. schedule O(1), advance touches only slots of
+// elapsed seconds. rescheduled and cancelled entries are dropped
+// lazily when their slot comes up
+//*****************************************************************************
+class XBridgeTimingWheel
+{
+public:
+    enum
+    {
+        // one turn covers transaction ttl, later turns are rare
+        slotCount = 256
+    };
+
+public:
+    XBridgeTimingWheel();
+
+    // due after seconds from now, replaces previous deadline of id,
+    // 0 - due on next advance
+    void schedule(const uint256 & id, const boost::uint32_t seconds);
+    void cancel(const uint256 & id);
+
+    // move to current time, collect due ids
+    void advance(std::vector<uint256> & due);
+
+private:
+    boost::uint32_t now() const;
+
+private:
+    struct Entry
+    {
+        uint256         id;
+        boost::uint32_t deadline;
+    };
+
+    boost::mutex                         m_lock;
+
+    boost::posix_time::ptime             m_start;
+
+    // last processed tick
+    boost::uint32_t                      m_tick;
+
+    std::vector<std::vector<Entry> >     m_slots;
+
+    // current deadline of id
+    std::map<uint256, boost::uint32_t>   m_deadlines;
+};
+
+#endif // XBRIDGETIMINGWHEEL_H
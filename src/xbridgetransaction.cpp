@@ -5,6 +5,7 @@
 #include "util/logger.h"
 #include "util/util.h"
 
+#include <boost/static_assert.hpp>
 
 //*****************************************************************************
 //*****************************************************************************
@@ -66,118 +67,88 @@ XBridgeTransaction::State XBridgeTransaction::state() const
 }
 
 //*****************************************************************************
+// state advances when both members confirmed current state
 //*****************************************************************************
-XBridgeTransaction::State XBridgeTransaction::increaseStateCounter(XBridgeTransaction::State state,
-                                                                   const std::vector<unsigned char> & from)
+// static
+const XBridgeTransaction::Transition * XBridgeTransaction::transition(const State state)
 {
-    LOG() << "confirm transaction state <" << strState(state)
-          << "> from " << util::base64_encode(from);
+    static const Transition transitions[] =
+    {
+        { trJoined,      trHold,        memberSource },
+        { trHold,        trInitialized, memberDest   },
+        { trInitialized, trCreated,     memberSource },
+        { trCreated,     trSigned,      memberDest   },
+        { trSigned,      trCommited,    memberSource },
+        { trCommited,    trFinished,    memberDest   }
+    };
 
-    if (state == trJoined && m_state == state)
+    for (std::size_t i = 0; i < sizeof(transitions) / sizeof(transitions[0]); ++i)
     {
-        if (from == m_first.source())
-        {
-            m_firstStateChanged = true;
-        }
-        else if (from == m_second.source())
+        if (transitions[i].state == state)
         {
-            m_secondStateChanged = true;
+            return &transitions[i];
         }
-        if (m_firstStateChanged && m_secondStateChanged)
-        {
-            m_state = trHold;
-            m_firstStateChanged = m_secondStateChanged = false;
-        }
-        return m_state;
     }
-    else if (state == trHold && m_state == state)
+
+    return 0;
+}
+
+//*****************************************************************************
+//*****************************************************************************
+// static
+boost::uint32_t XBridgeTransaction::stateTimeout(const State state)
+{
+    // see State when editing
+    static const boost::uint32_t timeouts[] =
     {
-        if (from == m_first.dest())
-        {
-            m_firstStateChanged = true;
-        }
-        else if (from == m_second.dest())
-        {
-            m_secondStateChanged = true;
-        }
-        if (m_firstStateChanged && m_secondStateChanged)
-        {
-            m_state = trInitialized;
-            m_firstStateChanged = m_secondStateChanged = false;
-        }
-        return m_state;
-    }
-    else if (state == trInitialized && m_state == state)
+        0,   // trInvalid
+        TTL, // trNew
+        TTL, // trJoined
+        TTL, // trHold
+        TTL, // trInitialized
+        TTL, // trCreated
+        TTL, // trSigned
+        TTL, // trCommited
+        0,   // trConfirmed
+        0,   // trFinished
+        0,   // trCancelled
+        0    // trDropped
+    };
+    BOOST_STATIC_ASSERT(sizeof(timeouts) / sizeof(timeouts[0]) == trDropped + 1);
+
+    return timeouts[state];
+}
+
+//*****************************************************************************
+//*****************************************************************************
+XBridgeTransaction::State XBridgeTransaction::increaseStateCounter(XBridgeTransaction::State state,
+                                                                   const std::vector<unsigned char> & from)
+{
+    LOG() << "confirm transaction state <" << strState(state)
+          << "> from " << util::base64_encode(from);
+
+    const Transition * t = transition(state);
+    if (!t || m_state != state)
     {
-        if (from == m_first.source())
-        {
-            m_firstStateChanged = true;
-        }
-        else if (from == m_second.source())
-        {
-            m_secondStateChanged = true;
-        }
-        if (m_firstStateChanged && m_secondStateChanged)
-        {
-            m_state = trCreated;
-            m_firstStateChanged = m_secondStateChanged = false;
-        }
-        return m_state;
+        return trInvalid;
     }
-    else if (state == trCreated && m_state == state)
+
+    if (from == (t->confirmedBy == memberSource ? m_first.source() : m_first.dest()))
     {
-        if (from == m_first.dest())
-        {
-            m_firstStateChanged = true;
-        }
-        else if (from == m_second.dest())
-        {
-            m_secondStateChanged = true;
-        }
-        if (m_firstStateChanged && m_secondStateChanged)
-        {
-            m_state = trSigned;
-            m_firstStateChanged = m_secondStateChanged = false;
-        }
-        return m_state;
+        m_firstStateChanged = true;
     }
-    else if (state == trSigned && m_state == state)
+    else if (from == (t->confirmedBy == memberSource ? m_second.source() : m_second.dest()))
     {
-        if (from == m_first.source())
-        {
-            m_firstStateChanged = true;
-        }
-        else if (from == m_second.source())
-        {
-            m_secondStateChanged = true;
-        }
-        if (m_firstStateChanged && m_secondStateChanged)
-        {
-            m_state = trCommited;
-            m_firstStateChanged = m_secondStateChanged = false;
-        }
-        return m_state;
+        m_secondStateChanged = true;
     }
-    else if (state == trCommited && m_state == state)
-    {
-        if (from == m_first.dest())
-        {
-            m_firstStateChanged = true;
-        }
-        else if (from == m_second.dest())
-        {
-            m_secondStateChanged = true;
-        }
 
-        if (m_firstStateChanged && m_secondStateChanged)
-        {
-            m_state = trFinished;
-            m_firstStateChanged = m_secondStateChanged = false;
-        }
-        return m_state;
+    if (m_firstStateChanged && m_secondStateChanged)
+    {
+        m_state = t->next;
+        m_firstStateChanged = m_secondStateChanged = false;
     }
 
-    return trInvalid;
+    return m_state;
 }
 
 //*****************************************************************************
@@ -230,7 +201,7 @@ bool XBridgeTransaction::isValid() const
 bool XBridgeTransaction::isExpired() const
 {
     boost::posix_time::time_duration td = boost::posix_time::second_clock::universal_time() - m_created;
-    if (td.total_seconds() > TTL)
+    if (td.total_seconds() > stateTimeout(m_state))
     {
         return true;
     }
@@ -334,14 +305,14 @@ boost::uint64_t XBridgeTransaction::firstAmount() const
 
 //*****************************************************************************
 //*****************************************************************************
-std::string XBridgeTransaction::firstRawPayTx() const
+const std::vector<unsigned char> & XBridgeTransaction::firstRawPayTx() const
 {
     return m_rawpaytx1;
 }
 
 //*****************************************************************************
 //*****************************************************************************
-std::string XBridgeTransaction::firstRawRevTx() const
+const std::vector<unsigned char> & XBridgeTransaction::firstRawRevTx() const
 {
     return m_rawrevtx1;
 }
@@ -390,14 +361,14 @@ boost::uint64_t XBridgeTransaction::secondAmount() const
 
 //*****************************************************************************
 //*****************************************************************************
-std::string XBridgeTransaction::secondRawPayTx() const
+const std::vector<unsigned char> & XBridgeTransaction::secondRawPayTx() const
 {
     return m_rawpaytx2;
 }
 
 //*****************************************************************************
 //*****************************************************************************
-std::string XBridgeTransaction::secondRawRevTx() const
+const std::vector<unsigned char> & XBridgeTransaction::secondRawRevTx() const
 {
     return m_rawrevtx2;
 }
@@ -483,8 +454,8 @@ bool XBridgeTransaction::tryJoin(const XBridgeTransactionPtr other)
 //*****************************************************************************
 //*****************************************************************************
 bool XBridgeTransaction::setRawPayTx(const std::vector<unsigned char> & addr,
-                                     const std::string & rawpaytx,
-                                     const std::string & rawrevtx)
+                                     const std::vector<unsigned char> & rawpaytx,
+                                     const std::vector<unsigned char> & rawrevtx)
 {
     if (m_second.source() == addr)
     {
@@ -504,7 +475,7 @@ bool XBridgeTransaction::setRawPayTx(const std::vector<unsigned char> & addr,
 //*****************************************************************************
 //*****************************************************************************
 bool XBridgeTransaction::updateRawRevTx(const std::vector<unsigned char> & addr,
-                                        const std::string & rawrevtx)
+                                        const std::vector<unsigned char> & rawrevtx)
 {
     if (m_second.dest() == addr)
     {
@@ -67,6 +67,9 @@ public:
     // update state counter and update state
     State increaseStateCounter(State state, const std::vector<unsigned char> & from);
 
+    // seconds in state before timeout, 0 - action required at once
+    static boost::uint32_t stateTimeout(const State state);
+
     static std::string strState(const State state);
     std::string strState() const;
 
@@ -91,8 +94,8 @@ public:
     std::vector<unsigned char> firstDestination() const;
     std::string                firstCurrency() const;
     boost::uint64_t            firstAmount() const;
-    std::string                firstRawPayTx() const;
-    std::string                firstRawRevTx() const;
+    const std::vector<unsigned char> & firstRawPayTx() const;
+    const std::vector<unsigned char> & firstRawRevTx() const;
     uint256                    firstTxHash() const;
 
     uint256                    secondId() const;
@@ -100,8 +103,8 @@ public:
     std::vector<unsigned char> secondDestination() const;
     std::string                secondCurrency() const;
     boost::uint64_t            secondAmount() const;
-    std::string                secondRawPayTx() const;
-    std::string                secondRawRevTx() const;
+    const std::vector<unsigned char> & secondRawPayTx() const;
+    const std::vector<unsigned char> & secondRawRevTx() const;
     uint256                    secondTxHash() const;
 
     bool tryJoin(const XBridgeTransactionPtr other);
@@ -109,16 +112,33 @@ public:
     // std::vector<unsigned char> opponentAddress(const std::vector<unsigned char> & addr);
 
     bool                       setRawPayTx(const std::vector<unsigned char> & addr,
-                                           const std::string & rawpaytx,
-                                           const std::string & rawrevtx);
+                                           const std::vector<unsigned char> & rawpaytx,
+                                           const std::vector<unsigned char> & rawrevtx);
     bool                       updateRawRevTx(const std::vector<unsigned char> & addr,
-                                              const std::string & rawrevytx);
+                                              const std::vector<unsigned char> & rawrevytx);
     bool                       setTxHash(const std::vector<unsigned char> & addr,
                                          const uint256 & hash);
 
 public:
     boost::mutex               m_lock;
 
+private:
+    // which member confirms state
+    enum Member
+    {
+        memberSource,
+        memberDest
+    };
+
+    struct Transition
+    {
+        State  state;
+        State  next;
+        Member confirmedBy;
+    };
+
+    static const Transition * transition(const State state);
+
 private:
     uint256                    m_id;
 
@@ -137,10 +157,11 @@ private:
     boost::uint64_t            m_sourceAmount;
     boost::uint64_t            m_destAmount;
 
-    std::string                m_rawpaytx1;
-    std::string                m_rawrevtx1;
-    std::string                m_rawpaytx2;
-    std::string                m_rawrevtx2;
+    // serialized transactions
+    std::vector<unsigned char> m_rawpaytx1;
+    std::vector<unsigned char> m_rawrevtx1;
+    std::vector<unsigned char> m_rawpaytx2;
+    std::vector<unsigned char> m_rawrevtx2;
 
     uint256                    m_txhash1;
     uint256                    m_txhash2;
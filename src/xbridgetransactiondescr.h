@@ -59,8 +59,9 @@ struct XBridgeTransactionDescr
     boost::posix_time::ptime   txtime;
 
     uint256                    payTxId;
-    std::string                payTx;
-    std::string                revTx;
+    // serialized transactions
+    std::vector<unsigned char> payTx;
+    std::vector<unsigned char> revTx;
 
     XBridgePacketPtr           packet;
 
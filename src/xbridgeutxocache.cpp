@@ -0,0 +1,266 @@
+//*****************************************************************************
+//*****************************************************************************
+
+#include "xbridgeutxocache.h"
+#include "util/logger.h"
+#include "util/settings.h"
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+//*****************************************************************************
+//*****************************************************************************
+bool XBridgeUtxoCache::beginRefresh(const std::string & currency)
+{
+    boost::mutex::scoped_lock l(m_lock);
+
+    Wallet & w = m_wallets[currency];
+    if (w.refreshing)
+    {
+        return false;
+    }
+
+    if (w.ready && !w.stale)
+    {
+        boost::posix_time::ptime now = boost::posix_time::second_clock::universal_time();
+        if ((now - w.refreshed).total_seconds() < refreshInterval)
+        {
+            return false;
+        }
+    }
+
+    w.refreshing = true;
+    return true;
+}
+
+//*****************************************************************************
+//*****************************************************************************
+void XBridgeUtxoCache::refreshFailed(const std::string & currency)
+{
+    boost::mutex::scoped_lock l(m_lock);
+    m_wallets[currency].refreshing = false;
+}
+
+//*****************************************************************************
+//*****************************************************************************
+void XBridgeUtxoCache::update(const std::string & currency,
+                              const std::vector<rpc::Unspent> & entries)
+{
+    boost::mutex::scoped_lock l(m_lock);
+
+    removeExpired();
+
+    Wallet & w = m_wallets[currency];
+
+    std::set<Outpoint> listed;
+    for (const rpc::Unspent & entry : entries)
+    {
+        listed.insert(Outpoint(entry.txId, entry.vout));
+    }
+
+    // gone from wallet
+    std::set<Outpoint> known;
+    for (std::vector<Output>::iterator i = w.outputs.begin(); i != w.outputs.end(); )
+    {
+        Outpoint o(i->entry.txId, i->entry.vout);
+        if (!listed.count(o))
+        {
+            i = w.outputs.erase(i);
+        }
+        else
+        {
+            known.insert(o);
+            ++i;
+        }
+    }
+
+    // spent and no longer listed
+    for (std::set<Outpoint>::iterator i = w.spent.begin(); i != w.spent.end(); )
+    {
+        if (!listed.count(*i))
+        {
+            w.spent.erase(i++);
+        }
+        else
+        {
+            ++i;
+        }
+    }
+
+    // new
+    for (const rpc::Unspent & entry : entries)
+    {
+        Outpoint o(entry.txId, entry.vout);
+        if (known.count(o) || w.spent.count(o))
+        {
+            continue;
+        }
+
+        Output out;
+        out.entry = entry;
+        w.outputs.push_back(out);
+        known.insert(o);
+    }
+
+    w.ready      = true;
+    w.stale      = false;
+    w.refreshing = false;
+    w.refreshed  = boost::posix_time::second_clock::universal_time();
+}
+
+//*****************************************************************************
+//*****************************************************************************
+bool XBridgeUtxoCache::isReady(const std::string & currency)
+{
+    boost::mutex::scoped_lock l(m_lock);
+
+    std::map<std::string, Wallet>::const_iterator i = m_wallets.find(currency);
+    return i != m_wallets.end() && i->second.ready;
+}
+
+//*****************************************************************************
+//*****************************************************************************
+void XBridgeUtxoCache::setSelector(XBridgeCoinSelectorPtr selector)
+{
+    boost::mutex::scoped_lock l(m_lock);
+    m_selector = selector;
+}
+
+//*****************************************************************************
+//*****************************************************************************
+bool XBridgeUtxoCache::reserve(const std::string & currency,
+                               const uint256 & id,
+                               const boost::uint64_t amount,
+                               const boost::uint64_t changeCost,
+                               const boost::uint64_t COIN,
+                               std::vector<rpc::Unspent> & outputs,
+                               boost::uint64_t & reserved)
+{
+    boost::mutex::scoped_lock l(m_lock);
+
+    if (m_reservations.count(id))
+    {
+        ERR() << "outputs already reserved for <" << id.GetHex() << "> " << __FUNCTION__;
+        return false;
+    }
+
+    if (!m_selector)
+    {
+        m_selector = XBridgeCoinSelector::create(settings().get<std::string>("Main.CoinSelection", "bnb"));
+    }
+
+    Wallet & w = m_wallets[currency];
+
+    // unreserved outputs
+    std::vector<Output *> candidates;
+    std::vector<boost::uint64_t> values;
+    for (Output & out : w.outputs)
+    {
+        if (out.reservedBy != uint256())
+        {
+            continue;
+        }
+
+        candidates.push_back(&out);
+        values.push_back(static_cast<boost::uint64_t>(out.entry.amount*COIN + .5));
+    }
+
+    std::vector<std::size_t> selected;
+    if (!m_selector->select(values, amount, changeCost, selected))
+    {
+        return false;
+    }
+
+    boost::uint64_t sum = 0;
+    for (std::size_t i : selected)
+    {
+        candidates[i]->reservedBy = id;
+        outputs.push_back(candidates[i]->entry);
+        sum += values[i];
+    }
+    reserved = sum;
+
+    Reservation & r = m_reservations[id];
+    r.currency = currency;
+    r.time     = boost::posix_time::second_clock::universal_time();
+
+    return true;
+}
+
+//*****************************************************************************
+//*****************************************************************************
+void XBridgeUtxoCache::release(const uint256 & id)
+{
+    boost::mutex::scoped_lock l(m_lock);
+    unreserve(id, false);
+}
+
+//*****************************************************************************
+//*****************************************************************************
+void XBridgeUtxoCache::spend(const uint256 & id)
+{
+    boost::mutex::scoped_lock l(m_lock);
+    unreserve(id, true);
+}
+
+//*****************************************************************************
+// m_lock must be locked
+//*****************************************************************************
+void XBridgeUtxoCache::unreserve(const uint256 & id, const bool spent)
+{
+    std::map<uint256, Reservation>::iterator r = m_reservations.find(id);
+    if (r == m_reservations.end())
+    {
+        return;
+    }
+
+    Wallet & w = m_wallets[r->second.currency];
+    for (std::vector<Output>::iterator i = w.outputs.begin(); i != w.outputs.end(); )
+    {
+        if (i->reservedBy != id)
+        {
+            ++i;
+        }
+        else if (spent)
+        {
+            w.spent.insert(Outpoint(i->entry.txId, i->entry.vout));
+            i = w.outputs.erase(i);
+        }
+        else
+        {
+            i->reservedBy = uint256();
+            ++i;
+        }
+    }
+
+    if (spent)
+    {
+        // wallet changed, refresh on next tick
+        w.stale = true;
+    }
+
+    m_reservations.erase(r);
+}
+
+//*****************************************************************************
+// m_lock must be locked
+//*****************************************************************************
+void XBridgeUtxoCache::removeExpired()
+{
+    boost::posix_time::ptime now = boost::posix_time::second_clock::universal_time();
+
+    std::vector<uint256> expired;
+    for (std::map<uint256, Reservation>::const_iterator i = m_reservations.begin();
+         i != m_reservations.end(); ++i)
+    {
+        if ((now - i->second.time).total_seconds() > reservationTTL)
+        {
+            expired.push_back(i->first);
+        }
+    }
+
+    for (const uint256 & id : expired)
+    {
+        LOG() << "reservation of <" << id.GetHex() << "> expired";
+        unreserve(id, false);
+    }
+}
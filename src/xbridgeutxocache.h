@@ -0,0 +1,115 @@
+//*****************************************************************************
+//*****************************************************************************
+
+#ifndef XBRIDGEUTXOCACHE_H
+#define XBRIDGEUTXOCACHE_H
+
+#include "bitcoinrpc.h"
+#include "xbridgecoinselector.h"
+#include "util/uint256.h"
+
+#include <string>
+#include <vector>
+#include <set>
+#include <map>
+
+#include <boost/cstdint.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/date_time/posix_time/ptime.hpp>
+
+//*****************************************************************************
+// unspent outputs of local wallets, with reservation for swaps in flight
+//
+// refreshed in background from listunspent, each refresh merged into
+// cache: outputs gone from wallet removed, new outputs appended,
+// reservations kept. swap reserves outputs under its id, released on
+// cancel and rollback, or marked spent when pay transaction sent.
+// spent outputs not taken back from snapshot fetched before wallet
+// saw spending transaction.
+// inputs chosen by coin selector, Main.CoinSelection in config
+//*****************************************************************************
+class XBridgeUtxoCache
+{
+public:
+    enum
+    {
+        // seconds
+        refreshInterval = 10,
+        // reservation of swap which never finished
+        reservationTTL  = 600
+    };
+
+public:
+    // true if refresh due and not running, caller must call
+    // update or refreshFailed after
+    bool beginRefresh(const std::string & currency);
+    void refreshFailed(const std::string & currency);
+
+    // merge listunspent snapshot
+    void update(const std::string & currency,
+                const std::vector<rpc::Unspent> & entries);
+
+    // true after first snapshot
+    bool isReady(const std::string & currency);
+
+    void setSelector(XBridgeCoinSelectorPtr selector);
+
+    // unreserved outputs covering amount, amounts in COIN units.
+    // excess up to changeCost means no change output.
+    // false and nothing reserved if not enough unreserved outputs
+    bool reserve(const std::string & currency,
+                 const uint256 & id,
+                 const boost::uint64_t amount,
+                 const boost::uint64_t changeCost,
+                 const boost::uint64_t COIN,
+                 std::vector<rpc::Unspent> & outputs,
+                 boost::uint64_t & reserved);
+
+    // outputs of swap available again
+    void release(const uint256 & id);
+    // pay transaction of swap sent, outputs leave cache
+    void spend(const uint256 & id);
+
+private:
+    typedef std::pair<std::string, int> Outpoint;
+
+    struct Output
+    {
+        rpc::Unspent entry;
+        // reserved by swap, zero if free
+        uint256      reservedBy;
+    };
+
+    struct Wallet
+    {
+        // wallet order
+        std::vector<Output>       outputs;
+        // spent by sent transactions, until wallet stops listing them
+        std::set<Outpoint>        spent;
+
+        bool                      ready;
+        // refresh on next tick
+        bool                      stale;
+        bool                      refreshing;
+        boost::posix_time::ptime  refreshed;
+
+        Wallet() : ready(false), stale(false), refreshing(false) {}
+    };
+
+    struct Reservation
+    {
+        std::string               currency;
+        boost::posix_time::ptime  time;
+    };
+
+    void removeExpired();
+    void unreserve(const uint256 & id, const bool spent);
+
+private:
+    boost::mutex                         m_lock;
+    XBridgeCoinSelectorPtr               m_selector;
+    std::map<std::string, Wallet>        m_wallets;
+    std::map<uint256, Reservation>       m_reservations;
+};
+
+#endif // XBRIDGEUTXOCACHE_H
@@ -0,0 +1,184 @@
+//*****************************************************************************
+//*****************************************************************************
+
+#include "xbridgewalletexecutor.h"
+#include "util/logger.h"
+
+#include <algorithm>
+
+#include <boost/bind.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+//*****************************************************************************
+//*****************************************************************************
+XBridgeWalletExecutor::XBridgeWalletExecutor(const std::string & name)
+    : m_name(name)
+    , m_work(m_io)
+    , m_thread(boost::bind(&boost::asio::io_service::run, &m_io))
+    , m_busy(false)
+    , m_timedOut(false)
+    , m_failures(0)
+    , m_openUntil(boost::posix_time::min_date_time)
+    , m_openInterval(openInterval)
+{
+}
+
+//*****************************************************************************
+//*****************************************************************************
+XBridgeWalletExecutor::~XBridgeWalletExecutor()
+{
+    m_io.stop();
+    m_thread.join();
+}
+
+//*****************************************************************************
+//*****************************************************************************
+bool XBridgeWalletExecutor::submit(const Job & job)
+{
+    boost::mutex::scoped_lock l(m_lock);
+
+    boost::posix_time::ptime now = boost::posix_time::second_clock::universal_time();
+
+    if (m_busy)
+    {
+        if (!m_timedOut && (now - m_started).total_seconds() > jobTimeout)
+        {
+            // counted once, thread stays with call until wallet answers
+            m_timedOut = true;
+            LOG() << "wallet " << m_name << " not responded in " << jobTimeout << " seconds";
+            failed(now);
+        }
+        return false;
+    }
+
+    if (now < m_openUntil)
+    {
+        return false;
+    }
+
+    start(job, now);
+    return true;
+}
+
+//*****************************************************************************
+//*****************************************************************************
+bool XBridgeWalletExecutor::queue(const Job & job)
+{
+    boost::mutex::scoped_lock l(m_lock);
+
+    boost::posix_time::ptime now = boost::posix_time::second_clock::universal_time();
+
+    if (now < m_openUntil)
+    {
+        return false;
+    }
+
+    if (m_busy)
+    {
+        if (m_queue.size() >= maxQueued)
+        {
+            LOG() << "wallet " << m_name << " queue full, job dropped";
+            return false;
+        }
+
+        m_queue.push_back(job);
+        return true;
+    }
+
+    start(job, now);
+    return true;
+}
+
+//*****************************************************************************
+// under lock
+//*****************************************************************************
+void XBridgeWalletExecutor::start(const Job & job, const boost::posix_time::ptime & now)
+{
+    m_busy     = true;
+    m_timedOut = false;
+    m_started  = now;
+
+    m_io.post(boost::bind(&XBridgeWalletExecutor::run, this, job));
+}
+
+//*****************************************************************************
+//*****************************************************************************
+void XBridgeWalletExecutor::stop()
+{
+    m_io.stop();
+}
+
+//*****************************************************************************
+// executor thread
+//*****************************************************************************
+void XBridgeWalletExecutor::run(const Job job)
+{
+    bool result = false;
+    try
+    {
+        result = job();
+    }
+    catch (std::exception & e)
+    {
+        ERR() << "wallet " << m_name << " " << e.what() << " " << __FUNCTION__;
+    }
+
+    boost::mutex::scoped_lock l(m_lock);
+
+    boost::posix_time::ptime now = boost::posix_time::second_clock::universal_time();
+
+    m_busy = false;
+
+    if (result)
+    {
+        succeeded();
+    }
+    else if (!m_timedOut)
+    {
+        failed(now);
+    }
+
+    if (now < m_openUntil)
+    {
+        // wallet failing, polling catches up after breaker closed
+        m_queue.clear();
+    }
+    else if (!m_queue.empty())
+    {
+        Job next = m_queue.front();
+        m_queue.pop_front();
+        start(next, now);
+    }
+}
+
+//*****************************************************************************
+// under lock
+//*****************************************************************************
+void XBridgeWalletExecutor::failed(const boost::posix_time::ptime & now)
+{
+    if (++m_failures < failureThreshold)
+    {
+        return;
+    }
+
+    LOG() << "wallet " << m_name << " failed " << m_failures
+          << " times, next call in " << m_openInterval << " seconds";
+
+    m_openUntil    = now + boost::posix_time::seconds(m_openInterval);
+    m_openInterval = std::min<unsigned int>(m_openInterval * 2, maxOpenInterval);
+}
+
+//*****************************************************************************
+// under lock
+//*****************************************************************************
+void XBridgeWalletExecutor::succeeded()
+{
+    if (m_failures >= failureThreshold)
+    {
+        LOG() << "wallet " << m_name << " responding again";
+    }
+
+    m_failures     = 0;
+    m_openUntil    = boost::posix_time::min_date_time;
+    m_openInterval = openInterval;
+}
@@ -0,0 +1,80 @@
+//*****************************************************************************
+//*****************************************************************************
+
+#ifndef XBRIDGEWALLETEXECUTOR_H
+#define XBRIDGEWALLETEXECUTOR_H
+
+#include <string>
+#include <deque>
+
+#include <boost/asio.hpp>
+#include <boost/thread.hpp>
+#include <boost/function.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/date_time/posix_time/ptime.hpp>
+
+//*****************************************************************************
+// own thread for periodic calls of one wallet
+//
+// one job at a time, job submitted while previous one runs is skipped,
+// so slow or dead wallet delays only itself. queued jobs (wallet hooks)
+// wait for running one instead, up to maxQueued. job running longer than
+// jobTimeout counted as failure. failureThreshold failures in a row
+// open breaker, no jobs for openInterval seconds, doubled on each
+// failed probe up to maxOpenInterval, reset by first job succeeded
+//*****************************************************************************
+class XBridgeWalletExecutor
+{
+public:
+    enum
+    {
+        // seconds
+        jobTimeout       = 30,
+        failureThreshold = 3,
+        // seconds
+        openInterval     = 10,
+        maxOpenInterval  = 300,
+        maxQueued        = 16
+    };
+
+    // false if wallet not responded
+    typedef boost::function<bool ()> Job;
+
+public:
+    explicit XBridgeWalletExecutor(const std::string & name);
+    ~XBridgeWalletExecutor();
+
+    // false if skipped, job running or breaker open
+    bool submit(const Job & job);
+    // run after running job, false if dropped, queue full or breaker open
+    bool queue(const Job & job);
+
+    void stop();
+
+private:
+    void start(const Job & job, const boost::posix_time::ptime & now);
+    void run(const Job job);
+
+    void failed(const boost::posix_time::ptime & now);
+    void succeeded();
+
+private:
+    const std::string             m_name;
+
+    boost::asio::io_service       m_io;
+    boost::asio::io_service::work m_work;
+    boost::thread                 m_thread;
+
+    boost::mutex                  m_lock;
+    bool                          m_busy;
+    bool                          m_timedOut;
+    boost::posix_time::ptime      m_started;
+    unsigned int                  m_failures;
+    boost::posix_time::ptime      m_openUntil;
+    unsigned int                  m_openInterval;
+    std::deque<Job>               m_queue;
+};
+
+typedef boost::shared_ptr<XBridgeWalletExecutor> XBridgeWalletExecutorPtr;
+
+#endif // XBRIDGEWALLETEXECUTOR_H
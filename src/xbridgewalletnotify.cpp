@@ -0,0 +1,165 @@
+//*****************************************************************************
+//*****************************************************************************
+
+#include "xbridgewalletnotify.h"
+#include "util/logger.h"
+
+#include <vector>
+
+#include <boost/bind.hpp>
+#include <boost/algorithm/string.hpp>
+
+//*****************************************************************************
+//*****************************************************************************
+XBridgeWalletNotify::XBridgeWalletNotify(boost::asio::io_service & io,
+                                         const unsigned short port,
+                                         const Handler & handler)
+    : m_socket(io)
+    , m_retry(io)
+    , m_port(port)
+    , m_handler(handler)
+{
+}
+
+//*****************************************************************************
+//*****************************************************************************
+bool XBridgeWalletNotify::start()
+{
+    boost::system::error_code error;
+
+    boost::asio::ip::udp::endpoint endpoint(boost::asio::ip::address_v4::loopback(), m_port);
+    m_socket.open(endpoint.protocol(), error);
+    if (!error)
+    {
+        m_socket.bind(endpoint, error);
+    }
+
+    if (error)
+    {
+        ERR() << "wallet notify port " << m_port << " not available, "
+              << error.message() << " " << __FUNCTION__;
+        m_socket.close(error);
+        return false;
+    }
+
+    LOG() << "wallet notify listen on 127.0.0.1:" << m_port;
+
+    read();
+    return true;
+}
+
+//*****************************************************************************
+//*****************************************************************************
+void XBridgeWalletNotify::stop()
+{
+    boost::system::error_code error;
+    m_retry.cancel(error);
+    m_socket.close(error);
+}
+
+//*****************************************************************************
+//*****************************************************************************
+void XBridgeWalletNotify::read()
+{
+    m_socket.async_receive_from(boost::asio::buffer(m_buffer), m_sender,
+                                boost::bind(&XBridgeWalletNotify::onRead, this,
+                                            boost::asio::placeholders::error,
+                                            boost::asio::placeholders::bytes_transferred));
+}
+
+//*****************************************************************************
+//*****************************************************************************
+void XBridgeWalletNotify::onRead(const boost::system::error_code & error,
+                                 const std::size_t size)
+{
+    if (error == boost::asio::error::operation_aborted)
+    {
+        // closed
+        return;
+    }
+
+    if (error)
+    {
+        // persistent error would spin, next read delayed
+        LOG() << "wallet notify read error " << error.message() << " " << __FUNCTION__;
+
+        m_retry.expires_from_now(boost::posix_time::seconds(static_cast<long>(retryInterval)));
+        m_retry.async_wait(boost::bind(&XBridgeWalletNotify::onRetry, this,
+                                       boost::asio::placeholders::error));
+        return;
+    }
+
+    {
+        std::string message(m_buffer.data(), size);
+
+        std::string currency;
+        bool isBlock = false;
+        uint256 hash;
+        if (parse(message, currency, isBlock, hash))
+        {
+            m_handler(currency, isBlock, hash);
+        }
+        else
+        {
+            LOG() << "bad wallet notification <" << boost::algorithm::trim_copy(message) << ">";
+        }
+    }
+
+    read();
+}
+
+//*****************************************************************************
+//*****************************************************************************
+void XBridgeWalletNotify::onRetry(const boost::system::error_code & error)
+{
+    if (error == boost::asio::error::operation_aborted)
+    {
+        // stopped
+        return;
+    }
+
+    read();
+}
+
+//*****************************************************************************
+//*****************************************************************************
+// static
+bool XBridgeWalletNotify::parse(const std::string & message,
+                                std::string & currency,
+                                bool & isBlock,
+                                uint256 & hash)
+{
+    std::string text = boost::algorithm::trim_copy(message);
+
+    std::vector<std::string> fields;
+    boost::algorithm::split(fields, text, boost::algorithm::is_space(),
+                            boost::algorithm::token_compress_on);
+    if (fields.size() != 3)
+    {
+        return false;
+    }
+
+    if (fields[1] == "tx")
+    {
+        isBlock = false;
+    }
+    else if (fields[1] == "block")
+    {
+        isBlock = true;
+    }
+    else
+    {
+        return false;
+    }
+
+    const std::string & hex = fields[2];
+    if (hex.size() != 64 ||
+        hex.find_first_not_of("0123456789abcdefABCDEF") != std::string::npos)
+    {
+        return false;
+    }
+
+    currency = fields[0];
+    hash.SetHex(hex);
+    return true;
+}
@@ -0,0 +1,67 @@
+//*****************************************************************************
+//*****************************************************************************
+
+#ifndef XBRIDGEWALLETNOTIFY_H
+#define XBRIDGEWALLETNOTIFY_H
+
+#include "util/uint256.h"
+
+#include <string>
+
+#include <boost/asio.hpp>
+#include <boost/array.hpp>
+#include <boost/function.hpp>
+
+//*****************************************************************************
+// local udp endpoint for -walletnotify and -blocknotify hooks of wallets
+//
+// one datagram per event, text "<currency> tx <txid>" or
+// "<currency> block <hash>", for example
+//   walletnotify=sh -c "echo BTC tx %s | nc -u -w1 127.0.0.1 <port>"
+// bound to loopback only, Main.NotifyPort in config, 0 - disabled.
+// handler called on io thread of socket
+//*****************************************************************************
+class XBridgeWalletNotify
+{
+public:
+    enum
+    {
+        maxDatagram   = 256,
+        // seconds, read again after socket error
+        retryInterval = 1
+    };
+
+    typedef boost::function<void (const std::string & currency,
+                                  const bool isBlock,
+                                  const uint256 & hash)> Handler;
+
+public:
+    XBridgeWalletNotify(boost::asio::io_service & io,
+                        const unsigned short port,
+                        const Handler & handler);
+
+    // false if port not available
+    bool start();
+    void stop();
+
+private:
+    void read();
+    void onRead(const boost::system::error_code & error, const std::size_t size);
+    void onRetry(const boost::system::error_code & error);
+
+    static bool parse(const std::string & message,
+                      std::string & currency,
+                      bool & isBlock,
+                      uint256 & hash);
+
+private:
+    boost::asio::ip::udp::socket          m_socket;
+    boost::asio::ip::udp::endpoint        m_sender;
+    boost::array<char, maxDatagram>       m_buffer;
+    boost::asio::deadline_timer           m_retry;
+
+    const unsigned short                  m_port;
+    Handler                               m_handler;
+};
+
+#endif // XBRIDGEWALLETNOTIFY_H
@@ -84,6 +84,7 @@ SOURCES += \
     src/xbridgeexchange.cpp \
     src/xbridgetransaction.cpp \
     src/util/settings.cpp \
+    src/util/crc32c.cpp \
     src/xbridgetransactionmember.cpp \
     src/bitcoinrpc.cpp \
     src/json/json_spirit_reader.cpp \
@@ -94,7 +95,19 @@ SOURCES += \
     src/key.cpp \
     src/keystore.cpp \
     src/sync.cpp \
-    src/crypter.cpp
+    src/crypter.cpp \
+    src/xbridgemessagequeue.cpp \
+    src/xbridgepacketpool.cpp \
+    src/xbridgeorderbook.cpp \
+    src/xbridgematcher.cpp \
+    src/xbridgetimingwheel.cpp \
+    src/xbridgehubring.cpp \
+    src/rpcparser.cpp \
+    src/xbridgeutxocache.cpp \
+    src/xbridgecoinselector.cpp \
+    src/xbridgeaddresspool.cpp \
+    src/xbridgewalletnotify.cpp \
+    src/xbridgewalletexecutor.cpp
 
 #-------------------------------------------------
 HEADERS += \
@@ -109,6 +122,7 @@ HEADERS += \
     src/xbridgeexchange.h \
     src/xbridgetransaction.h \
     src/util/settings.h \
+    src/util/crc32c.h \
     src/xbridgetransactionmember.h \
     src/version.h \
     src/config.h \
@@ -133,7 +147,20 @@ HEADERS += \
     src/keystore.h \
     src/sync.h \
     src/crypter.h \
-    src/base58.h
+    src/base58.h \
+    src/xbridgemessagequeue.h \
+    src/xbridgepacketpool.h \
+    src/xbridgeorderbook.h \
+    src/xbridgematcher.h \
+    src/xbridgeshardedmap.h \
+    src/xbridgetimingwheel.h \
+    src/xbridgehubring.h \
+    src/rpcparser.h \
+    src/xbridgeutxocache.h \
+    src/xbridgecoinselector.h \
+    src/xbridgeaddresspool.h \
+    src/xbridgewalletnotify.h \
+    src/xbridgewalletexecutor.h
 
 #-------------------------------------------------
 !withoutgui {